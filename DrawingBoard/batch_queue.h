@@ -0,0 +1,163 @@
+#ifndef _BATCH_QUEUE_H_
+#define _BATCH_QUEUE_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "scene.h"
+
+// Whether `a' and `b' may be drawn in one call: built-in shapes need the same
+// kind and style, other shapes the same painter as well, since a plugin's
+// painter may keep state of its own.
+bool SameBatch(const SceneItem &a, const SceneItem &b) {
+    return a.kind == b.kind && a.style == b.style && (a.kind != SHAPE_CUSTOM || a.painter == b.painter);
+}
+
+//
+// Sorts the items of a frame, given in z-order, into batches that can each be
+// drawn in one call: items that go together (see `SameBatch()') and do not
+// overlap each other.
+//
+// Items that do not overlap may be drawn in any order. So rather than only
+// joining consecutive items, an item joins the latest open batch of its kind
+// that comes after every batch it overlaps, or starts a new batch at the end.
+// Batches are numbered in drawing order, and a coarse grid remembers the
+// latest batch that touched each cell, so an item finds what it overlaps
+// without looking at other items; sharing a cell counts as overlapping.
+//
+// At most `maxPending' batches are open, and the oldest one is flushed when
+// another one is needed; with one, only runs of consecutive items are
+// batched.
+//
+class BatchQueue {
+  public:
+    typedef std::vector<const SceneItem*> Batch;
+
+    // Upper bounds on a batch and on the open batches; a board seldom has
+    // more kinds times styles on screen than open batches.
+    static const size_t kMaxBatch = 64;
+    static const size_t kMaxPending = 32;
+
+    BatchQueue(size_t maxPending = kMaxPending) : m_slots(maxPending), m_head(0), m_count(0), m_next(1), m_floor(0) {}
+
+    BatchQueue(const BatchQueue &) = delete;
+    BatchQueue& operator=(const BatchQueue &) = delete;
+
+    // `flush(batch)' is called on every batch that is done, in drawing order.
+    template <class FLUSH>
+    void Add(const SceneItem *item, FLUSH flush);
+
+    // Flushes all open batches; call once the frame has been added.
+    template <class FLUSH>
+    void Flush(FLUSH flush);
+
+  private:
+    // Cells are this many pixels on a side; items that cover more cells than
+    // `kMaxCells' are put after everything instead of into the grid.
+    static const int kCellShift = 7;
+    static const LONG kMaxCells = 64;
+
+    struct Pending {
+        Batch items;
+        size_t number;
+    };
+
+    Pending &At(size_t k) {
+        return m_slots[(m_head + k) % m_slots.size()];
+    }
+
+    // Calls `func(cell)' for every cell `bounds' touches.
+    template <class FUNC>
+    static void ForEachCell(const RECT &bounds, FUNC func);
+
+    template <class FLUSH>
+    void FlushOldest(FLUSH flush);
+
+    std::vector<Pending> m_slots;  // a ring, so that the batches keep their capacity
+    size_t m_head, m_count;
+    size_t m_next;                 // number of the next batch
+    size_t m_floor;                // items go after this batch wherever they are
+    std::unordered_map<uint64_t, size_t> m_cells;  // the latest batch in every cell
+};
+
+template <class FUNC>
+void BatchQueue::ForEachCell(const RECT &bounds, FUNC func) {
+    for (LONG y = bounds.top >> kCellShift; y <= bounds.bottom >> kCellShift; y++) {
+        for (LONG x = bounds.left >> kCellShift; x <= bounds.right >> kCellShift; x++) {
+            func(((uint64_t)(uint32_t)y << 32) | (uint32_t)x);
+        }
+    }
+}
+
+template <class FLUSH>
+void BatchQueue::Add(const SceneItem *item, FLUSH flush) {
+    const RECT &bounds = item->bounds;
+    LONG cells = ((bounds.right >> kCellShift) - (bounds.left >> kCellShift) + 1) *
+                 ((bounds.bottom >> kCellShift) - (bounds.top >> kCellShift) + 1);
+    bool large = cells > kMaxCells || cells <= 0;
+
+    // The latest batch the item may overlap.
+    size_t after = m_floor;
+    if (large) {
+        after = m_next - 1;
+    } else {
+        ForEachCell(bounds, [this, &after](uint64_t cell) {
+            auto it = m_cells.find(cell);
+            if (it != m_cells.end()) {
+                after = std::max(after, it->second);
+            }
+        });
+    }
+
+    size_t number = 0;
+    for (size_t k = m_count; k-- > 0;) {
+        Pending &pending = At(k);
+        if (pending.number <= after) {
+            break;
+        }
+        if (SameBatch(*pending.items[0], *item) && pending.items.size() < kMaxBatch) {
+            pending.items.push_back(item);
+            number = pending.number;
+            break;
+        }
+    }
+    if (number == 0) {
+        if (m_count == m_slots.size()) {
+            FlushOldest(flush);
+        }
+        Pending &pending = At(m_count++);
+        pending.items.push_back(item);
+        pending.number = number = m_next++;
+    }
+
+    if (large) {
+        m_floor = number;
+    } else {
+        ForEachCell(bounds, [this, number](uint64_t cell) {
+            m_cells[cell] = number;
+        });
+    }
+}
+
+template <class FLUSH>
+void BatchQueue::Flush(FLUSH flush) {
+    while (m_count > 0) {
+        FlushOldest(flush);
+    }
+    m_cells.clear();
+}
+
+template <class FLUSH>
+void BatchQueue::FlushOldest(FLUSH flush) {
+    Pending &pending = At(0);
+    flush(pending.items);
+    pending.items.clear();
+    m_head = (m_head + 1) % m_slots.size();
+    m_count--;
+}
+
+#endif // _BATCH_QUEUE_H_
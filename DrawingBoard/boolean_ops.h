@@ -0,0 +1,832 @@
+#ifndef _BOOLEAN_OPS_H_
+#define _BOOLEAN_OPS_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <set>
+#include <vector>
+
+enum BooleanOp {
+    BOOLEAN_UNION,
+    BOOLEAN_INTERSECTION,
+    BOOLEAN_DIFFERENCE,
+};
+
+typedef std::vector<POINT> Contour;
+
+//
+// Polygon clipping with the sweep line algorithm of Martinez, Rueda and Feito.
+//
+// A vertical line sweeps the edges of both operands from left to right. Edges
+// are split wherever they cross, and each piece is kept or dropped depending on
+// whether it is inside the other operand, which follows from the edge right
+// below it on the sweep line. The kept pieces are finally chained into
+// contours. This runs in O((n + k) log n) for n edges with k crossings.
+//
+// All predicates are evaluated exactly on 64-bit integers. Crossings have to be
+// rounded to integer points though, which bends the edges they split a little;
+// to keep that from reordering the sweep line, the sweep runs on a grid up to
+// 2^16 times finer than the input and the result is snapped back at the end.
+// Coordinates must stay within +/-2^29; see `kMaxCoordinate'.
+//
+// @see https://doi.org/10.1016/j.advengsoft.2013.04.004
+//
+class BooleanEngine {
+  public:
+    BooleanEngine() = default;
+    ~BooleanEngine() = default;
+
+    BooleanEngine(const BooleanEngine &) = delete;
+    BooleanEngine& operator=(const BooleanEngine &) = delete;
+
+    // Beyond this, exact predicates on the finer grid would overflow.
+    static const LONG kMaxCoordinate = 1 << 29;
+
+    // Operands and result are sets of closed contours under the even-odd rule.
+    // The contours of the result do not cross, and holes wind opposite to the
+    // contours around them. Returns false, leaving `result' empty, if the
+    // operands reach beyond `kMaxCoordinate'.
+    bool Compute(const std::vector<Contour> &subject, const std::vector<Contour> &clipping, BooleanOp op,
+                 std::vector<Contour> *result);
+
+  private:
+    struct Point {
+        int64_t x, y;
+        bool operator==(const Point &p) const { return x == p.x && y == p.y; }
+        bool operator!=(const Point &p) const { return !(*this == p); }
+    };
+
+    enum EdgeType {
+        EDGE_NORMAL,
+        EDGE_NON_CONTRIBUTING,
+        EDGE_SAME_TRANSITION,
+        EDGE_DIFFERENT_TRANSITION,
+    };
+
+    struct SweepEvent;
+
+    struct SegmentLess {
+        bool operator()(const SweepEvent *e1, const SweepEvent *e2) const {
+            return CompareSegments(e1, e2) < 0;
+        }
+    };
+
+    typedef std::set<SweepEvent*, SegmentLess> SweepLine;
+
+    struct SweepEvent {
+        Point point;
+        bool left;
+        SweepEvent *other;
+        bool subject;
+        int contourId;
+        EdgeType type;
+        bool inOut, otherInOut, inResult;
+        bool inSweepLine;
+        SweepLine::iterator posSL;
+        int pos;
+
+        bool Below(const Point &p) const {
+            return left ? SignedArea(point, other->point, p) > 0 : SignedArea(other->point, point, p) > 0;
+        }
+
+        bool Above(const Point &p) const {
+            return !Below(p);
+        }
+
+        bool Vertical() const {
+            return point.x == other->point.x;
+        }
+    };
+
+    struct EventLater {
+        bool operator()(const SweepEvent *e1, const SweepEvent *e2) const {
+            return CompareEvents(e1, e2) > 0;
+        }
+    };
+
+    static int64_t SignedArea(const Point &p0, const Point &p1, const Point &p2) {
+        return (p0.x - p2.x) * (p1.y - p2.y) - (p1.x - p2.x) * (p0.y - p2.y);
+    }
+
+    static int CompareEvents(const SweepEvent *e1, const SweepEvent *e2);
+    static int CompareSegments(const SweepEvent *le1, const SweepEvent *le2);
+    static int Intersect(const Point &a1, const Point &a2, const Point &b1, const Point &b2, Point *out);
+
+    Point ToGrid(const POINT &pt) const;
+    POINT FromGrid(const Point &pt) const;
+
+    SweepEvent *NewEvent(const Point &pt, bool left, SweepEvent *other, bool subject, int contourId);
+    void AddOperand(const std::vector<Contour> &contours, bool subject, int *contourId);
+    void AddSegment(const Point &p1, const Point &p2, bool subject, int contourId);
+    void ComputeFields(SweepEvent *event, const SweepEvent *prev, BooleanOp op);
+    static bool InResult(const SweepEvent *event, BooleanOp op);
+    int PossibleIntersection(SweepEvent *se1, SweepEvent *se2);
+    void DivideSegment(SweepEvent *se, const Point &pt);
+    std::vector<Contour> ConnectEdges(const std::vector<SweepEvent*> &sortedEvents, BooleanOp op);
+    static bool ResultAbove(const SweepEvent *event, BooleanOp op);
+    void AddLoop(const std::vector<Point> &chain, std::vector<Contour> *result) const;
+
+    int m_shift;
+    std::deque<SweepEvent> m_events;
+    std::priority_queue<SweepEvent*, std::vector<SweepEvent*>, EventLater> m_queue;
+};
+
+// > 0 if e1 is to be processed after e2.
+int BooleanEngine::CompareEvents(const SweepEvent *e1, const SweepEvent *e2) {
+    if (e1->point.x != e2->point.x) {
+        return e1->point.x > e2->point.x ? 1 : -1;
+    }
+    if (e1->point.y != e2->point.y) {
+        return e1->point.y > e2->point.y ? 1 : -1;
+    }
+    // Same point: right endpoints first.
+    if (e1->left != e2->left) {
+        return e1->left ? 1 : -1;
+    }
+    // Same point, both left or both right: the lower segment first.
+    if (SignedArea(e1->point, e1->other->point, e2->other->point) != 0) {
+        return !e1->Below(e2->other->point) ? 1 : -1;
+    }
+    if (e1->subject != e2->subject) {
+        return e1->subject ? -1 : 1;
+    }
+    // Keep the order strict for sorting.
+    if (e1 == e2) {
+        return 0;
+    }
+    return std::less<const SweepEvent*>()(e1, e2) ? -1 : 1;
+}
+
+// < 0 if le1 lies below le2 on the sweep line.
+int BooleanEngine::CompareSegments(const SweepEvent *le1, const SweepEvent *le2) {
+    if (le1 == le2) {
+        return 0;
+    }
+
+    if (SignedArea(le1->point, le1->other->point, le2->point) != 0 ||
+        SignedArea(le1->point, le1->other->point, le2->other->point) != 0) {
+        // Not collinear.
+        if (le1->point == le2->point) {
+            return le1->Below(le2->other->point) ? -1 : 1;
+        }
+        if (le1->point.x == le2->point.x) {
+            return le1->point.y < le2->point.y ? -1 : 1;
+        }
+        // The segment inserted later is compared against the earlier one,
+        // by its right end if its left end lies on that one.
+        if (CompareEvents(le1, le2) == 1) {
+            if (SignedArea(le2->point, le2->other->point, le1->point) == 0) {
+                return le2->Above(le1->other->point) ? -1 : 1;
+            }
+            return le2->Above(le1->point) ? -1 : 1;
+        }
+        if (SignedArea(le1->point, le1->other->point, le2->point) == 0) {
+            return le1->Below(le2->other->point) ? -1 : 1;
+        }
+        return le1->Below(le2->point) ? -1 : 1;
+    }
+
+    // Collinear.
+    if (le1->subject == le2->subject) {
+        if (le1->point == le2->point) {
+            if (le1->contourId != le2->contourId) {
+                return le1->contourId > le2->contourId ? 1 : -1;
+            }
+            // A duplicated edge; any consistent order will do.
+            return std::less<const SweepEvent*>()(le1, le2) ? -1 : 1;
+        }
+    } else {
+        return le1->subject ? -1 : 1;
+    }
+
+    return CompareEvents(le1, le2) == 1 ? 1 : -1;
+}
+
+// Returns how many points segments a1-a2 and b1-b2 have in common: none, one
+// crossing, or the two ends of their overlap, written to `out' in order along a.
+int BooleanEngine::Intersect(const Point &a1, const Point &a2, const Point &b1, const Point &b2, Point *out) {
+    int64_t vax = a2.x - a1.x, vay = a2.y - a1.y;
+    int64_t vbx = b2.x - b1.x, vby = b2.y - b1.y;
+    int64_t ex = b1.x - a1.x, ey = b1.y - a1.y;
+
+    int64_t kross = vax * vby - vay * vbx;
+    if (kross != 0) {
+        // a1 + s/den * va == b1 + t/den * vb
+        int64_t s = ex * vby - ey * vbx;
+        int64_t t = ex * vay - ey * vax;
+        int64_t den = kross;
+        if (den < 0) {
+            s = -s;
+            t = -t;
+            den = -den;
+        }
+        if (s < 0 || s > den || t < 0 || t > den) {
+            return 0;
+        }
+
+        // Hand back endpoints untouched, they are compared for equality later.
+        if (s == 0) {
+            out[0] = a1;
+        } else if (s == den) {
+            out[0] = a2;
+        } else if (t == 0) {
+            out[0] = b1;
+        } else if (t == den) {
+            out[0] = b2;
+        } else {
+            double f = (double)s / (double)den;
+            out[0].x = a1.x + (int64_t)std::floor(vax * f + 0.5);
+            out[0].y = a1.y + (int64_t)std::floor(vay * f + 0.5);
+
+            // Rounding must not move a crossing off a vertical or horizontal
+            // segment, or the piece split off it would point the other way.
+            if (vbx == 0) {
+                out[0].x = b1.x;
+            }
+            if (vby == 0) {
+                out[0].y = b1.y;
+            }
+
+            // A crossing rounded next to an endpoint is that endpoint;
+            // splitting off a one-unit piece would only cross again. The same
+            // goes for the endpoint as for the rounding.
+            const Point *ends[] = { &a1, &a2, &b1, &b2 };
+            for (const Point *end : ends) {
+                if ((vax == 0 && end->x != a1.x) || (vbx == 0 && end->x != b1.x) ||
+                    (vay == 0 && end->y != a1.y) || (vby == 0 && end->y != b1.y)) {
+                    continue;
+                }
+                if (std::abs(out[0].x - end->x) <= 1 && std::abs(out[0].y - end->y) <= 1) {
+                    out[0] = *end;
+                    break;
+                }
+            }
+        }
+        return 1;
+    }
+
+    // Parallel, and unless collinear they have nothing in common.
+    if (ex * vay - ey * vax != 0) {
+        return 0;
+    }
+
+    // Collinear: project b's ends onto a, scaled by |a|^2.
+    int64_t sa = vax * vax + vay * vay;
+    int64_t s0 = ex * vax + ey * vay;
+    int64_t s1 = s0 + vbx * vax + vby * vay;
+    int64_t lo = std::max((int64_t)0, std::min(s0, s1));
+    int64_t hi = std::min(sa, std::max(s0, s1));
+    if (lo > hi) {
+        return 0;
+    }
+
+    const Point &plo = (lo == 0) ? a1 : (lo == s0 ? b1 : b2);
+    const Point &phi = (hi == sa) ? a2 : (hi == s0 ? b1 : b2);
+    out[0] = plo;
+    if (lo == hi) {
+        return 1;
+    }
+    out[1] = phi;
+    return 2;
+}
+
+BooleanEngine::Point BooleanEngine::ToGrid(const POINT &pt) const {
+    Point p = { (int64_t)pt.x * ((int64_t)1 << m_shift), (int64_t)pt.y * ((int64_t)1 << m_shift) };
+    return p;
+}
+
+POINT BooleanEngine::FromGrid(const Point &pt) const {
+    double scale = (double)((int64_t)1 << m_shift);
+    POINT p = { (LONG)std::floor(pt.x / scale + 0.5), (LONG)std::floor(pt.y / scale + 0.5) };
+    return p;
+}
+
+BooleanEngine::SweepEvent *BooleanEngine::NewEvent(const Point &pt, bool left, SweepEvent *other, bool subject, int contourId) {
+    m_events.push_back(SweepEvent());
+    SweepEvent *e = &m_events.back();
+    e->point = pt;
+    e->left = left;
+    e->other = other;
+    e->subject = subject;
+    e->contourId = contourId;
+    e->type = EDGE_NORMAL;
+    e->inOut = e->otherInOut = e->inResult = false;
+    e->inSweepLine = false;
+    e->pos = 0;
+    return e;
+}
+
+//
+// Adds the edges of one operand to the queue.
+//
+// Edges of the same operand that overlap, say where a polygon runs back along
+// itself or has several vertices on one line, cancel out in pairs under the
+// even-odd rule. The sweep only resolves overlaps of two edges, one of each
+// operand, so these are settled here: the edges on each line are merged into
+// the stretches that an odd number of them cover.
+//
+void BooleanEngine::AddOperand(const std::vector<Contour> &contours, bool subject, int *contourId) {
+    // An edge on the line `dx * y - dy * x == offset', where (dx, dy) is the
+    // reduced direction pointing right, from `t0' to `t1' along it.
+    struct LineEdge {
+        int64_t dx, dy, offset;
+        int64_t t0, t1;
+        Point p0, p1;
+        int contourId;
+    };
+
+    std::vector<LineEdge> edges;
+    for (const Contour &contour : contours) {
+        ++*contourId;
+        for (size_t i = 0, n = contour.size(); i < n; i++) {
+            LineEdge e;
+            e.p0 = ToGrid(contour[i]);
+            e.p1 = ToGrid(contour[(i + 1) % n]);
+            if (e.p0 == e.p1) {
+                continue;
+            }
+
+            int64_t a = std::abs(e.p1.x - e.p0.x), b = std::abs(e.p1.y - e.p0.y);
+            while (b != 0) {
+                int64_t r = a % b;
+                a = b;
+                b = r;
+            }
+            e.dx = (e.p1.x - e.p0.x) / a;
+            e.dy = (e.p1.y - e.p0.y) / a;
+            if (e.dx < 0 || (e.dx == 0 && e.dy < 0)) {
+                e.dx = -e.dx;
+                e.dy = -e.dy;
+            }
+            e.offset = e.dx * e.p0.y - e.dy * e.p0.x;
+            e.t0 = e.dx * e.p0.x + e.dy * e.p0.y;
+            e.t1 = e.dx * e.p1.x + e.dy * e.p1.y;
+            if (e.t0 > e.t1) {
+                std::swap(e.t0, e.t1);
+                std::swap(e.p0, e.p1);
+            }
+            e.contourId = *contourId;
+            edges.push_back(e);
+        }
+    }
+
+    std::sort(edges.begin(), edges.end(), [](const LineEdge &a, const LineEdge &b) {
+        if (a.dx != b.dx) {
+            return a.dx < b.dx;
+        }
+        if (a.dy != b.dy) {
+            return a.dy < b.dy;
+        }
+        return a.offset < b.offset;
+    });
+
+    typedef std::pair<int64_t, Point> LineEnd;
+    std::vector<LineEnd> ends;
+    for (size_t first = 0, last; first < edges.size(); first = last) {
+        const LineEdge &e = edges[first];
+        for (last = first + 1; last < edges.size(); last++) {
+            if (edges[last].dx != e.dx || edges[last].dy != e.dy || edges[last].offset != e.offset) {
+                break;
+            }
+        }
+        if (last == first + 1) {
+            AddSegment(e.p0, e.p1, subject, e.contourId);
+            continue;
+        }
+
+        // The coverage changes parity at every end.
+        ends.clear();
+        for (size_t k = first; k < last; k++) {
+            ends.push_back(LineEnd(edges[k].t0, edges[k].p0));
+            ends.push_back(LineEnd(edges[k].t1, edges[k].p1));
+        }
+        std::sort(ends.begin(), ends.end(), [](const LineEnd &a, const LineEnd &b) {
+            return a.first < b.first;
+        });
+
+        bool odd = false;
+        Point start = ends[0].second;
+        for (size_t k = 0, next; k < ends.size(); k = next) {
+            bool toggle = false;
+            for (next = k; next < ends.size() && ends[next].first == ends[k].first; next++) {
+                toggle = !toggle;
+            }
+            if (!toggle) {
+                continue;
+            }
+            if (odd) {
+                AddSegment(start, ends[k].second, subject, e.contourId);
+            } else {
+                start = ends[k].second;
+            }
+            odd = !odd;
+        }
+    }
+}
+
+void BooleanEngine::AddSegment(const Point &p1, const Point &p2, bool subject, int contourId) {
+    SweepEvent *e1 = NewEvent(p1, false, nullptr, subject, contourId);
+    SweepEvent *e2 = NewEvent(p2, false, e1, subject, contourId);
+    e1->other = e2;
+    if (CompareEvents(e1, e2) > 0) {
+        e2->left = true;
+    } else {
+        e1->left = true;
+    }
+    m_queue.push(e1);
+    m_queue.push(e2);
+}
+
+void BooleanEngine::ComputeFields(SweepEvent *event, const SweepEvent *prev, BooleanOp op) {
+    if (!prev) {
+        event->inOut = false;
+        event->otherInOut = true;
+    } else if (event->subject == prev->subject) {
+        event->inOut = !prev->inOut;
+        event->otherInOut = prev->otherInOut;
+    } else {
+        event->inOut = !prev->otherInOut;
+        event->otherInOut = prev->Vertical() ? !prev->inOut : prev->inOut;
+    }
+    event->inResult = InResult(event, op);
+}
+
+bool BooleanEngine::InResult(const SweepEvent *event, BooleanOp op) {
+    switch (event->type) {
+        case EDGE_NORMAL:
+            switch (op) {
+                case BOOLEAN_INTERSECTION:
+                    return !event->otherInOut;
+                case BOOLEAN_UNION:
+                    return event->otherInOut;
+                case BOOLEAN_DIFFERENCE:
+                    return (event->subject && event->otherInOut) || (!event->subject && !event->otherInOut);
+            }
+            return false;
+        case EDGE_SAME_TRANSITION:
+            return op == BOOLEAN_INTERSECTION || op == BOOLEAN_UNION;
+        case EDGE_DIFFERENT_TRANSITION:
+            return op == BOOLEAN_DIFFERENCE;
+        default:
+            return false;
+    }
+}
+
+// Splits se1 and se2 where they meet. Returns 2 if they share their left end
+// and thus have to be re-evaluated by the caller.
+int BooleanEngine::PossibleIntersection(SweepEvent *se1, SweepEvent *se2) {
+    Point inter[2];
+    int n = Intersect(se1->point, se1->other->point, se2->point, se2->other->point, inter);
+
+    if (n == 0) {
+        return 0;
+    }
+    if (n == 1 && (se1->point == se2->point || se1->other->point == se2->other->point)) {
+        return 0;
+    }
+
+    if (n == 1) {
+        if (se1->point != inter[0] && se1->other->point != inter[0]) {
+            DivideSegment(se1, inter[0]);
+        }
+        if (se2->point != inter[0] && se2->other->point != inter[0]) {
+            DivideSegment(se2, inter[0]);
+        }
+        return 1;
+    }
+
+    // The segments overlap.
+    std::vector<SweepEvent*> events;
+    bool leftCoincide = false, rightCoincide = false;
+
+    if (se1->point == se2->point) {
+        leftCoincide = true;
+    } else if (CompareEvents(se1, se2) == 1) {
+        events.push_back(se2);
+        events.push_back(se1);
+    } else {
+        events.push_back(se1);
+        events.push_back(se2);
+    }
+
+    if (se1->other->point == se2->other->point) {
+        rightCoincide = true;
+    } else if (CompareEvents(se1->other, se2->other) == 1) {
+        events.push_back(se2->other);
+        events.push_back(se1->other);
+    } else {
+        events.push_back(se1->other);
+        events.push_back(se2->other);
+    }
+
+    if (leftCoincide) {
+        // Both line segments are equal or share the left endpoint. An edge
+        // doubled within one polygon cancels out under the even-odd rule.
+        se2->type = EDGE_NON_CONTRIBUTING;
+        if (se1->subject == se2->subject) {
+            se1->type = EDGE_NON_CONTRIBUTING;
+        } else {
+            se1->type = (se2->inOut == se1->inOut) ? EDGE_SAME_TRANSITION : EDGE_DIFFERENT_TRANSITION;
+        }
+        if (!rightCoincide) {
+            DivideSegment(events[1]->other, events[0]->point);
+        }
+        return 2;
+    }
+
+    if (rightCoincide) {
+        // The line segments share the right endpoint.
+        DivideSegment(events[0], events[1]->point);
+        return 3;
+    }
+
+    if (events[0] != events[3]->other) {
+        // No line segment includes the other one totally.
+        DivideSegment(events[0], events[1]->point);
+        DivideSegment(events[1], events[2]->point);
+        return 3;
+    }
+
+    // One line segment includes the other one.
+    DivideSegment(events[0], events[1]->point);
+    DivideSegment(events[3]->other, events[2]->point);
+    return 3;
+}
+
+void BooleanEngine::DivideSegment(SweepEvent *se, const Point &pt) {
+    SweepEvent *r = NewEvent(pt, false, se, se->subject, se->contourId);
+    SweepEvent *l = NewEvent(pt, true, se->other, se->subject, se->contourId);
+
+    // Rounding may have moved the point past the right end.
+    if (CompareEvents(l, se->other) > 0) {
+        se->other->left = true;
+        l->left = false;
+    }
+
+    se->other->other = l;
+    se->other = r;
+
+    m_queue.push(l);
+    m_queue.push(r);
+}
+
+bool BooleanEngine::Compute(const std::vector<Contour> &subject, const std::vector<Contour> &clipping, BooleanOp op,
+                            std::vector<Contour> *result) {
+    result->clear();
+    m_events.clear();
+    m_queue = std::priority_queue<SweepEvent*, std::vector<SweepEvent*>, EventLater>();
+
+    RECT sbox = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN }, cbox = sbox;
+    int64_t extent = 1;
+    for (const Contour &contour : subject) {
+        for (const POINT &pt : contour) {
+            sbox.left = std::min(sbox.left, pt.x); sbox.right = std::max(sbox.right, pt.x);
+            sbox.top = std::min(sbox.top, pt.y); sbox.bottom = std::max(sbox.bottom, pt.y);
+            extent = std::max(extent, std::max(std::abs((int64_t)pt.x), std::abs((int64_t)pt.y)));
+        }
+    }
+    for (const Contour &contour : clipping) {
+        for (const POINT &pt : contour) {
+            cbox.left = std::min(cbox.left, pt.x); cbox.right = std::max(cbox.right, pt.x);
+            cbox.top = std::min(cbox.top, pt.y); cbox.bottom = std::max(cbox.bottom, pt.y);
+            extent = std::max(extent, std::max(std::abs((int64_t)pt.x), std::abs((int64_t)pt.y)));
+        }
+    }
+
+    if (extent > kMaxCoordinate) {
+        return false;
+    }
+
+    // Operands that cannot overlap have nothing in common. Otherwise even
+    // trivial results go through the sweep, which normalizes them.
+    if (sbox.left > cbox.right || cbox.left > sbox.right || sbox.top > cbox.bottom || cbox.top > sbox.bottom) {
+        if (op == BOOLEAN_INTERSECTION || (op == BOOLEAN_DIFFERENCE && sbox.left > sbox.right)) {
+            return true;
+        }
+    }
+
+    m_shift = 0;
+    while (m_shift < 16 && (extent << (m_shift + 1)) <= kMaxCoordinate) {
+        m_shift++;
+    }
+
+    int contourId = 0;
+    AddOperand(subject, true, &contourId);
+    AddOperand(clipping, false, &contourId);
+
+    SweepLine sweepLine;
+    std::vector<SweepEvent*> sortedEvents;
+    int64_t subjectRight = 0, rightBound = 0;
+    if (op == BOOLEAN_DIFFERENCE) {
+        subjectRight = (int64_t)sbox.right * ((int64_t)1 << m_shift);
+    } else if (op == BOOLEAN_INTERSECTION) {
+        rightBound = (int64_t)std::min(sbox.right, cbox.right) * ((int64_t)1 << m_shift);
+    }
+
+    while (!m_queue.empty()) {
+        SweepEvent *event = m_queue.top();
+        m_queue.pop();
+        sortedEvents.push_back(event);
+
+        // Nothing further right can make it into the result.
+        if ((op == BOOLEAN_INTERSECTION && event->point.x > rightBound) ||
+            (op == BOOLEAN_DIFFERENCE && event->point.x > subjectRight)) {
+            break;
+        }
+
+        if (event->left) {
+            SweepLine::iterator it = sweepLine.insert(event).first;
+            event->posSL = it;
+            event->inSweepLine = true;
+
+            SweepEvent *prev = (it == sweepLine.begin()) ? nullptr : *std::prev(it);
+            SweepLine::iterator nextIt = std::next(it);
+            SweepEvent *next = (nextIt == sweepLine.end()) ? nullptr : *nextIt;
+
+            ComputeFields(event, prev, op);
+
+            if (next && PossibleIntersection(event, next) == 2) {
+                ComputeFields(event, prev, op);
+                ComputeFields(next, event, op);
+            }
+
+            if (prev && PossibleIntersection(prev, event) == 2) {
+                SweepLine::iterator prevIt = prev->posSL;
+                SweepEvent *prevprev = (prevIt == sweepLine.begin()) ? nullptr : *std::prev(prevIt);
+                ComputeFields(prev, prevprev, op);
+                ComputeFields(event, prev, op);
+            }
+
+            // The segment starts on a neighbour, which has just been split
+            // there. Take it out again and let the neighbour's new right end
+            // go first, or its fields would be computed against the wrong
+            // segment.
+            if ((prev && prev->other->point == event->point) || (next && next->other->point == event->point)) {
+                sweepLine.erase(it);
+                event->inSweepLine = false;
+                sortedEvents.pop_back();
+                m_queue.push(event);
+            }
+        } else {
+            SweepEvent *left = event->other;
+            if (!left->inSweepLine) {
+                continue;
+            }
+
+            SweepLine::iterator it = left->posSL;
+            SweepEvent *prev = (it == sweepLine.begin()) ? nullptr : *std::prev(it);
+            SweepLine::iterator nextIt = std::next(it);
+            SweepEvent *next = (nextIt == sweepLine.end()) ? nullptr : *nextIt;
+
+            sweepLine.erase(it);
+            left->inSweepLine = false;
+
+            if (prev && next) {
+                PossibleIntersection(prev, next);
+            }
+        }
+    }
+
+    *result = ConnectEdges(sortedEvents, op);
+    return true;
+}
+
+// Whether the region right above a result edge is in the result.
+bool BooleanEngine::ResultAbove(const SweepEvent *event, BooleanOp op) {
+    bool thisIn = !event->inOut;
+    bool thatIn = !event->otherInOut;
+    if (event->type == EDGE_SAME_TRANSITION) {
+        thatIn = thisIn;
+    } else if (event->type == EDGE_DIFFERENT_TRANSITION) {
+        thatIn = !thisIn;
+    }
+
+    switch (op) {
+        case BOOLEAN_UNION:
+            return thisIn || thatIn;
+        case BOOLEAN_INTERSECTION:
+            return thisIn && thatIn;
+        case BOOLEAN_DIFFERENCE:
+            return event->subject ? (thisIn && !thatIn) : (thatIn && !thisIn);
+    }
+    return false;
+}
+
+//
+// Chains the result edges into contours.
+//
+// Every edge is walked with the result on its left, and at each point the walk
+// turns into the first edge clockwise from where it came from. That traces the
+// boundary of each piece of the result, and of each hole in it, as one contour
+// that never crosses the others: outer contours wind counter-clockwise and
+// holes clockwise (with y pointing up), so the result fills the same area under
+// the even-odd and the non-zero rule.
+//
+std::vector<Contour> BooleanEngine::ConnectEdges(const std::vector<SweepEvent*> &sortedEvents, BooleanOp op) {
+    std::vector<SweepEvent*> resultEvents;
+    for (SweepEvent *e : sortedEvents) {
+        if ((e->left && e->inResult) || (!e->left && e->other->inResult)) {
+            resultEvents.push_back(e);
+        }
+    }
+
+    // Segments divided after being dequeued may be out of order.
+    std::sort(resultEvents.begin(), resultEvents.end(), [](const SweepEvent *e1, const SweepEvent *e2) {
+        return CompareEvents(e1, e2) < 0;
+    });
+
+    // Point each event to the index of the other end of its segment.
+    for (size_t i = 0; i < resultEvents.size(); i++) {
+        resultEvents[i]->pos = (int)i;
+    }
+    for (SweepEvent *e : resultEvents) {
+        if (!e->left) {
+            std::swap(e->pos, e->other->pos);
+        }
+    }
+
+    // Events at the same point are adjacent; note where each run starts and
+    // which events the walk leaves their point from.
+    int n = (int)resultEvents.size();
+    std::vector<int> runStart(n);
+    std::vector<bool> outgoing(n);
+    for (int i = 0; i < n; i++) {
+        const SweepEvent *e = resultEvents[i];
+        runStart[i] = (i > 0 && resultEvents[i - 1]->point == e->point) ? runStart[i - 1] : i;
+        outgoing[i] = e->left ? ResultAbove(e, op) : !ResultAbove(e->other, op);
+    }
+
+    std::vector<bool> used(n, false);
+    std::vector<Contour> result;
+
+    for (int i = 0; i < n; i++) {
+        if (used[i] || !outgoing[i]) {
+            continue;
+        }
+
+        std::vector<Point> chain;
+        int pos = i;
+        while (pos >= 0 && !used[pos]) {
+            used[pos] = true;
+            chain.push_back(resultEvents[pos]->point);
+
+            const Point &from = resultEvents[pos]->point;
+            int at = resultEvents[pos]->pos;
+            const Point &p = resultEvents[at]->point;
+
+            // The largest counter-clockwise turn from the way back.
+            int64_t bx = from.x - p.x, by = from.y - p.y;
+            int next = -1;
+            int nextHalf = 0;
+            int64_t nx = 0, ny = 0;
+            for (int k = runStart[at]; k < n && resultEvents[k]->point == p; k++) {
+                if (used[k] || !outgoing[k]) {
+                    continue;
+                }
+                const Point &q = resultEvents[resultEvents[k]->pos]->point;
+                int64_t dx = q.x - p.x, dy = q.y - p.y;
+                int64_t cross = bx * dy - by * dx;
+                int half = (cross > 0 || (cross == 0 && bx * dx + by * dy > 0)) ? 0 : 1;
+                if (next < 0 || half > nextHalf || (half == nextHalf && nx * dy - ny * dx > 0)) {
+                    next = k;
+                    nextHalf = half;
+                    nx = dx;
+                    ny = dy;
+                }
+            }
+            pos = next;
+        }
+
+        AddLoop(chain, &result);
+    }
+
+    return result;
+}
+
+// Snaps a contour back to the input grid.
+void BooleanEngine::AddLoop(const std::vector<Point> &chain, std::vector<Contour> *result) const {
+    Contour contour;
+    for (const Point &p : chain) {
+        POINT pt = FromGrid(p);
+        if (contour.empty() || pt.x != contour.back().x || pt.y != contour.back().y) {
+            contour.push_back(pt);
+        }
+    }
+    while (contour.size() > 1 && contour.back().x == contour[0].x && contour.back().y == contour[0].y) {
+        contour.pop_back();
+    }
+
+    if (contour.size() > 2) {
+        result->push_back(contour);
+    }
+}
+
+#endif // _BOOLEAN_OPS_H_
@@ -0,0 +1,515 @@
+#ifndef _BUILTIN_SHAPE_H_
+#define _BUILTIN_SHAPE_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "shape.h"
+#include "rasterizer.h"
+#include "path_sink.h"
+#include "style.h"
+
+//
+// Storage shared by the shapes that ship with the board.
+//
+// Since the board knows their layout, hot loops may work on them directly
+// instead of going through the virtual Shape interface; see `Dragger::Drag()'
+// for instance. Shapes from other plugins keep using the interface. So that
+// both ways agree, subclasses cannot override how points are kept.
+//
+// The bounds are kept up to date as points come and go, so that they cost
+// nothing to ask for; only moving a point off the edge of the box has to
+// look at the other points again.
+//
+class BuiltinShape : public Shape {
+  public:
+    BuiltinShape(ShapeKind kind) : m_bounds(PointsExtent(m_points)) {
+        m_kind = kind;
+    }
+    virtual ~BuiltinShape() = default;
+
+    BuiltinShape(const BuiltinShape&) = delete;
+    BuiltinShape &operator=(const BuiltinShape&) = delete;
+
+    virtual const std::vector<POINT>& GetPoints() const final {
+        return m_points;
+    }
+
+    virtual void AddPoint(const POINT &pt) final {
+        m_points.push_back(pt);
+        if (!IsRingBreak(pt)) {
+            ExtendBounds(pt);
+        }
+    }
+
+    // Gives the memory of the points back, too; it is how the board pages a
+    // shape out.
+    virtual void ClearPoints() final {
+        std::vector<POINT>().swap(m_points);
+        m_bounds = PointsExtent(m_points);
+    }
+
+    virtual void SetPoint(const POINT &pt, int index) final {
+        POINT old = m_points[index];
+        m_points[index] = pt;
+        if (IsRingBreak(old) || old.x == m_bounds.left || old.x == m_bounds.right ||
+            old.y == m_bounds.top || old.y == m_bounds.bottom) {
+            m_bounds = PointsExtent(m_points);
+        } else if (!IsRingBreak(pt)) {
+            ExtendBounds(pt);
+        }
+    }
+
+    virtual RECT GetBounds() const final {
+        return m_bounds;
+    }
+
+    void Translate(LONG dx, LONG dy) {
+        for (POINT &pt : m_points) {
+            if (!IsRingBreak(pt)) {
+                pt.x += dx;
+                pt.y += dy;
+            }
+        }
+        if (!m_points.empty()) {
+            ::OffsetRect(&m_bounds, dx, dy);
+        }
+    }
+
+  protected:
+    void ExtendBounds(const POINT &pt) {
+        m_bounds.left = std::min(m_bounds.left, pt.x);
+        m_bounds.top = std::min(m_bounds.top, pt.y);
+        m_bounds.right = std::max(m_bounds.right, pt.x);
+        m_bounds.bottom = std::max(m_bounds.bottom, pt.y);
+    }
+
+    std::vector<POINT> m_points;
+    RECT m_bounds;  // see `Shape::GetBounds()'
+};
+
+// Fills `bounds' with the bounds of `count' shapes, e.g. to cull or hit-test
+// them against a dense array. Built-in shapes are read without a virtual call.
+void GetShapeBounds(const Shape *const *shapes, size_t count, RECT *bounds) {
+    for (size_t i = 0; i < count; i++) {
+        if (shapes[i]->GetKind() != SHAPE_CUSTOM) {
+            bounds[i] = static_cast<const BuiltinShape*>(shapes[i])->BuiltinShape::GetBounds();
+        } else {
+            bounds[i] = shapes[i]->GetBounds();
+        }
+    }
+}
+
+//
+// Geometry of the built-in shapes, resolved at compile time.
+//
+// Both the plugins and the board's fast paths go through these, so there is
+// a single definition of what each shape looks like. `Contains()' takes the
+// bounds of the points along with them, as `Shape::GetBounds()' has them.
+//
+template <ShapeKind KIND>
+struct BuiltinGeometry;
+
+template <>
+struct BuiltinGeometry<SHAPE_RECTANGLE> {
+    static bool Contains(const std::vector<POINT> &points, const RECT &bounds, const POINT &pt) {
+        return (pt.x > bounds.left && pt.x < bounds.right && pt.y > bounds.top && pt.y < bounds.bottom);
+    }
+
+    static void GetOutlines(const std::vector<POINT> &points, std::vector<Outline> *outlines) {
+        outlines->push_back(Outline(4));
+        Outline &outline = outlines->back();
+        outline[0].x = (FLOAT)points[0].x; outline[0].y = (FLOAT)points[0].y;
+        outline[1].x = (FLOAT)points[1].x; outline[1].y = (FLOAT)points[0].y;
+        outline[2].x = (FLOAT)points[1].x; outline[2].y = (FLOAT)points[1].y;
+        outline[3].x = (FLOAT)points[0].x; outline[3].y = (FLOAT)points[1].y;
+    }
+
+    static void Trace(const std::vector<POINT> &points, PathSink *sink) {
+        sink->MoveTo(points[0].x, points[0].y);
+        sink->LineTo(points[1].x, points[0].y);
+        sink->LineTo(points[1].x, points[1].y);
+        sink->LineTo(points[0].x, points[1].y);
+        sink->ClosePath();
+    }
+
+    // The corners and the middle of every side.
+    static void GetAnchors(const std::vector<POINT> &points, std::vector<POINT> *anchors) {
+        LONG xs[3] = { points[0].x, (points[0].x + points[1].x) / 2, points[1].x };
+        LONG ys[3] = { points[0].y, (points[0].y + points[1].y) / 2, points[1].y };
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                if (i != 1 || j != 1) {
+                    POINT pt = { xs[i], ys[j] };
+                    anchors->push_back(pt);
+                }
+            }
+        }
+    }
+
+    static void DrawGDI(HDC hdc, const std::vector<const std::vector<POINT>*> &batch) {
+        for (const std::vector<POINT> *points : batch) {
+            ::Rectangle(hdc, (*points)[0].x, (*points)[0].y, (*points)[1].x, (*points)[1].y);
+        }
+    }
+};
+
+template <>
+struct BuiltinGeometry<SHAPE_ELLIPSE> {
+    static bool Contains(const std::vector<POINT> &points, const RECT &bounds, const POINT &pt) {
+        int left = bounds.left;
+        int right = bounds.right;
+        int top = bounds.top;
+        int bottom = bounds.bottom;
+
+        double x0 = (left + right) / 2;
+        double y0 = (top + bottom) / 2;
+        double a = (right - left) / 2;
+        double b = (bottom - top) / 2;
+
+        double c = std::pow(pt.x - x0, 2) / std::pow(a, 2) + std::pow(pt.y - y0, 2) / std::pow(b, 2);
+
+        return c < 1.0;
+    }
+
+    // A polygon that never strays more than a tenth of a pixel from the ellipse.
+    static void GetOutlines(const std::vector<POINT> &points, std::vector<Outline> *outlines) {
+        const double kPi = 3.14159265358979323846;
+
+        double cx = (points[0].x + points[1].x) / 2.0;
+        double cy = (points[0].y + points[1].y) / 2.0;
+        double a = std::abs(points[1].x - points[0].x) / 2.0;
+        double b = std::abs(points[1].y - points[0].y) / 2.0;
+
+        double r = std::max(a, b);
+        int n = 8;
+        if (r > 0.1) {
+            n = std::max(8, std::min(4096, (int)std::ceil(kPi / std::acos(1.0 - 0.1 / r))));
+        }
+
+        outlines->push_back(Outline(n));
+        Outline &outline = outlines->back();
+        for (int i = 0; i < n; i++) {
+            double t = 2 * kPi * i / n;
+            outline[i].x = (FLOAT)(cx + a * std::cos(t));
+            outline[i].y = (FLOAT)(cy + b * std::sin(t));
+        }
+    }
+
+    // Four cubic arcs, one per quadrant.
+    static void Trace(const std::vector<POINT> &points, PathSink *sink) {
+        const double kKappa = 0.5522847498307936;
+
+        double cx = (points[0].x + points[1].x) / 2.0;
+        double cy = (points[0].y + points[1].y) / 2.0;
+        double a = std::abs(points[1].x - points[0].x) / 2.0;
+        double b = std::abs(points[1].y - points[0].y) / 2.0;
+        double ka = kKappa * a, kb = kKappa * b;
+
+        sink->MoveTo(cx + a, cy);
+        sink->CurveTo(cx + a, cy + kb, cx + ka, cy + b, cx, cy + b);
+        sink->CurveTo(cx - ka, cy + b, cx - a, cy + kb, cx - a, cy);
+        sink->CurveTo(cx - a, cy - kb, cx - ka, cy - b, cx, cy - b);
+        sink->CurveTo(cx + ka, cy - b, cx + a, cy - kb, cx + a, cy);
+        sink->ClosePath();
+    }
+
+    // The center and the ends of both axes.
+    static void GetAnchors(const std::vector<POINT> &points, std::vector<POINT> *anchors) {
+        LONG cx = (points[0].x + points[1].x) / 2;
+        LONG cy = (points[0].y + points[1].y) / 2;
+        POINT pts[5] = {
+            { cx, cy }, { points[0].x, cy }, { points[1].x, cy }, { cx, points[0].y }, { cx, points[1].y }
+        };
+        anchors->insert(anchors->end(), pts, pts + 5);
+    }
+
+    static void DrawGDI(HDC hdc, const std::vector<const std::vector<POINT>*> &batch) {
+        for (const std::vector<POINT> *points : batch) {
+            ::Ellipse(hdc, (*points)[0].x, (*points)[0].y, (*points)[1].x, (*points)[1].y);
+        }
+    }
+};
+
+//
+// The points of a polygon may describe several rings, e.g. the result of a
+// boolean operation that has holes, separated by `kRingBreak'. A ring may
+// pass through any of its points more than once. `func(first, count)' is
+// called once per ring that is not empty.
+//
+template <class FUNC>
+void ForEachPolygonRing(const std::vector<POINT> &points, FUNC func) {
+    size_t start = 0, n = points.size();
+    while (start < n) {
+        size_t end = start;
+        while (end < n && !IsRingBreak(points[end])) {
+            end++;
+        }
+        if (end > start) {
+            func(&points[start], end - start);
+        }
+        start = end + 1;
+    }
+}
+
+template <>
+struct BuiltinGeometry<SHAPE_POLYGON> {
+    //
+    // https://www.eecs.umich.edu/courses/eecs380/HANDOUTS/PROJ2/InsidePoly.html
+    // https://blog.csdn.net/zsjzliziyang/article/details/108813349
+    //
+    // Even-odd over all rings. The crossing test is done on integers with the
+    // division multiplied out, so vertical edges need no special case.
+    //
+    static bool Contains(const std::vector<POINT> &points, const RECT &bounds, const POINT &pt) {
+        if (pt.x < bounds.left || pt.x > bounds.right || pt.y < bounds.top || pt.y > bounds.bottom) {
+            return false;
+        }
+
+        bool inside = false;
+        ForEachPolygonRing(points, [&](const POINT *ring, size_t n) {
+            for (size_t i = 0, j = n - 1; i < n; j = i++) {
+                const POINT &a = ring[j], &b = ring[i];
+                if ((a.y > pt.y) != (b.y > pt.y)) {
+                    int64_t lhs = (int64_t)(pt.x - a.x) * (b.y - a.y);
+                    int64_t rhs = (int64_t)(pt.y - a.y) * (b.x - a.x);
+                    if ((b.y > a.y) ? (lhs < rhs) : (lhs > rhs)) {
+                        inside = !inside;
+                    }
+                }
+            }
+        });
+        return inside;
+    }
+
+    static void GetOutlines(const std::vector<POINT> &points, std::vector<Outline> *outlines) {
+        ForEachPolygonRing(points, [&](const POINT *ring, size_t n) {
+            outlines->push_back(Outline(n));
+            Outline &outline = outlines->back();
+            for (size_t i = 0; i < n; i++) {
+                outline[i].x = (FLOAT)ring[i].x;
+                outline[i].y = (FLOAT)ring[i].y;
+            }
+        });
+    }
+
+    static void Trace(const std::vector<POINT> &points, PathSink *sink) {
+        ForEachPolygonRing(points, [&](const POINT *ring, size_t n) {
+            sink->MoveTo(ring[0].x, ring[0].y);
+            for (size_t i = 1; i < n; i++) {
+                sink->LineTo(ring[i].x, ring[i].y);
+            }
+            sink->ClosePath();
+        });
+    }
+
+    // Every vertex and the middle of every edge.
+    static void GetAnchors(const std::vector<POINT> &points, std::vector<POINT> *anchors) {
+        ForEachPolygonRing(points, [&](const POINT *ring, size_t n) {
+            for (size_t i = 0, j = n - 1; i < n; j = i++) {
+                POINT mid = { (ring[j].x + ring[i].x) / 2, (ring[j].y + ring[i].y) / 2 };
+                anchors->push_back(ring[i]);
+                anchors->push_back(mid);
+            }
+        });
+    }
+
+    // The polygons of a batch do not overlap, so one PolyPolygon call draws them all.
+    // Holes are filled by the default ALTERNATE mode.
+    static void DrawGDI(HDC hdc, const std::vector<const std::vector<POINT>*> &batch) {
+        std::vector<POINT> vertices;
+        std::vector<int> counts;
+        for (const std::vector<POINT> *points : batch) {
+            ForEachPolygonRing(*points, [&](const POINT *ring, size_t n) {
+                vertices.insert(vertices.end(), ring, ring + n);
+                counts.push_back((int)n);
+            });
+        }
+        ::PolyPolygon(hdc, vertices.data(), counts.data(), (int)counts.size());
+    }
+};
+
+// A GDI pen for the outline of `style'; the caller deletes it.
+HPEN CreateStylePen(const Style &style) {
+    if (style.strokeWidth == 0) {
+        return ::CreatePen(PS_NULL, 0, 0);
+    }
+
+    LOGBRUSH lb = { BS_SOLID, style.stroke, 0 };
+    const DashLengths &dash = kDashLengths[style.dash];
+    if (dash.off == 0.0f && style.strokeWidth == 1) {
+        return ::CreatePen(PS_SOLID, 1, style.stroke);
+    }
+    if (dash.off == 0.0f) {
+        return ::ExtCreatePen(PS_GEOMETRIC | PS_SOLID | PS_ENDCAP_SQUARE | PS_JOIN_MITER, style.strokeWidth, &lb, 0, nullptr);
+    }
+    DWORD lengths[2] = { (DWORD)(dash.on * style.strokeWidth), (DWORD)(dash.off * style.strokeWidth) };
+    return ::ExtCreatePen(PS_GEOMETRIC | PS_USERSTYLE | PS_ENDCAP_FLAT | PS_JOIN_MITER, style.strokeWidth, &lb, 2, lengths);
+}
+
+// See `Painter::DrawBatch()'. GDI has no translucency, so `style.opacity'
+// only takes effect when the shapes can be rasterized directly.
+//
+// The shapes of a batch do not overlap, so shapes close to each other are
+// rasterized together, in one pass over the union of their bounds; that
+// draws the same as one pass per shape, with one setup instead of many. A
+// shape that would make a pass cover mostly empty pixels, because it lies
+// far from the shapes before it, starts a pass of its own. GDI gets the
+// whole batch in one call. Shapes large enough are rasterized on `bands'
+// if it is not null.
+template <ShapeKind KIND>
+void DrawBuiltinBatch(HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style,
+                      BandPool *bands = nullptr) {
+    PixelTarget target;
+    if (GetPixelTarget(hdc, &target)) {
+        // Area of a shape's pixels, pen included.
+        double pen = style.strokeWidth + 2.0;
+        auto area = [pen](const RECT &r) {
+            return ((double)r.right - r.left + pen) * ((double)r.bottom - r.top + pen);
+        };
+
+        std::vector<Outline> outlines;
+        RECT group = { 0, 0, 0, 0 };
+        double groupArea = 0.0;  // of the shapes in it, not of `group'
+        for (const std::vector<POINT> *points : batch) {
+            RECT extent = PointsExtent(*points);
+            if (!outlines.empty()) {
+                RECT merged = { std::min(group.left, extent.left), std::min(group.top, extent.top),
+                                std::max(group.right, extent.right), std::max(group.bottom, extent.bottom) };
+                if (area(merged) > 2.0 * (groupArea + area(extent))) {
+                    DrawOutlinesAA(target, outlines, style, bands);
+                    outlines.clear();
+                } else {
+                    group = merged;
+                    groupArea += area(extent);
+                }
+            }
+            if (outlines.empty()) {
+                group = extent;
+                groupArea = area(extent);
+            }
+            BuiltinGeometry<KIND>::GetOutlines(*points, &outlines);
+        }
+        if (!outlines.empty()) {
+            DrawOutlinesAA(target, outlines, style, bands);
+        }
+        return;
+    }
+
+    HPEN hPen = CreateStylePen(style);
+    HGDIOBJ hOldPen = ::SelectObject(hdc, hPen);
+    ::SelectObject(hdc, ::GetStockObject(DC_BRUSH));
+    ::SetDCBrushColor(hdc, style.fill);
+    BuiltinGeometry<KIND>::DrawGDI(hdc, batch);
+    ::SelectObject(hdc, hOldPen);
+    ::DeleteObject(hPen);
+}
+
+// Statically dispatched counterparts of `Shape::Contains()' and
+// `Painter::DrawBatch()'. They return false for shapes that are not built in.
+
+bool BuiltinContains(ShapeKind kind, const std::vector<POINT> &points, const RECT &bounds, const POINT &pt, bool *contains) {
+    switch (kind) {
+        case SHAPE_RECTANGLE:
+            *contains = BuiltinGeometry<SHAPE_RECTANGLE>::Contains(points, bounds, pt);
+            return true;
+        case SHAPE_ELLIPSE:
+            *contains = BuiltinGeometry<SHAPE_ELLIPSE>::Contains(points, bounds, pt);
+            return true;
+        case SHAPE_POLYGON:
+            *contains = BuiltinGeometry<SHAPE_POLYGON>::Contains(points, bounds, pt);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool BuiltinDrawBatch(ShapeKind kind, HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style,
+                      BandPool *bands = nullptr) {
+    switch (kind) {
+        case SHAPE_RECTANGLE:
+            DrawBuiltinBatch<SHAPE_RECTANGLE>(hdc, batch, style, bands);
+            return true;
+        case SHAPE_ELLIPSE:
+            DrawBuiltinBatch<SHAPE_ELLIPSE>(hdc, batch, style, bands);
+            return true;
+        case SHAPE_POLYGON:
+            DrawBuiltinBatch<SHAPE_POLYGON>(hdc, batch, style, bands);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Statically dispatched counterpart of `Serializer::Serialize()'.
+bool BuiltinTrace(ShapeKind kind, const std::vector<POINT> &points, PathSink *sink) {
+    switch (kind) {
+        case SHAPE_RECTANGLE:
+            BuiltinGeometry<SHAPE_RECTANGLE>::Trace(points, sink);
+            return true;
+        case SHAPE_ELLIPSE:
+            BuiltinGeometry<SHAPE_ELLIPSE>::Trace(points, sink);
+            return true;
+        case SHAPE_POLYGON:
+            BuiltinGeometry<SHAPE_POLYGON>::Trace(points, sink);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The points of a shape that others snap to; shapes that are not built in
+// offer nothing but their own points.
+void GetSnapAnchors(ShapeKind kind, const std::vector<POINT> &points, std::vector<POINT> *anchors) {
+    switch (kind) {
+        case SHAPE_RECTANGLE:
+            BuiltinGeometry<SHAPE_RECTANGLE>::GetAnchors(points, anchors);
+            break;
+        case SHAPE_ELLIPSE:
+            BuiltinGeometry<SHAPE_ELLIPSE>::GetAnchors(points, anchors);
+            break;
+        case SHAPE_POLYGON:
+            BuiltinGeometry<SHAPE_POLYGON>::GetAnchors(points, anchors);
+            break;
+        default:
+            anchors->insert(anchors->end(), points.begin(), points.end());
+            break;
+    }
+}
+
+// The outline of a built-in shape as integer rings, which is what the
+// boolean operations work on; curves are flattened as for drawing.
+bool BuiltinPolygonize(ShapeKind kind, const std::vector<POINT> &points, std::vector<std::vector<POINT> > *rings) {
+    std::vector<Outline> outlines;
+    switch (kind) {
+        case SHAPE_RECTANGLE:
+            BuiltinGeometry<SHAPE_RECTANGLE>::GetOutlines(points, &outlines);
+            break;
+        case SHAPE_ELLIPSE:
+            BuiltinGeometry<SHAPE_ELLIPSE>::GetOutlines(points, &outlines);
+            break;
+        case SHAPE_POLYGON:
+            ForEachPolygonRing(points, [&](const POINT *ring, size_t n) {
+                rings->push_back(std::vector<POINT>(ring, ring + n));
+            });
+            return true;
+        default:
+            return false;
+    }
+
+    for (const Outline &outline : outlines) {
+        std::vector<POINT> ring(outline.size());
+        for (size_t i = 0; i < outline.size(); i++) {
+            ring[i].x = (LONG)std::floor(outline[i].x + 0.5f);
+            ring[i].y = (LONG)std::floor(outline[i].y + 0.5f);
+        }
+        rings->push_back(ring);
+    }
+    return true;
+}
+
+#endif // _BUILTIN_SHAPE_H_
@@ -0,0 +1,397 @@
+#ifndef _DELTA_H_
+#define _DELTA_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "style.h"
+
+//
+// Compact binary encoding of the edits that are shared between the boards of
+// a session; see sync_client.h and the SyncServer project.
+//
+// Integers are LEB128 varints, signed ones zigzag-encoded first, so a typical
+// translation takes six bytes. A shape is named by the client that created it
+// and a counter of that client, which keeps ids unique without asking the
+// server. Nothing in here touches Win32, so the server builds anywhere.
+//
+// On the wire every message is a frame: a varint byte count, then the payload.
+// Clients send batches of deltas; the server prefixes each batch with the id
+// of its sender and relays it to everyone, the sender included, in the order
+// it received them. That order is the one every board applies them in.
+//
+
+// The port of the server on the local machine.
+const unsigned short kSyncPort = 27182;
+
+enum DeltaOp {
+    DELTA_HELLO,      // server to client: the id of the client
+    DELTA_CREATE,     // a committed shape
+    DELTA_TRANSLATE,  // a shape moved by (dx, dy)
+    DELTA_RESTYLE,    // a new style
+    DELTA_REMOVE,     // a shape that is gone
+};
+
+struct ShapeId {
+    uint32_t client;
+    uint32_t serial;
+
+    bool operator==(const ShapeId &other) const {
+        return client == other.client && serial == other.serial;
+    }
+
+    uint64_t Key() const {
+        return ((uint64_t)client << 32) | serial;
+    }
+};
+
+struct DeltaPoint {
+    int32_t x, y;
+};
+
+struct Delta {
+    DeltaOp op;
+    ShapeId shape;
+    uint32_t client;                  // DELTA_HELLO
+    std::string plugin;               // DELTA_CREATE: the `PluginName()' of the shape
+    std::vector<DeltaPoint> points;   // DELTA_CREATE
+    Style style;                      // DELTA_CREATE, DELTA_RESTYLE
+    int32_t dx, dy;                   // DELTA_TRANSLATE
+};
+
+//
+// The edits made during one frame.
+//
+// Translations of the same shape are merged, since only their sum matters;
+// everything else keeps the order it was made in.
+//
+class DeltaBatch {
+  public:
+    DeltaBatch() : m_count(0) {}
+    ~DeltaBatch() = default;
+
+    DeltaBatch(const DeltaBatch &) = delete;
+    DeltaBatch& operator=(const DeltaBatch &) = delete;
+
+    bool Empty() const {
+        return m_count == 0 && m_moves.empty();
+    }
+
+    void Create(const ShapeId &shape, const std::string &plugin, const std::vector<DeltaPoint> &points, const Style &style);
+    void Translate(const ShapeId &shape, int32_t dx, int32_t dy);
+    void Restyle(const ShapeId &shape, const Style &style);
+    void Remove(const ShapeId &shape);
+
+    // Appends the batch to `out' as one frame and starts over.
+    void Flush(std::vector<uint8_t> *out);
+
+    // The same, but as the server relays a frame from `sender'.
+    void Flush(std::vector<uint8_t> *out, uint32_t sender);
+
+  private:
+    struct Move {
+        ShapeId shape;
+        int32_t dx, dy;
+    };
+
+    void FlushMoves();
+
+    std::vector<uint8_t> m_payload;
+    std::vector<Move> m_moves;
+    size_t m_count;
+};
+
+void PutVarint(std::vector<uint8_t> *out, uint64_t v) {
+    while (v >= 0x80) {
+        out->push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out->push_back((uint8_t)v);
+}
+
+void PutSigned(std::vector<uint8_t> *out, int64_t v) {
+    PutVarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+void PutShapeId(std::vector<uint8_t> *out, const ShapeId &shape) {
+    PutVarint(out, shape.client);
+    PutVarint(out, shape.serial);
+}
+
+// Styles go out in full, since every board numbers its styles its own way.
+void PutStyle(std::vector<uint8_t> *out, const Style &style) {
+    PutVarint(out, style.fill);
+    PutVarint(out, style.stroke);
+    out->push_back(style.strokeWidth);
+    out->push_back(style.opacity);
+    out->push_back(style.dash);
+}
+
+// Appends `payload' as one frame.
+void PutFrame(std::vector<uint8_t> *out, const uint8_t *payload, size_t size) {
+    PutVarint(out, size);
+    out->insert(out->end(), payload, payload + size);
+}
+
+// Appends a frame as the server relays it: the id of the client that sent
+// `payload', or 0 for the server itself, then the payload.
+void PutRelayFrame(std::vector<uint8_t> *out, uint32_t sender, const uint8_t *payload, size_t size) {
+    std::vector<uint8_t> prefix;
+    PutVarint(&prefix, sender);
+    PutVarint(out, prefix.size() + size);
+    out->insert(out->end(), prefix.begin(), prefix.end());
+    out->insert(out->end(), payload, payload + size);
+}
+
+void PutHello(std::vector<uint8_t> *out, uint32_t client) {
+    std::vector<uint8_t> payload(1, (uint8_t)DELTA_HELLO);
+    PutVarint(&payload, client);
+    PutRelayFrame(out, 0, payload.data(), payload.size());
+}
+
+void DeltaBatch::Create(const ShapeId &shape, const std::string &plugin, const std::vector<DeltaPoint> &points, const Style &style) {
+    FlushMoves();
+    m_payload.push_back(DELTA_CREATE);
+    PutShapeId(&m_payload, shape);
+    PutVarint(&m_payload, plugin.size());
+    m_payload.insert(m_payload.end(), plugin.begin(), plugin.end());
+    PutStyle(&m_payload, style);
+
+    // Every point but the first one as an offset from the one before. Offsets
+    // wrap around like the reader's sums do, so that jumps to and from the
+    // far ends of the range, such as ring breaks, still fit in 32 bits.
+    PutVarint(&m_payload, points.size());
+    DeltaPoint prev = { 0, 0 };
+    for (const DeltaPoint &pt : points) {
+        PutSigned(&m_payload, (int32_t)((uint32_t)pt.x - (uint32_t)prev.x));
+        PutSigned(&m_payload, (int32_t)((uint32_t)pt.y - (uint32_t)prev.y));
+        prev = pt;
+    }
+    m_count++;
+}
+
+void DeltaBatch::Translate(const ShapeId &shape, int32_t dx, int32_t dy) {
+    for (Move &move : m_moves) {
+        if (move.shape == shape) {
+            move.dx += dx;
+            move.dy += dy;
+            return;
+        }
+    }
+    Move move = { shape, dx, dy };
+    m_moves.push_back(move);
+}
+
+void DeltaBatch::Restyle(const ShapeId &shape, const Style &style) {
+    FlushMoves();
+    m_payload.push_back(DELTA_RESTYLE);
+    PutShapeId(&m_payload, shape);
+    PutStyle(&m_payload, style);
+    m_count++;
+}
+
+void DeltaBatch::Remove(const ShapeId &shape) {
+    FlushMoves();
+    m_payload.push_back(DELTA_REMOVE);
+    PutShapeId(&m_payload, shape);
+    m_count++;
+}
+
+// Pending translations go out before the next edit of another kind, so that
+// a shape is never moved after it has been removed.
+void DeltaBatch::FlushMoves() {
+    for (const Move &move : m_moves) {
+        if (move.dx == 0 && move.dy == 0) {
+            continue;
+        }
+        m_payload.push_back(DELTA_TRANSLATE);
+        PutShapeId(&m_payload, move.shape);
+        PutSigned(&m_payload, move.dx);
+        PutSigned(&m_payload, move.dy);
+        m_count++;
+    }
+    m_moves.clear();
+}
+
+void DeltaBatch::Flush(std::vector<uint8_t> *out) {
+    FlushMoves();
+    if (m_count > 0) {
+        PutFrame(out, m_payload.data(), m_payload.size());
+    }
+    m_payload.clear();
+    m_count = 0;
+}
+
+void DeltaBatch::Flush(std::vector<uint8_t> *out, uint32_t sender) {
+    FlushMoves();
+    if (m_count > 0) {
+        PutRelayFrame(out, sender, m_payload.data(), m_payload.size());
+    }
+    m_payload.clear();
+    m_count = 0;
+}
+
+//
+// Reads deltas back. Every read is bounds-checked, since the bytes come
+// from the network; a malformed payload just ends the iteration.
+//
+class DeltaReader {
+  public:
+    DeltaReader(const uint8_t *data, size_t size) : m_data(data), m_end(data + size) {}
+    ~DeltaReader() = default;
+
+    DeltaReader(const DeltaReader &) = delete;
+    DeltaReader& operator=(const DeltaReader &) = delete;
+
+    bool ReadVarint(uint64_t *v);
+
+    bool ReadSigned(int64_t *v) {
+        uint64_t u;
+        if (!ReadVarint(&u)) {
+            return false;
+        }
+        *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+        return true;
+    }
+
+    // Returns false at the end of the payload or on malformed input.
+    bool Next(Delta *delta);
+
+  private:
+    bool ReadUint32(uint32_t *v) {
+        uint64_t u;
+        if (!ReadVarint(&u) || u > 0xFFFFFFFFu) {
+            return false;
+        }
+        *v = (uint32_t)u;
+        return true;
+    }
+
+    bool ReadInt32(int32_t *v) {
+        int64_t s;
+        if (!ReadSigned(&s) || s < INT32_MIN || s > INT32_MAX) {
+            return false;
+        }
+        *v = (int32_t)s;
+        return true;
+    }
+
+    bool ReadShapeId(ShapeId *shape) {
+        return ReadUint32(&shape->client) && ReadUint32(&shape->serial);
+    }
+
+    bool ReadStyle(Style *style) {
+        if (!ReadUint32(&style->fill) || !ReadUint32(&style->stroke) || m_end - m_data < 3 || m_data[2] >= DASH_COUNT) {
+            return false;
+        }
+        style->strokeWidth = m_data[0];
+        style->opacity = m_data[1];
+        style->dash = m_data[2];
+        m_data += 3;
+        return true;
+    }
+
+    const uint8_t *m_data, *m_end;
+};
+
+bool DeltaReader::ReadVarint(uint64_t *v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (m_data == m_end) {
+            return false;
+        }
+        uint8_t byte = *m_data++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeltaReader::Next(Delta *delta) {
+    if (m_data == m_end) {
+        return false;
+    }
+
+    uint8_t op = *m_data++;
+    if (op > DELTA_REMOVE) {
+        return false;
+    }
+    delta->op = (DeltaOp)op;
+    switch (delta->op) {
+        case DELTA_HELLO:
+            return ReadUint32(&delta->client);
+
+        case DELTA_CREATE: {
+            uint64_t length, count;
+            if (!ReadShapeId(&delta->shape) || !ReadVarint(&length) || length > (uint64_t)(m_end - m_data)) {
+                return false;
+            }
+            delta->plugin.assign((const char*)m_data, (size_t)length);
+            m_data += length;
+
+            // Each point takes at least two bytes, which bounds the count before anything is allocated.
+            if (!ReadStyle(&delta->style) || !ReadVarint(&count) || count > (uint64_t)(m_end - m_data) / 2) {
+                return false;
+            }
+            delta->points.resize((size_t)count);
+            DeltaPoint prev = { 0, 0 };
+            for (DeltaPoint &pt : delta->points) {
+                int32_t dx, dy;
+                if (!ReadInt32(&dx) || !ReadInt32(&dy)) {
+                    return false;
+                }
+                pt.x = (int32_t)((uint32_t)prev.x + (uint32_t)dx);
+                pt.y = (int32_t)((uint32_t)prev.y + (uint32_t)dy);
+                prev = pt;
+            }
+            return true;
+        }
+
+        case DELTA_TRANSLATE:
+            return ReadShapeId(&delta->shape) && ReadInt32(&delta->dx) && ReadInt32(&delta->dy);
+
+        case DELTA_RESTYLE:
+            return ReadShapeId(&delta->shape) && ReadStyle(&delta->style);
+
+        case DELTA_REMOVE:
+            return ReadShapeId(&delta->shape);
+
+        default:
+            return false;
+    }
+}
+
+enum FrameStatus {
+    FRAME_INCOMPLETE,
+    FRAME_READY,
+    FRAME_CORRUPT,
+};
+
+// Looks for a complete frame at the front of `data'. When there is one, its
+// payload starts `*header' bytes in and is `*payload' bytes long.
+FrameStatus PeekFrame(const uint8_t *data, size_t size, size_t maxPayload, size_t *header, size_t *payload) {
+    DeltaReader reader(data, size);
+    uint64_t length;
+    if (!reader.ReadVarint(&length)) {
+        return (size >= 10) ? FRAME_CORRUPT : FRAME_INCOMPLETE;
+    }
+    if (length > maxPayload) {
+        return FRAME_CORRUPT;
+    }
+
+    *header = 1;
+    while (data[*header - 1] & 0x80) {
+        (*header)++;
+    }
+    if (size - *header < length) {
+        return FRAME_INCOMPLETE;
+    }
+    *payload = (size_t)length;
+    return FRAME_READY;
+}
+
+#endif // _DELTA_H_
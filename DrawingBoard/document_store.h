@@ -0,0 +1,364 @@
+#ifndef _DOCUMENT_STORE_H_
+#define _DOCUMENT_STORE_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "delta.h"
+#include "worker_pool.h"
+
+// The points of a shared shape, as a `DocumentStore' keeps them.
+struct StoredShape {
+    ShapeId id;
+    uint32_t serial;  // of the record; see `DocumentStore'
+    std::vector<POINT> points;
+};
+
+//
+// Points of shapes, kept on disk and grouped by region, for boards too large
+// to keep in memory.
+//
+// The board is cut into square tiles, and a shape goes with the tile that
+// holds the center of its bounds. Every write to a tile appends one block of
+// records to the file, and reading a tile back takes one read per block, so
+// shapes that are close to each other are paged in and out together. Only
+// where the blocks of each tile are stays in memory, a few dozen bytes per
+// tile however many shapes it holds.
+//
+// Records are never changed. Their owner numbers every record it writes and
+// knows which one is current for each of its shapes; the others are skipped
+// by whoever reads them. It tells the store how many records of a tile have
+// stopped being current through `Discard()', and a tile without any current
+// records is forgotten; its blocks are left where they are in the file,
+// which lives no longer than the store. Readers of older records, e.g. an
+// export of an earlier snapshot of the board, keep every tile around for as
+// long as they hold a `Pin()'.
+//
+// The methods may be called from any thread. Reads and writes hold a lock
+// for as long as the disk takes, so they belong on a worker; see `PageJob'.
+//
+class DocumentStore {
+  public:
+    // Tiles are this many pixels on a side.
+    static const int kTileShift = 11;
+
+    // Takes over `file', which has to be open for reading and writing, e.g.
+    // a temporary file that is deleted once closed.
+    DocumentStore(FILE *file) : m_file(file), m_size(0), m_current(0), m_pins(0) {}
+    ~DocumentStore();
+
+    DocumentStore(const DocumentStore &) = delete;
+    DocumentStore& operator=(const DocumentStore &) = delete;
+
+    static uint64_t TileOf(const RECT &bounds);
+
+    // Calls `func(tile)' for every tile that `rect' touches.
+    template <class FUNC>
+    static void ForEachTile(const RECT &rect, FUNC func);
+
+    // Appends the records of `shapes' to `tile' in one block. Returns false
+    // if they could not be written, and then none of them is current.
+    bool Write(uint64_t tile, const std::vector<StoredShape> &shapes);
+
+    // Appends every record of `tile' to `shapes', current or not. Returns
+    // false if the file cannot be read back.
+    bool Read(uint64_t tile, std::vector<StoredShape> *shapes) const;
+
+    // `count' records of `tile' are no longer current.
+    void Discard(uint64_t tile, size_t count);
+
+    // While pinned, no tile is forgotten.
+    void Pin();
+    void Unpin();
+
+    // Bytes written so far, and records that are current.
+    uint64_t GetFileSize() const;
+    size_t GetCurrentCount() const;
+
+  private:
+    struct Block {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    struct Tile {
+        std::vector<Block> blocks;
+        size_t current;
+    };
+
+    bool Seek(uint64_t offset) const;
+
+    mutable std::mutex m_mutex;
+    FILE *m_file;
+    uint64_t m_size;
+    size_t m_current;
+    int m_pins;
+    std::unordered_map<uint64_t, Tile> m_tiles;
+};
+
+DocumentStore::~DocumentStore() {
+    if (m_file) {
+        std::fclose(m_file);
+    }
+}
+
+uint64_t DocumentStore::TileOf(const RECT &bounds) {
+    int64_t x = ((int64_t)bounds.left + bounds.right) / 2;
+    int64_t y = ((int64_t)bounds.top + bounds.bottom) / 2;
+    return ((uint64_t)(uint32_t)(x >> kTileShift) << 32) | (uint32_t)(y >> kTileShift);
+}
+
+template <class FUNC>
+void DocumentStore::ForEachTile(const RECT &rect, FUNC func) {
+    for (int64_t x = (int64_t)rect.left >> kTileShift; x <= (int64_t)rect.right >> kTileShift; x++) {
+        for (int64_t y = (int64_t)rect.top >> kTileShift; y <= (int64_t)rect.bottom >> kTileShift; y++) {
+            func(((uint64_t)(uint32_t)x << 32) | (uint32_t)y);
+        }
+    }
+}
+
+bool DocumentStore::Seek(uint64_t offset) const {
+#ifdef _WIN32
+    return _fseeki64(m_file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(m_file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// A record is the id, the serial, the number of points and then every point
+// as its offset from the one before, all as varints. Offsets wrap around, so
+// that ring breaks cost no more than a few bytes.
+bool DocumentStore::Write(uint64_t tile, const std::vector<StoredShape> &shapes) {
+    std::vector<uint8_t> bytes;
+    for (const StoredShape &shape : shapes) {
+        PutShapeId(&bytes, shape.id);
+        PutVarint(&bytes, shape.serial);
+        PutVarint(&bytes, shape.points.size());
+        uint64_t x = 0, y = 0;
+        for (const POINT &pt : shape.points) {
+            PutSigned(&bytes, (int64_t)((uint64_t)(int64_t)pt.x - x));
+            PutSigned(&bytes, (int64_t)((uint64_t)(int64_t)pt.y - y));
+            x = (uint64_t)(int64_t)pt.x;
+            y = (uint64_t)(int64_t)pt.y;
+        }
+    }
+    if (bytes.empty() || bytes.size() > 0xFFFFFFFFu) {
+        return bytes.empty();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file || !Seek(m_size) || std::fwrite(bytes.data(), 1, bytes.size(), m_file) != bytes.size()) {
+        return false;
+    }
+    Block block = { m_size, (uint32_t)bytes.size() };
+    m_size += bytes.size();
+    Tile &entry = m_tiles[tile];
+    entry.blocks.push_back(block);
+    entry.current += shapes.size();
+    m_current += shapes.size();
+    return true;
+}
+
+bool DocumentStore::Read(uint64_t tile, std::vector<StoredShape> *shapes) const {
+    std::vector<uint8_t> bytes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_tiles.find(tile);
+        if (it == m_tiles.end()) {
+            return true;
+        }
+        for (const Block &block : it->second.blocks) {
+            size_t start = bytes.size();
+            bytes.resize(start + block.size);
+            if (!Seek(block.offset) || std::fread(&bytes[start], 1, block.size, m_file) != block.size) {
+                return false;
+            }
+        }
+    }
+
+    DeltaReader reader(bytes.data(), bytes.size());
+    uint64_t client;
+    while (reader.ReadVarint(&client)) {
+        StoredShape shape;
+        uint64_t serial, id, count;
+        if (client > 0xFFFFFFFFu || !reader.ReadVarint(&id) || id > 0xFFFFFFFFu || !reader.ReadVarint(&serial) ||
+            serial > 0xFFFFFFFFu || !reader.ReadVarint(&count) || count > bytes.size()) {
+            return false;
+        }
+        shape.id.client = (uint32_t)client;
+        shape.id.serial = (uint32_t)id;
+        shape.serial = (uint32_t)serial;
+        shape.points.resize((size_t)count);
+        uint64_t x = 0, y = 0;
+        for (POINT &pt : shape.points) {
+            int64_t dx, dy;
+            if (!reader.ReadSigned(&dx) || !reader.ReadSigned(&dy)) {
+                return false;
+            }
+            x += (uint64_t)dx;
+            y += (uint64_t)dy;
+            pt.x = (LONG)(int64_t)x;
+            pt.y = (LONG)(int64_t)y;
+        }
+        shapes->push_back(std::move(shape));
+    }
+    return true;
+}
+
+void DocumentStore::Discard(uint64_t tile, size_t count) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_tiles.find(tile);
+    if (it == m_tiles.end()) {
+        return;
+    }
+    count = std::min(count, it->second.current);
+    it->second.current -= count;
+    m_current -= count;
+    if (it->second.current == 0 && m_pins == 0) {
+        m_tiles.erase(it);
+    }
+}
+
+void DocumentStore::Pin() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pins++;
+}
+
+void DocumentStore::Unpin() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_pins > 0) {
+        return;
+    }
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        if (it->second.current == 0) {
+            it = m_tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+uint64_t DocumentStore::GetFileSize() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+size_t DocumentStore::GetCurrentCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current;
+}
+
+//
+// Reads or writes whole tiles of a `DocumentStore' on the worker pool.
+//
+// Tiles to write are given with their records, which the job owns; tiles to
+// read come back with all of their records. Either way every tile is one
+// step, and `Succeeded()' tells whether it made it.
+//
+class PageJob : public Job {
+  public:
+    struct Page {
+        uint64_t tile;
+        std::vector<StoredShape> shapes;
+    };
+
+    PageJob(DocumentStore *store, std::vector<Page> &pages, bool write)
+        : Job(pages.size()), m_store(store), m_write(write), m_ok(pages.size(), 0) {
+        m_pages.swap(pages);
+    }
+    virtual ~PageJob() = default;
+
+    bool IsWrite() const {
+        return m_write;
+    }
+
+    // Complete once the job has finished without being cancelled.
+    std::vector<Page> &GetPages() {
+        return m_pages;
+    }
+
+    bool Succeeded(size_t page) const {
+        return m_ok[page] != 0;
+    }
+
+  protected:
+    virtual void Run(size_t begin, size_t end) override {
+        for (size_t i = begin; i < end; i++) {
+            Page &page = m_pages[i];
+            if (m_write) {
+                m_ok[i] = m_store->Write(page.tile, page.shapes);
+            } else {
+                m_ok[i] = m_store->Read(page.tile, &page.shapes);
+            }
+        }
+    }
+
+  private:
+    DocumentStore *m_store;
+    bool m_write;
+    std::vector<Page> m_pages;
+    std::vector<char> m_ok;
+};
+
+//
+// Looks up the records of paged out shapes, keeping the last few tiles it
+// has read in memory; for exports, which need every shape of the board but
+// should not bring the whole board back in at once.
+//
+class TileCache {
+  public:
+    static const size_t kTiles = 16;
+
+    TileCache(const DocumentStore *store) : m_store(store) {}
+
+    TileCache(const TileCache &) = delete;
+    TileCache& operator=(const TileCache &) = delete;
+
+    // The points of record `serial' in `tile', or null if there is none.
+    const std::vector<POINT> *Find(uint64_t tile, uint32_t serial);
+
+  private:
+    struct Entry {
+        uint64_t tile;
+        std::unordered_map<uint32_t, std::vector<POINT> > points;  // by serial
+    };
+
+    const DocumentStore *m_store;
+    std::list<Entry> m_entries;  // the most recently used first
+};
+
+const std::vector<POINT> *TileCache::Find(uint64_t tile, uint32_t serial) {
+    auto it = m_entries.begin();
+    while (it != m_entries.end() && it->tile != tile) {
+        ++it;
+    }
+    if (it != m_entries.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+    } else {
+        std::vector<StoredShape> shapes;
+        if (!m_store || !m_store->Read(tile, &shapes)) {
+            return nullptr;
+        }
+        if (m_entries.size() == kTiles) {
+            m_entries.pop_back();
+        }
+        m_entries.push_front(Entry());
+        m_entries.front().tile = tile;
+        for (StoredShape &shape : shapes) {
+            m_entries.front().points[shape.serial].swap(shape.points);
+        }
+    }
+
+    auto found = m_entries.front().points.find(serial);
+    return (found != m_entries.front().points.end()) ? &found->second : nullptr;
+}
+
+#endif // _DOCUMENT_STORE_H_
@@ -1,7 +1,8 @@
 #ifndef _DRAGGER_H_
 #define _DRAGGER_H_
 
-#include "shape.h"
+#include "builtin_shape.h"
+#include "snap_index.h"
 
 class Dragger {
   public:
@@ -15,18 +16,45 @@ class Dragger {
         m_start = pt;
     }
 
-    void Drag(Shape *shape, const POINT &pt);
+    // With an index, the shape is nudged so that the nearest of its anchors
+    // lands on an anchor of some other shape, if one is within reach.
+    // Returns how far the shape has moved.
+    POINT Drag(Shape *shape, const POINT &pt, const SnapIndex *index = nullptr);
+
+    static void Translate(Shape *shape, int dx, int dy);
 
   private:
+    void Snap(const Shape *shape, const SnapIndex *index, int *dx, int *dy);
+
     POINT m_start;
+    std::vector<POINT> m_anchors;
 };
 
-void Dragger::Drag(Shape *shape, const POINT &pt) {
+POINT Dragger::Drag(Shape *shape, const POINT &pt, const SnapIndex *index) {
     int dx = pt.x - m_start.x;
     int dy = pt.y - m_start.y;
 
-    // update m_start.
-    m_start = pt;
+    if (index) {
+        Snap(shape, index, &dx, &dy);
+    }
+
+    // update m_start; it follows the shape, so a snap does not build up over several moves.
+    m_start.x += dx;
+    m_start.y += dy;
+
+    Translate(shape, dx, dy);
+
+    POINT offset = { dx, dy };
+    return offset;
+}
+
+void Dragger::Translate(Shape *shape, int dx, int dy) {
+    // Built-in shapes share a known layout, so their points can be moved in one
+    // tight loop rather than through a virtual call per point.
+    if (shape->GetKind() != SHAPE_CUSTOM) {
+        static_cast<BuiltinShape*>(shape)->Translate(dx, dy);
+        return;
+    }
 
     const std::vector<POINT>  &points = shape->GetPoints();
     for (size_t i = 0; i < points.size(); i++) {
@@ -35,5 +63,25 @@ void Dragger::Drag(Shape *shape, const POINT &pt) {
     }
 }
 
+void Dragger::Snap(const Shape *shape, const SnapIndex *index, int *dx, int *dy) {
+    m_anchors.clear();
+    GetSnapAnchors(shape->GetKind(), shape->GetPoints(), &m_anchors);
+
+    int64_t best = INT64_MAX;
+    int sx = 0, sy = 0;
+    for (const POINT &anchor : m_anchors) {
+        POINT moved = { anchor.x + *dx, anchor.y + *dy }, hit;
+        if (index->Snap(moved, shape, &hit)) {
+            int64_t ex = hit.x - moved.x, ey = hit.y - moved.y;
+            if (ex * ex + ey * ey < best) {
+                best = ex * ex + ey * ey;
+                sx = (int)ex;
+                sy = (int)ey;
+            }
+        }
+    }
+    *dx += sx;
+    *dy += sy;
+}
 
 #endif // _DRAGGER_H_
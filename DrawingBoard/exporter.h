@@ -0,0 +1,176 @@
+#ifndef _EXPORTER_H_
+#define _EXPORTER_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "builtin_shape.h"
+#include "document_store.h"
+#include "scene.h"
+#include "serializer.h"
+#include "style.h"
+#include "vector_writer.h"
+#include "worker_pool.h"
+
+// Serializers of the plugins that provide one, by the painter of their shapes.
+typedef std::map<const Painter*, const Serializer*> SerializerMap;
+
+// Whether `item' has any points, here or paged out.
+bool HasPoints(const SceneItem &item) {
+    return !item.points.empty() || item.serial != 0;
+}
+
+// The points of `item', looked up in `cache' if they are paged out; null if
+// there are none.
+const std::vector<POINT> *GetItemPoints(const SceneItem &item, TileCache *cache, std::vector<POINT> *moved) {
+    if (item.serial == 0) {
+        return &item.points;
+    }
+    const std::vector<POINT> *stored = cache->Find(item.tile, item.serial);
+    if (!stored) {
+        return nullptr;
+    }
+    *moved = *stored;
+    for (POINT &pt : *moved) {
+        if (!IsRingBreak(pt)) {
+            pt.x += item.offset.x;
+            pt.y += item.offset.y;
+        }
+    }
+    return moved;
+}
+
+//
+// Writes the board out, bottom to top, one shape at a time, onto a page of
+// the given size.
+//
+// Built-in shapes are traced directly; other shapes go through the serializer
+// of their plugin, or are exported as the polygon through their points. The
+// points of shapes that are paged out are read back from `store' a tile at
+// a time.
+//
+bool WriteScene(const Scene &scene, const StyleTable &styles, const SerializerMap &serializers,
+                LONG width, LONG height, VectorWriter *writer, const DocumentStore *store = nullptr) {
+    TileCache cache(store);
+    std::vector<POINT> moved;
+    writer->Begin(width, height);
+    scene.ForEach([&](const SceneItem &item) {
+        const std::vector<POINT> *points = GetItemPoints(item, &cache, &moved);
+        if (!points || points->empty()) {
+            return;
+        }
+
+        writer->BeginShape(styles.Get(item.style));
+        if (!BuiltinTrace(item.kind, *points, writer)) {
+            SerializerMap::const_iterator it = serializers.find(item.painter);
+            if (it != serializers.end()) {
+                it->second->Serialize(*points, writer);
+            } else {
+                BuiltinGeometry<SHAPE_POLYGON>::Trace(*points, writer);
+            }
+        }
+        writer->EndShape();
+    });
+    return writer->End();
+}
+
+// Writes the board out onto a page that just covers it.
+bool ExportScene(const Scene &scene, const StyleTable &styles, const SerializerMap &serializers, VectorWriter *writer,
+                 const DocumentStore *store = nullptr) {
+    LONG width = 1, height = 1;
+    scene.ForEach([&](const SceneItem &item) {
+        if (HasPoints(item)) {
+            width = std::max(width, item.bounds.right);
+            height = std::max(height, item.bounds.bottom);
+        }
+    });
+    return WriteScene(scene, styles, serializers, width, height, writer, store);
+}
+
+//
+// `ExportScene()' as a `WorkerPool' job, for a snapshot of the board.
+//
+// The extents of the board are gathered in parallel; the worker that gets
+// the last of them then writes the file. The job owns the writer and `file',
+// which `Close()' closes once the job is done.
+//
+// A file that was not written out completely is deleted rather than left
+// behind truncated; that includes a job that was cancelled, or whose pool
+// was shut down, before it got to write anything.
+//
+// `store', if any, is pinned for as long as the job lives, so that the
+// records of the snapshot stay in it; see `DocumentStore::Pin()'.
+//
+class ExportJob : public Job {
+  public:
+    ExportJob(const Scene &scene, const StyleTable *styles, const SerializerMap &serializers,
+              VectorWriter *writer, FILE *file, const std::wstring &path, DocumentStore *store = nullptr)
+        : Job(scene.Size()), m_scene(scene), m_styles(styles), m_serializers(serializers), m_writer(writer),
+          m_file(file), m_path(path), m_store(store), m_width(1), m_height(1), m_ok(false) {
+        if (m_store) {
+            m_store->Pin();
+        }
+    }
+
+    virtual ~ExportJob() {
+        Close();
+        if (m_store) {
+            m_store->Unpin();
+        }
+    }
+
+    // Returns false if the file could not be written out completely, and
+    // then deletes it.
+    bool Close() {
+        m_writer.reset();
+        if (m_file) {
+            m_ok = (std::fclose(m_file) == 0) && m_ok;
+            m_file = nullptr;
+            if (!m_ok) {
+                ::DeleteFileW(m_path.c_str());
+            }
+        }
+        return m_ok;
+    }
+
+  protected:
+    virtual void Run(size_t begin, size_t end) override {
+        LONG width = 1, height = 1;
+        for (size_t i = begin; i < end; i++) {
+            const SceneItem &item = m_scene[i];
+            if (HasPoints(item)) {
+                width = std::max(width, item.bounds.right);
+                height = std::max(height, item.bounds.bottom);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_width = std::max(m_width, width);
+        m_height = std::max(m_height, height);
+    }
+
+    virtual void Finish() override {
+        m_ok = WriteScene(m_scene, *m_styles, m_serializers, m_width, m_height, m_writer.get(), m_store);
+    }
+
+  private:
+    Scene m_scene;
+    const StyleTable *m_styles;
+    SerializerMap m_serializers;
+    std::unique_ptr<VectorWriter> m_writer;
+    FILE *m_file;
+    std::wstring m_path;
+    DocumentStore *m_store;
+
+    std::mutex m_mutex;
+    LONG m_width, m_height;
+    bool m_ok;
+};
+
+#endif // _EXPORTER_H_
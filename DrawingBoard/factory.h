@@ -3,6 +3,17 @@
 
 #include "shape.h"
 #include "painter.h"
+#include "serializer.h"
+
+//
+// Plugins are built against these headers and handed objects whose layout
+// the board takes for granted, so every plugin exports `PluginAbiVersion',
+// returning the version it was built with, and the board leaves out those
+// that do not match its own. Any change to the classes a plugin derives from
+// or is handed, `Shape', `BuiltinShape', `Painter' and `Serializer' and
+// their factories, bumps it.
+//
+const int kPluginAbiVersion = 1;
 
 class ShapeFactory {
   public:
@@ -26,5 +37,16 @@ class PainterFactory {
     virtual Painter* CreatePainter() = 0;
 };
 
+class SerializerFactory {
+  public:
+    SerializerFactory() = default;
+    virtual ~SerializerFactory() = default;
+
+    SerializerFactory(const SerializerFactory &) = delete;
+    SerializerFactory& operator=(const SerializerFactory &) = delete;
+
+    virtual Serializer* CreateSerializer() = 0;
+};
+
 
 #endif // _FACTORY_H_
@@ -3,7 +3,13 @@
 // https://github.com/microsoft/Windows-classic-samples/tree/main/Samples/Win7Samples/begin/LearnWin32/DrawCircle
 
 #define NOMINMAX
+#include "sync_client.h"  // has to come before Windows.h, see sync_socket.h
 #include <Windows.h>
+#include <commdlg.h>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "base_window.h"
 #include "shape.h"
@@ -11,10 +17,107 @@
 #include "dragger.h"
 #include "factory.h"
 #include "plugin_loader.h"
+#include "renderer.h"
+#include "boolean_ops.h"
+#include "document_store.h"
+#include "exporter.h"
+#include "snap_index.h"
+#include "style.h"
+#include "worker_pool.h"
 
+typedef int (*PluginAbiVersionFn)();
 typedef const char* (*PluginNameFn)();
 typedef ShapeFactory* (*CreateShapeFactoryFn)();
 typedef PainterFactory* (*CreatePainterFactoryFn)();
+typedef SerializerFactory* (*CreateSerializerFactoryFn)();
+
+// Menu items that follow the plugins, in the order of `BooleanOp'.
+const char *g_booleanItems[] = { "union", "intersect", "difference" };
+
+// Entries of the style menu, which comes last; each one sets a single
+// property of the style that new shapes are drawn with.
+enum StyleProperty {
+    STYLE_FILL,
+    STYLE_STROKE,
+    STYLE_WIDTH,
+    STYLE_OPACITY,
+    STYLE_DASH,
+};
+
+struct StyleMenuItem {
+    const char *name;
+    StyleProperty property;
+    DWORD value;
+};
+
+const StyleMenuItem g_styleItems[] = {
+    { "white fill", STYLE_FILL, RGB(255, 255, 255) },
+    { "yellow fill", STYLE_FILL, RGB(255, 230, 120) },
+    { "blue fill", STYLE_FILL, RGB(140, 180, 255) },
+    { "black outline", STYLE_STROKE, RGB(0, 0, 0) },
+    { "gray outline", STYLE_STROKE, RGB(128, 128, 128) },
+    { "no outline", STYLE_WIDTH, 0 },
+    { "thin outline", STYLE_WIDTH, 1 },
+    { "thick outline", STYLE_WIDTH, 4 },
+    { "solid", STYLE_DASH, DASH_SOLID },
+    { "dashed", STYLE_DASH, DASH_DASHED },
+    { "dotted", STYLE_DASH, DASH_DOTTED },
+    { "opaque", STYLE_OPACITY, 255 },
+    { "translucent", STYLE_OPACITY, 128 },
+};
+
+void ApplyStyleItem(const StyleMenuItem &item, Style *style) {
+    switch (item.property) {
+        case STYLE_FILL:
+            style->fill = item.value;
+            break;
+        case STYLE_STROKE:
+            style->stroke = item.value;
+            break;
+        case STYLE_WIDTH:
+            style->strokeWidth = (uint8_t)item.value;
+            break;
+        case STYLE_OPACITY:
+            style->opacity = (uint8_t)item.value;
+            break;
+        case STYLE_DASH:
+            style->dash = (uint8_t)item.value;
+            break;
+    }
+}
+
+// How close the cursor has to get to a vertex or an edge midpoint to snap to
+// it, and the spacing of the grid that Shift snaps to, in pixels.
+const LONG kSnapRadius = 8;
+const LONG kGridSize = 10;
+
+// Edits are exchanged with the other boards of a session once per frame.
+const UINT_PTR kSyncTimer = 1;
+const UINT kSyncInterval = 16;
+
+// Beyond this many shapes from other boards in one frame, e.g. when joining
+// a session, the snap index is rebuilt in the background rather than updated
+// shape by shape.
+const size_t kBulkShapes = 256;
+
+// Posted by the worker pool when jobs have finished.
+const UINT WM_JOBS_DONE = WM_APP;
+
+// Once the points of the board take more than this many bytes, shared shapes
+// are paged out to a `DocumentStore', a tile at a time, starting with the
+// tiles that have been out of view the longest. Shapes within `kPrefetch'
+// pixels of the window are kept, or read back.
+const size_t kResidentBytes = 256 << 20;
+const LONG kPrefetch = 1024;
+
+// A shape that has been paged out; the Shape itself stays on the board with
+// no points, so that its index and id keep working.
+struct ParkedShape {
+    uint64_t tile;
+    uint32_t serial;  // of its record in the store
+    RECT bounds;      // as they would be
+    POINT offset;     // translations since it was paged out
+};
 
 PluginLoader g_pluginLoader("*");
 
@@ -30,38 +133,143 @@ class MainWindow : public BaseWindow<MainWindow> {
 
     LRESULT HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
+    // Shares the board with the other clients of the server on this machine.
+    bool JoinSession(unsigned short port);
+
+    // Of the plugins that were loaded, in the order of their menu items.
+    const std::vector<std::string>& GetPluginNames() const {
+        return m_pluginNames;
+    }
+
   private:
+    void OnCreate();
+    void OnDestroy();
     void OnPaint();
     void OnMenuCommand( WPARAM wParam, LPARAM lParam);
+    void OnStyleCommand(size_t index);
     void OnLButtonDown(int x, int y, DWORD flags);
     void OnRButtonDown(int x, int y, DWORD flags);
     void OnMouseMove(int x, int y, DWORD flags);
-    void DoubleBufferingPaint(HDC hdc, PPAINTSTRUCT ps);
+    void OnTimer();
     void Repaint();
 
-    Shape *FindShapeContainsPoint(const POINT &pt);
+    void CreateStore();
+    void UpdatePages();
+    bool IsWanted(const RECT &bounds) const;
+    void ParkShape(size_t index, uint64_t tile, uint32_t serial);
+    void OnPagesWritten(const std::shared_ptr<PageJob> &job, const Scene &scene);
+    void OnPagesRead(const std::shared_ptr<PageJob> &job);
+
+    int FindShapeContainsPoint(const POINT &pt);
+    Scene::ItemPtr MakeSceneItem(const Shape *shape, const Painter *painter, StyleId style);
+    void UpdateSceneItem(size_t index);
+    void AppendSceneItem();
+    void RebuildScene();
+
+    void SetShapeStyle(size_t index, StyleId style);
+    void RemoveShape(size_t index);
+    Painter *SharedPainter(int plugin);
+
+    void SelectOperand(const POINT &pt);
+    void ApplyBooleanOp(size_t subject, size_t clipping);
+
+    void OnExport();
+
+    POINT SnapPoint(const POINT &pt, DWORD flags) const;
+    void UpdateSnapAnchors(const Shape *shape);
+    void RebuildSnapIndex();
+    void OnSnapIndexBuilt(const std::shared_ptr<SnapIndexJob> &job);
+
+    void ShareShape(const Shape *shape, int plugin, StyleId style);
+    bool GetSharedId(const Shape *shape, ShapeId *id) const;
+    bool ApplyRemoteEdit(uint32_t sender, const Delta &delta);
 
     void SetCursorStyle(LPCWSTR lpCursorName);
 
-    BOOL m_drawing, m_dragging, m_drawMode, m_dragMode;
+    BOOL m_drawing, m_dragging, m_drawMode, m_dragMode, m_booleanMode;
+    int m_dragIndex;
+    BooleanOp m_booleanOp;
+    int m_subjectIndex;   // first operand picked in boolean mode, or -1
+    int m_polygonIndex;   // plugin whose shapes hold the results of boolean operations
+    int m_pluginIndex;    // plugin of the shape being drawn
     Shape *m_shape;
     Painter *m_painter;
     Dragger *m_dragger;
+    Renderer *m_renderer;
+    WorkerPool *m_pool;
     std::vector<Shape*> m_shapes;
     std::vector<Painter*> m_painters;
+    std::vector<StyleId> m_shapeStyles;
+    std::vector<RECT> m_shapeBounds;  // see `Shape::GetBounds()'; up to date whenever m_scene is
+    StyleTable m_styles;
+    StyleId m_drawStyle;       // of the shapes drawn from now on
+    StyleId m_selectionStyle;  // of the highlight over the selected shape
+    Scene m_scene;
     std::vector<ShapeFactory*> m_shapeFactories;
     std::vector<PainterFactory*> m_painterFactories;
+    std::vector<Serializer*> m_pluginSerializers;  // null for plugins that do not export one
+    std::vector<Painter*> m_sharedPainters;        // for shapes that were not drawn here, by plugin
+    std::vector<std::string> m_pluginNames;
+    SerializerMap m_serializers;
+    SnapIndex m_snapIndex;
+    std::vector<POINT> m_anchors;
+    std::shared_ptr<SnapIndexJob> m_snapJob;            // rebuilding the snap index, if any
+    std::unordered_map<const Shape*, bool> m_snapEdits;  // shapes updated (true) or removed since
+    bool m_snapStale;
+    size_t m_remoteCreates;                             // in the current frame
+    SyncClient m_sync;
+    std::unordered_map<const Shape*, ShapeId> m_shapeIds;
+    std::unordered_map<uint64_t, size_t> m_shapeIndices;  // of the shared shapes in m_shapes, by id
+    bool m_sceneStale;
+    std::vector<Scene::ItemPtr> m_staleItems;             // of m_scene by shape while stale; null if edited since
+    DocumentStore *m_store;                              // null unless in a session
+    std::unordered_map<const Shape*, ParkedShape> m_parked;
+    std::unordered_map<uint64_t, uint64_t> m_tileUses;   // when each tile was last in view
+    uint64_t m_pageClock;
+    uint32_t m_nextSerial;                               // of the records written to m_store
+    RECT m_wanted;                                       // the shapes that have to stay in memory
+    std::shared_ptr<PageJob> m_pageJob;                  // paging in or out, if any
+    bool m_pagesStale;
 };
 
 MainWindow::MainWindow(): m_drawing(false), m_dragging(false), m_drawMode(false),
-    m_dragMode(false), m_shape(nullptr), m_painter(nullptr), m_dragger(new Dragger) {
+    m_dragMode(false), m_booleanMode(false), m_dragIndex(-1), m_booleanOp(BOOLEAN_UNION), m_subjectIndex(-1),
+    m_polygonIndex(-1), m_pluginIndex(-1), m_shape(nullptr), m_painter(nullptr), m_dragger(new Dragger),
+    m_renderer(nullptr), m_pool(nullptr), m_drawStyle(kDefaultStyle), m_snapIndex(kSnapRadius), m_snapStale(false),
+    m_remoteCreates(0), m_sceneStale(false), m_store(nullptr), m_pageClock(0), m_nextSerial(0), m_pagesStale(false) {
+
+    ::SetRectEmpty(&m_wanted);
+
+    Style highlight = { RGB(255, 0, 0), RGB(255, 0, 0), 2, 128, DASH_SOLID };
+    m_selectionStyle = m_styles.Intern(highlight);
 
     const std::vector<HMODULE> &hModules = g_pluginLoader.GetModules();
     for (HMODULE hMod : hModules) {
+        // Built against other headers, or not a plugin at all.
+        PluginAbiVersionFn pfnPluginAbiVersion = (PluginAbiVersionFn)::GetProcAddress(hMod, "PluginAbiVersion");
+        if (!pfnPluginAbiVersion || pfnPluginAbiVersion() != kPluginAbiVersion) {
+            continue;
+        }
+
         CreateShapeFactoryFn pfnCreateShapeFactory = (CreateShapeFactoryFn)::GetProcAddress(hMod, "CreateShapeFactory");
         CreatePainterFactoryFn pfnCreatePainterFactory = (CreatePainterFactoryFn)::GetProcAddress(hMod, "CreatePainterFactory");
+        PluginNameFn pfnPluginName = (PluginNameFn)::GetProcAddress(hMod, "PluginName");
         m_shapeFactories.push_back(pfnCreateShapeFactory());
         m_painterFactories.push_back(pfnCreatePainterFactory());
+        m_sharedPainters.push_back(nullptr);
+        m_pluginNames.push_back(pfnPluginName());
+
+        // Optional; see serializer.h.
+        CreateSerializerFactoryFn pfnCreateSerializerFactory = (CreateSerializerFactoryFn)::GetProcAddress(hMod, "CreateSerializerFactory");
+        SerializerFactory *serializerFactory = pfnCreateSerializerFactory ? pfnCreateSerializerFactory() : nullptr;
+        m_pluginSerializers.push_back(serializerFactory ? serializerFactory->CreateSerializer() : nullptr);
+        delete serializerFactory;
+
+        Shape *probe = m_shapeFactories.back()->CreateShape();
+        if (probe->GetKind() == SHAPE_POLYGON && m_polygonIndex < 0) {
+            m_polygonIndex = (int)m_shapeFactories.size() - 1;
+        }
+        delete probe;
     }
 }
 
@@ -69,15 +277,25 @@ MainWindow::~MainWindow() {
     delete m_shape;
     delete m_painter;
     delete m_dragger;
+    delete m_renderer;
     m_shapes.erase(m_shapes.begin(), m_shapes.end());
     m_painters.erase(m_painters.begin(), m_painters.end());
     m_shapeFactories.erase(m_shapeFactories.begin(), m_shapeFactories.end());
     m_painterFactories.erase(m_painterFactories.begin(), m_painterFactories.end());
+    m_pluginSerializers.erase(m_pluginSerializers.begin(), m_pluginSerializers.end());
+    for (Painter *painter : m_sharedPainters) {
+        delete painter;
+    }
 }
 
 LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
+        case WM_CREATE:
+            OnCreate();
+            return 0;
+
         case WM_DESTROY:
+            OnDestroy();
             ::PostQuitMessage(0);
             return 0;
 
@@ -85,6 +303,10 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
             OnPaint();
             return 0;
 
+        case WM_SIZE:
+            UpdatePages();
+            return 0;
+
         case WM_MENUCOMMAND:
             OnMenuCommand(wParam, lParam);
             return 0;
@@ -100,59 +322,102 @@ LRESULT MainWindow::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) {
         case WM_MOUSEMOVE:
             OnMouseMove(LOWORD(lParam), HIWORD(lParam),  (DWORD)wParam);
             return 0;
+
+        case WM_TIMER:
+            if (wParam == kSyncTimer) {
+                OnTimer();
+            }
+            return 0;
+
+        case WM_JOBS_DONE:
+            if (m_pool) {
+                m_pool->DispatchCompletions();
+            }
+            return 0;
     }
     return ::DefWindowProc(m_hWnd, uMsg, wParam, lParam);
 }
 
-void MainWindow::DoubleBufferingPaint(HDC hdc, PPAINTSTRUCT ps) {
-    RECT rect;
-    HDC hdcMemDC;
-    HBITMAP hBitmap;
-
-    ::GetClientRect(m_hWnd, &rect);
-    int nWidth = rect.right - rect.left;
-    int nHeight = rect.bottom - rect.top;
-
-    hdcMemDC = ::CreateCompatibleDC(hdc);
-    hBitmap = ::CreateCompatibleBitmap(hdc, nWidth, nHeight);
+void MainWindow::OnCreate() {
+    m_renderer = new Renderer(m_hWnd, &m_styles);
+    m_pool = new WorkerPool(m_hWnd, WM_JOBS_DONE);
+}
 
-    ::SelectObject(hdcMemDC, hBitmap);
+void MainWindow::OnDestroy() {
+    if (m_sync.IsConnected()) {
+        ::KillTimer(m_hWnd, kSyncTimer);
+        m_sync.Flush();
+        m_sync.Disconnect();
+        StopSockets();
+    }
 
-    ::FillRect(hdcMemDC, &ps->rcPaint, (HBRUSH)(COLOR_WINDOW + 1));
+    // The render thread draws onto m_hWnd, and the workers post to it, so
+    // both have to stop before the window goes away.
+    delete m_renderer;
+    m_renderer = nullptr;
+    delete m_pool;
+    m_pool = nullptr;
+    m_snapJob.reset();
+    m_pageJob.reset();
+    delete m_store;
+    m_store = nullptr;
+}
 
-    for (size_t i = 0; i < m_shapes.size(); i++) {
-        m_painters[i]->Draw(hdcMemDC, m_shapes[i]->GetPoints(), m_shapes[i]->GetBrushColor());
+// Publishes a snapshot of the board to the render thread.
+void MainWindow::Repaint() {
+    if (!m_renderer) {
+        return;
     }
 
+    // m_scene is persistent, so this is a cheap copy that shares all of its nodes.
+    Scene &scene = m_renderer->BeginFrame();
+    scene = m_scene;
+
     if (m_shape && m_painter) {
-        if (m_drawing) {
-            m_painter->Draw(hdcMemDC, m_shape->GetPoints(), m_shape->GetBrushColor());
+        if (m_drawing && m_shape->GetPoints().size() > 1) {
+            scene.PushBack(MakeSceneItem(m_shape, m_painter, m_drawStyle));
         }
     }
 
-    ::BitBlt(hdc, 0, 0, nWidth, nHeight, hdcMemDC, 0, 0, SRCCOPY);
+    // The selection is not part of the board; it is highlighted by drawing
+    // the selected shape once more, on top of everything else.
+    int selected = m_dragging ? m_dragIndex : m_subjectIndex;
+    if (selected >= 0 && (size_t)selected < scene.Size()) {
+        std::shared_ptr<SceneItem> highlight = std::make_shared<SceneItem>(scene[selected]);
+        highlight->style = m_selectionStyle;
+        scene.PushBack(highlight);
+    }
 
-    ::DeleteObject(hBitmap);
-    ::DeleteDC(hdcMemDC);
-}
-
-void MainWindow::Repaint() {
-    ::InvalidateRect(m_hWnd, NULL, FALSE);
+    m_renderer->Submit();
 }
 
 void MainWindow::OnPaint() {
     PAINTSTRUCT ps;
-    HDC hdc = ::BeginPaint(m_hWnd, &ps);
-
-    DoubleBufferingPaint(hdc, &ps);
-
+    ::BeginPaint(m_hWnd, &ps);
     ::EndPaint(m_hWnd, &ps);
+
+    Repaint();
 }
 
 void MainWindow::OnMenuCommand(WPARAM wParam, LPARAM lParam) {
     HMENU hMenu = (HMENU)lParam;
-    if (hMenu == ::GetMenu(m_hWnd)) {
+    int plugins = (int)m_shapeFactories.size();
+    if (hMenu == ::GetSubMenu(::GetMenu(m_hWnd), plugins + 2 + (int)_countof(g_booleanItems))) {
+        OnStyleCommand((size_t)wParam);
+    } else if (hMenu == ::GetMenu(m_hWnd)) {
         int index = (int)wParam;
+
+        if (index == plugins + 1 + (int)_countof(g_booleanItems)) { /* export */
+            OnExport();
+            return;
+        }
+
+        if (m_subjectIndex >= 0) {
+            m_subjectIndex = -1;
+            Repaint();
+        }
+        m_booleanMode = FALSE;
+
         if (index == 0) { /* move */
             m_drawMode = FALSE;
             m_dragMode = TRUE;
@@ -160,12 +425,45 @@ void MainWindow::OnMenuCommand(WPARAM wParam, LPARAM lParam) {
             return;
         }
 
+        if (index > plugins) { /* union, intersect, difference */
+            m_drawMode = FALSE;
+            m_dragMode = FALSE;
+            m_booleanMode = TRUE;
+            m_booleanOp = (BooleanOp)(index - plugins - 1);
+            m_shape = nullptr;
+            SetCursorStyle(IDC_ARROW);
+            return;
+        }
+
         m_drawMode = TRUE;
         m_dragMode = FALSE;
         SetCursorStyle(IDC_CROSS);
 
+        m_pluginIndex = index - 1;
         m_shape = m_shapeFactories[index - 1]->CreateShape();
         m_painter = m_painterFactories[index - 1]->CreatePainter();
+        if (m_pluginSerializers[index - 1]) {
+            m_serializers[m_painter] = m_pluginSerializers[index - 1];
+        }
+    }
+}
+
+// Changes the style that new shapes are drawn with, and that of the shape
+// being moved, if any.
+void MainWindow::OnStyleCommand(size_t index) {
+    if (index >= _countof(g_styleItems)) {
+        return;
+    }
+
+    Style style = m_styles.Get(m_drawStyle);
+    ApplyStyleItem(g_styleItems[index], &style);
+    m_drawStyle = m_styles.Intern(style);
+
+    if (m_dragging && m_dragIndex >= 0) {
+        style = m_styles.Get(m_shapeStyles[m_dragIndex]);
+        ApplyStyleItem(g_styleItems[index], &style);
+        SetShapeStyle(m_dragIndex, m_styles.Intern(style));
+        Repaint();
     }
 }
 
@@ -176,50 +474,763 @@ void MainWindow::OnLButtonDown(int x, int y, DWORD flags) {
 
     if (m_drawing) {
         if (m_shape && m_painter) {
-            m_painter->StartDrawing(m_shape, pt);
+            m_painter->StartDrawing(m_shape, SnapPoint(pt, flags));
         }
     } else if (m_dragging) {
-        m_shape = FindShapeContainsPoint(pt);
+        m_dragIndex = FindShapeContainsPoint(pt);
+        m_shape = (m_dragIndex >= 0) ? m_shapes[m_dragIndex] : nullptr;
         if (m_shape) {
-            m_shape->SetBrushColor(RGB(255, 0, 0));
             m_dragger->Start(pt);
+            Repaint();
         }
+    } else if (m_booleanMode) {
+        SelectOperand(pt);
     }
 }
 
 void MainWindow::OnRButtonDown(int x, int y, DWORD flags) {
+    if (m_booleanMode && m_subjectIndex >= 0) {
+        m_subjectIndex = -1;
+        Repaint();
+    }
     if (m_shape && m_painter) {
         if (m_drawing) {
             m_shapes.push_back(m_shape);
             m_painters.push_back(m_painter);
+            m_shapeStyles.push_back(m_drawStyle);
+            m_shapeBounds.push_back(m_shape->GetBounds());
+            AppendSceneItem();
+            UpdateSnapAnchors(m_shape);
+            ShareShape(m_shape, m_pluginIndex, m_drawStyle);
             m_shape = m_shape->Reset();
         }
-        m_shape->SetBrushColor(RGB(255, 255, 255));
     }
+    bool deselect = m_dragging && m_dragIndex >= 0;
     m_drawing = FALSE;
     m_dragging = FALSE;
+    if (deselect) {
+        Repaint();
+    }
 }
 
 void MainWindow::OnMouseMove(int x, int y, DWORD flags) {
     POINT pt = { x, y };
     if (m_shape && m_painter) {
         if (m_drawing) {
-            m_painter->Update(m_shape, pt);
+            m_painter->Update(m_shape, SnapPoint(pt, flags));
         } else if (m_dragging) {
-            m_dragger->Drag(m_shape, pt);
+            POINT offset = m_dragger->Drag(m_shape, pt, &m_snapIndex);
+            UpdateSceneItem(m_dragIndex);
+            UpdateSnapAnchors(m_shape);
+
+            ShapeId id;
+            if (GetSharedId(m_shape, &id)) {
+                m_sync.Edits().Translate(id, offset.x, offset.y);
+            }
         }
         Repaint();
     }
 }
 
-Shape *MainWindow::FindShapeContainsPoint(const POINT &pt) {
-    Shape *shape = nullptr;
-    for (Shape *s : m_shapes) {
-        if (s->Contains(pt)) {
-            shape = s;
+// Hit-tests from the topmost shape down. Most shapes are ruled out by their
+// bounds in m_shapeBounds alone; only the others are looked at, and only
+// those that are not built in need a virtual call.
+int MainWindow::FindShapeContainsPoint(const POINT &pt) {
+    for (size_t i = m_shapeBounds.size(); i-- > 0;) {
+        const RECT &bounds = m_shapeBounds[i];
+        if (pt.x < bounds.left || pt.x > bounds.right || pt.y < bounds.top || pt.y > bounds.bottom) {
+            continue;
+        }
+
+        const Shape *shape = m_shapes[i];
+        if (!m_parked.empty() && m_parked.count(shape)) {
+            continue;
+        }
+        // Built-in shapes are tested without a virtual call; see `Shape::GetKind()'.
+        bool contains;
+        if (shape->GetKind() == SHAPE_CUSTOM) {
+            contains = shape->Contains(pt);
+        } else {
+            const std::vector<POINT> &points = static_cast<const BuiltinShape*>(shape)->BuiltinShape::GetPoints();
+            BuiltinContains(shape->GetKind(), points, bounds, pt, &contains);
+        }
+        if (contains) {
+            return (int)i;
         }
     }
-    return shape;
+    return -1;
+}
+
+Scene::ItemPtr MainWindow::MakeSceneItem(const Shape *shape, const Painter *painter, StyleId style) {
+    std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+    item->kind = shape->GetKind();
+    item->painter = painter;
+    item->points = shape->GetPoints();
+    item->style = style;
+    item->bounds = shape->GetBounds();
+    auto parked = m_parked.find(shape);
+    if (parked != m_parked.end()) {
+        item->bounds = parked->second.bounds;
+        item->tile = parked->second.tile;
+        item->serial = parked->second.serial;
+        item->offset = parked->second.offset;
+    }
+
+    // The pen reaches out of the shape by up to its width, and by a pixel at least.
+    LONG pen = std::max<LONG>(1, m_styles.Get(style).strokeWidth);
+    if (HasPoints(*item)) {
+        ::InflateRect(&item->bounds, pen, pen);
+    }
+    return item;
+}
+
+// Re-snapshots an edited shape; only the path to its leaf in m_scene is copied.
+// While the scene is stale, the shape is snapshotted when it is rebuilt.
+void MainWindow::UpdateSceneItem(size_t index) {
+    auto parked = m_parked.find(m_shapes[index]);
+    m_shapeBounds[index] = (parked != m_parked.end()) ? parked->second.bounds : m_shapes[index]->GetBounds();
+    if (m_sceneStale) {
+        m_staleItems[index].reset();
+    } else {
+        m_scene.Set(index, MakeSceneItem(m_shapes[index], m_painters[index], m_shapeStyles[index]));
+    }
+}
+
+// Snapshots the shape that has just been added at the end of m_shapes.
+void MainWindow::AppendSceneItem() {
+    if (m_sceneStale) {
+        m_staleItems.push_back(nullptr);
+    } else {
+        m_scene.PushBack(MakeSceneItem(m_shapes.back(), m_painters.back(), m_shapeStyles.back()));
+    }
+}
+
+// Lays the scene out again after shapes have been removed from the middle of
+// m_shapes. This stays on the UI thread: hit-testing, dragging and paging all
+// take an index into m_shapes to be one into m_scene and m_shapeBounds, so a
+// rebuild in the background would leave them to work on indices that are off
+// until it is done. It is cheap enough not to have to: the snapshots of the
+// shapes that have not changed since the last rebuild are shared rather than
+// taken again, so it is a pass over pointers, as the removal itself is, and
+// m_shapeBounds is kept up to date throughout.
+void MainWindow::RebuildScene() {
+    m_scene = Scene();
+    for (size_t i = 0; i < m_shapes.size(); i++) {
+        Scene::ItemPtr &item = m_staleItems[i];
+        m_scene.PushBack(item ? item : MakeSceneItem(m_shapes[i], m_painters[i], m_shapeStyles[i]));
+    }
+    std::vector<Scene::ItemPtr>().swap(m_staleItems);
+    m_sceneStale = false;
+}
+
+void MainWindow::SetShapeStyle(size_t index, StyleId style) {
+    m_shapeStyles[index] = style;
+    UpdateSceneItem(index);
+
+    ShapeId id;
+    if (GetSharedId(m_shapes[index], &id)) {
+        m_sync.Edits().Restyle(id, m_styles.Get(style));
+    }
+}
+
+// Deletes a committed shape; the scene has to be rebuilt afterwards.
+void MainWindow::RemoveShape(size_t index) {
+    if (!m_sceneStale) {
+        m_staleItems.reserve(m_scene.Size());
+        m_scene.ForEachItem([this](const Scene::ItemPtr &item) {
+            m_staleItems.push_back(item);
+        });
+        m_sceneStale = true;
+    }
+
+    Shape *shape = m_shapes[index];
+    if (m_shape == shape) {
+        m_shape = nullptr;
+        m_dragging = FALSE;
+    }
+    if (m_dragIndex >= (int)index) {
+        m_dragIndex = (m_dragIndex == (int)index) ? -1 : m_dragIndex - 1;
+    }
+    if (m_subjectIndex >= (int)index) {
+        m_subjectIndex = (m_subjectIndex == (int)index) ? -1 : m_subjectIndex - 1;
+    }
+
+    auto it = m_shapeIds.find(shape);
+    if (it != m_shapeIds.end()) {
+        m_shapeIndices.erase(it->second.Key());
+        m_shapeIds.erase(it);
+    }
+    // The shapes above it move down by one.
+    for (auto &entry : m_shapeIndices) {
+        if (entry.second > index) {
+            entry.second--;
+        }
+    }
+    m_snapIndex.Remove(shape);
+    if (m_snapJob) {
+        m_snapEdits[shape] = false;
+    }
+    auto parked = m_parked.find(shape);
+    if (parked != m_parked.end()) {
+        m_store->Discard(parked->second.tile, 1);
+        m_parked.erase(parked);
+    }
+
+    delete shape;
+    m_shapes.erase(m_shapes.begin() + index);
+    m_painters.erase(m_painters.begin() + index);
+    m_shapeStyles.erase(m_shapeStyles.begin() + index);
+    m_shapeBounds.erase(m_shapeBounds.begin() + index);
+    m_staleItems.erase(m_staleItems.begin() + index);
+}
+
+// One painter per plugin draws all the shapes that did not come out of the
+// user drawing them here, i.e. results of boolean operations and shapes of
+// other clients.
+Painter *MainWindow::SharedPainter(int plugin) {
+    if (!m_sharedPainters[plugin]) {
+        m_sharedPainters[plugin] = m_painterFactories[plugin]->CreatePainter();
+        if (m_pluginSerializers[plugin]) {
+            m_serializers[m_sharedPainters[plugin]] = m_pluginSerializers[plugin];
+        }
+    }
+    return m_sharedPainters[plugin];
+}
+
+// The first click picks the subject, the second one the shape it is combined with.
+void MainWindow::SelectOperand(const POINT &pt) {
+    int index = FindShapeContainsPoint(pt);
+    if (index < 0 || index == m_subjectIndex) {
+        return;
+    }
+
+    if (m_subjectIndex < 0) {
+        m_subjectIndex = index;
+    } else {
+        ApplyBooleanOp(m_subjectIndex, index);
+        m_subjectIndex = -1;
+    }
+    Repaint();
+}
+
+// Replaces both operands with a single polygon in the style of the subject,
+// which has one ring per contour of the result. Shapes that are not built in
+// are taken as the polygon through their points.
+void MainWindow::ApplyBooleanOp(size_t subject, size_t clipping) {
+    if (m_polygonIndex < 0) {
+        return;
+    }
+    StyleId style = m_shapeStyles[subject];
+
+    std::vector<Contour> operands[2];
+    const size_t indices[2] = { subject, clipping };
+    for (int k = 0; k < 2; k++) {
+        const Shape *shape = m_shapes[indices[k]];
+        if (!BuiltinPolygonize(shape->GetKind(), shape->GetPoints(), &operands[k])) {
+            operands[k].push_back(shape->GetPoints());
+        }
+    }
+
+    // Shapes too far out for the engine are left as they are.
+    BooleanEngine engine;
+    std::vector<Contour> result;
+    if (!engine.Compute(operands[0], operands[1], m_booleanOp, &result)) {
+        return;
+    }
+
+    const size_t erased[2] = { std::max(subject, clipping), std::min(subject, clipping) };
+    for (size_t index : erased) {
+        ShapeId id;
+        if (GetSharedId(m_shapes[index], &id)) {
+            m_sync.Edits().Remove(id);
+        }
+        RemoveShape(index);
+    }
+
+    if (!result.empty()) {
+        Shape *shape = m_shapeFactories[m_polygonIndex]->CreateShape();
+        for (const Contour &contour : result) {
+            if (!shape->GetPoints().empty()) {
+                shape->AddPoint(kRingBreak);
+            }
+            for (const POINT &pt : contour) {
+                shape->AddPoint(pt);
+            }
+        }
+        m_shapes.push_back(shape);
+        m_painters.push_back(SharedPainter(m_polygonIndex));
+        m_shapeStyles.push_back(style);
+        m_shapeBounds.push_back(shape->GetBounds());
+        AppendSceneItem();
+        UpdateSnapAnchors(shape);
+        ShareShape(shape, m_polygonIndex, style);
+    }
+
+    RebuildScene();
+}
+
+void MainWindow::OnExport() {
+    WCHAR path[MAX_PATH] = L"";
+    OPENFILENAMEW ofn;
+    memset(&ofn, 0, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = m_hWnd;
+    ofn.lpstrFilter = L"SVG (*.svg)\0*.svg\0PDF (*.pdf)\0*.pdf\0";
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = L"svg";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+    if (!::GetSaveFileNameW(&ofn)) {
+        return;
+    }
+
+    FILE *file = nullptr;
+    if (_wfopen_s(&file, path, L"wb") != 0 || !file) {
+        ::MessageBoxW(m_hWnd, L"Cannot open the file for writing.", L"Export", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    // The board is written out in the background, as it is now; later edits do not show up in the file.
+    bool pdf = ofn.nFileExtension != 0 && _wcsicmp(path + ofn.nFileExtension, L"pdf") == 0;
+    VectorWriter *writer = pdf ? (VectorWriter*)new PdfWriter(file) : (VectorWriter*)new SvgWriter(file);
+    std::shared_ptr<ExportJob> job = std::make_shared<ExportJob>(m_scene, &m_styles, m_serializers, writer, file, path, m_store);
+    HWND hWnd = m_hWnd;
+    m_pool->Submit(job, 4096, [hWnd, job]() {
+        if (!job->Close()) {
+            ::MessageBoxW(hWnd, L"Failed to write the file.", L"Export", MB_OK | MB_ICONERROR);
+        }
+    });
+}
+
+// Pulls `pt' onto the nearest vertex or edge midpoint of a committed shape,
+// or onto the grid while Shift is held.
+POINT MainWindow::SnapPoint(const POINT &pt, DWORD flags) const {
+    POINT snapped = pt;
+    if (flags & MK_SHIFT) {
+        snapped.x = (pt.x + kGridSize / 2) / kGridSize * kGridSize;
+        snapped.y = (pt.y + kGridSize / 2) / kGridSize * kGridSize;
+    } else {
+        m_snapIndex.Snap(pt, nullptr, &snapped);
+    }
+    return snapped;
+}
+
+void MainWindow::UpdateSnapAnchors(const Shape *shape) {
+    m_anchors.clear();
+    GetSnapAnchors(shape->GetKind(), shape->GetPoints(), &m_anchors);
+    m_snapIndex.Update(shape, m_anchors);
+    if (m_snapJob) {
+        m_snapEdits[shape] = true;
+    }
+}
+
+// Indexes the whole board on the worker pool. Snapping keeps using the old
+// index meanwhile; shapes that change before the new one is ready are noted,
+// and brought up to date once it replaces the old one.
+void MainWindow::RebuildSnapIndex() {
+    if (m_snapJob) {
+        m_snapJob->Cancel();
+    }
+    m_snapEdits.clear();
+    m_snapStale = false;
+
+    std::vector<const void*> owners(m_shapes.begin(), m_shapes.end());
+    std::shared_ptr<SnapIndexJob> job = std::make_shared<SnapIndexJob>(m_scene, owners, kSnapRadius);
+    m_snapJob = job;
+    m_pool->Submit(job, 1024, [this, job]() {
+        OnSnapIndexBuilt(job);
+    });
+}
+
+void MainWindow::OnSnapIndexBuilt(const std::shared_ptr<SnapIndexJob> &job) {
+    if (job != m_snapJob) {
+        return;  // superseded by a later rebuild
+    }
+    m_snapJob.reset();
+
+    m_snapIndex.Swap(job->GetIndex());
+    for (const auto &edit : m_snapEdits) {
+        if (edit.second) {
+            UpdateSnapAnchors(edit.first);
+        } else {
+            m_snapIndex.Remove(edit.first);
+        }
+    }
+    m_snapEdits.clear();
+}
+
+bool MainWindow::JoinSession(unsigned short port) {
+    if (!StartSockets()) {
+        return false;
+    }
+    if (!m_sync.Connect(port)) {
+        StopSockets();
+        return false;
+    }
+    ::SetTimer(m_hWnd, kSyncTimer, kSyncInterval, nullptr);
+    CreateStore();
+    return true;
+}
+
+// The store is a temporary file that goes away once closed. Without one the
+// whole board stays in memory, as it does outside of a session.
+void MainWindow::CreateStore() {
+    WCHAR dir[MAX_PATH], path[MAX_PATH];
+    FILE *file = nullptr;
+    if (::GetTempPathW(MAX_PATH, dir) == 0 || ::GetTempFileNameW(dir, L"dbd", 0, path) == 0 ||
+        _wfopen_s(&file, path, L"w+bTD") != 0 || !file) {
+        return;
+    }
+    m_store = new DocumentStore(file);
+}
+
+bool MainWindow::IsWanted(const RECT &bounds) const {
+    return bounds.right >= m_wanted.left && bounds.left <= m_wanted.right && bounds.bottom >= m_wanted.top &&
+           bounds.top <= m_wanted.bottom;
+}
+
+//
+// Keeps the shared shapes near the window in memory, and the others on disk
+// once there are too many; see `kResidentBytes'. Only one page job runs at a
+// time; whatever changes meanwhile is looked at once it is done.
+//
+// Tiles with shapes that have come into view are read back before anything
+// is paged out. The shape being drawn, moved or combined is never paged out,
+// and shapes that change while their tile is being written stay in memory.
+//
+void MainWindow::UpdatePages() {
+    if (!m_store || !m_pool) {
+        return;
+    }
+    if (m_pageJob || m_sceneStale) {
+        m_pagesStale = true;
+        return;
+    }
+    m_pagesStale = false;
+
+    ::GetClientRect(m_hWnd, &m_wanted);
+    ::InflateRect(&m_wanted, kPrefetch, kPrefetch);
+    uint64_t now = ++m_pageClock;
+    DocumentStore::ForEachTile(m_wanted, [this, now](uint64_t tile) {
+        m_tileUses[tile] = now;
+    });
+
+    std::vector<uint64_t> tiles;
+    for (const auto &entry : m_parked) {
+        if (IsWanted(entry.second.bounds)) {
+            tiles.push_back(entry.second.tile);
+        }
+    }
+    if (!tiles.empty()) {
+        std::sort(tiles.begin(), tiles.end());
+        tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+        std::vector<PageJob::Page> pages(tiles.size());
+        for (size_t i = 0; i < tiles.size(); i++) {
+            pages[i].tile = tiles[i];
+        }
+        std::shared_ptr<PageJob> job = std::make_shared<PageJob>(m_store, pages, false);
+        m_pageJob = job;
+        m_pool->Submit(job, 1, [this, job]() {
+            OnPagesRead(job);
+        });
+        return;
+    }
+
+    size_t bytes = 0;
+    for (const Shape *shape : m_shapes) {
+        bytes += shape->GetPoints().size() * sizeof(POINT);
+    }
+    if (bytes <= kResidentBytes) {
+        return;
+    }
+
+    std::unordered_map<uint64_t, std::vector<size_t> > candidates;  // by tile
+    for (const auto &entry : m_shapeIds) {
+        size_t index = m_shapeIndices[entry.second.Key()];
+        const Shape *shape = entry.first;
+        if (shape == m_shape || (int)index == m_dragIndex || (int)index == m_subjectIndex ||
+            shape->GetPoints().empty() || IsWanted(m_shapeBounds[index])) {
+            continue;
+        }
+        candidates[DocumentStore::TileOf(m_shapeBounds[index])].push_back(index);
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t> > order;  // (last use, tile)
+    for (const auto &entry : candidates) {
+        auto use = m_tileUses.find(entry.first);
+        order.push_back(std::make_pair((use != m_tileUses.end()) ? use->second : 0, entry.first));
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<PageJob::Page> pages;
+    for (size_t i = 0; i < order.size() && bytes > kResidentBytes; i++) {
+        pages.push_back(PageJob::Page());
+        PageJob::Page &page = pages.back();
+        page.tile = order[i].second;
+        for (size_t index : candidates[page.tile]) {
+            StoredShape stored;
+            stored.id = m_shapeIds[m_shapes[index]];
+            stored.serial = ++m_nextSerial;
+            stored.points = m_shapes[index]->GetPoints();
+            bytes -= stored.points.size() * sizeof(POINT);
+            page.shapes.push_back(std::move(stored));
+        }
+    }
+
+    if (pages.empty()) {
+        return;
+    }
+
+    // The snapshot tells which shapes have changed by the time the job is done.
+    std::shared_ptr<PageJob> job = std::make_shared<PageJob>(m_store, pages, true);
+    Scene scene = m_scene;
+    m_pageJob = job;
+    m_pool->Submit(job, 1, [this, job, scene]() {
+        OnPagesWritten(job, scene);
+    });
+}
+
+void MainWindow::ParkShape(size_t index, uint64_t tile, uint32_t serial) {
+    Shape *shape = m_shapes[index];
+    ParkedShape parked = { tile, serial, m_shapeBounds[index], { 0, 0 } };
+    m_parked[shape] = parked;
+    shape->ClearPoints();
+
+    m_snapIndex.Remove(shape);
+    if (m_snapJob) {
+        m_snapEdits[shape] = false;
+    }
+    UpdateSceneItem(index);
+}
+
+void MainWindow::OnPagesWritten(const std::shared_ptr<PageJob> &job, const Scene &scene) {
+    m_pageJob.reset();
+
+    std::vector<PageJob::Page> &pages = job->GetPages();
+    for (size_t p = 0; p < pages.size(); p++) {
+        if (!job->Succeeded(p)) {
+            continue;
+        }
+        for (const StoredShape &stored : pages[p].shapes) {
+            auto it = m_shapeIndices.find(stored.id.Key());
+            bool park = false;
+            if (it != m_shapeIndices.end() && !m_sceneStale) {
+                size_t index = it->second;
+                const Shape *shape = m_shapes[index];
+                park = index < scene.Size() && &m_scene[index] == &scene[index] && shape != m_shape &&
+                       (int)index != m_dragIndex && (int)index != m_subjectIndex && !m_parked.count(shape) &&
+                       !IsWanted(m_shapeBounds[index]);
+                if (park) {
+                    ParkShape(index, pages[p].tile, stored.serial);
+                }
+            }
+            if (!park) {
+                m_store->Discard(pages[p].tile, 1);
+            }
+        }
+    }
+
+    if (m_pagesStale) {
+        UpdatePages();
+    }
+}
+
+void MainWindow::OnPagesRead(const std::shared_ptr<PageJob> &job) {
+    m_pageJob.reset();
+
+    bool changed = false, ok = true;
+    std::vector<PageJob::Page> &pages = job->GetPages();
+    for (size_t p = 0; p < pages.size(); p++) {
+        if (!job->Succeeded(p)) {
+            ok = false;
+            continue;
+        }
+        for (const StoredShape &stored : pages[p].shapes) {
+            auto it = m_shapeIndices.find(stored.id.Key());
+            if (it == m_shapeIndices.end()) {
+                continue;
+            }
+            size_t index = it->second;
+            Shape *shape = m_shapes[index];
+            auto parked = m_parked.find(shape);
+            if (parked == m_parked.end() || parked->second.serial != stored.serial) {
+                continue;  // an older record
+            }
+
+            POINT offset = parked->second.offset;
+            for (POINT pt : stored.points) {
+                if (!IsRingBreak(pt)) {
+                    pt.x += offset.x;
+                    pt.y += offset.y;
+                }
+                shape->AddPoint(pt);
+            }
+            m_parked.erase(parked);
+            m_store->Discard(pages[p].tile, 1);
+
+            UpdateSnapAnchors(shape);
+            UpdateSceneItem(index);
+            changed = true;
+        }
+    }
+
+    // With the tiles in view back, the others may have to go out now.
+    if (m_pagesStale || ok) {
+        UpdatePages();
+    }
+    if (changed) {
+        Repaint();
+    }
+}
+
+// Sends the edits of the last frame and applies those of the other clients,
+// in the order the server has put them in.
+void MainWindow::OnTimer() {
+    bool changed = false;
+    m_remoteCreates = 0;
+    m_sync.Flush();
+    bool connected = m_sync.Poll([&](uint32_t sender, const Delta &delta) {
+        changed |= ApplyRemoteEdit(sender, delta);
+    });
+
+    if (m_sceneStale) {
+        RebuildScene();
+    }
+    if (m_snapStale) {
+        RebuildSnapIndex();
+    }
+    if (m_pagesStale) {
+        UpdatePages();
+    }
+    if (changed) {
+        Repaint();
+    }
+    if (!connected) {
+        ::KillTimer(m_hWnd, kSyncTimer);
+        StopSockets();
+    }
+}
+
+// Shares the shape that has just been added at the end of m_shapes.
+void MainWindow::ShareShape(const Shape *shape, int plugin, StyleId style) {
+    if (!m_sync.IsConnected() || plugin < 0) {
+        return;
+    }
+
+    ShapeId id = m_sync.NewShapeId();
+    m_shapeIds[shape] = id;
+    m_shapeIndices[id.Key()] = m_shapes.size() - 1;
+
+    const std::vector<POINT> &points = shape->GetPoints();
+    std::vector<DeltaPoint> deltaPoints(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        deltaPoints[i].x = points[i].x;
+        deltaPoints[i].y = points[i].y;
+    }
+    m_sync.Edits().Create(id, m_pluginNames[plugin], deltaPoints, m_styles.Get(style));
+}
+
+bool MainWindow::GetSharedId(const Shape *shape, ShapeId *id) const {
+    if (!m_sync.IsConnected()) {
+        return false;
+    }
+    auto it = m_shapeIds.find(shape);
+    if (it == m_shapeIds.end()) {
+        return false;
+    }
+    *id = it->second;
+    return true;
+}
+
+//
+// Every client applies every edit in the server's order, its own included,
+// so that all boards end up the same:
+//   - a shape that is already on the board is not created again;
+//   - translations add up, so one's own have been applied already and are skipped;
+//   - the last style wins, so styles are always applied;
+//   - edits to a shape that has been removed are ignored.
+//
+// Once a shape has been removed the indices in m_scene are off, so the scene
+// is left alone until `OnTimer()' rebuilds it.
+//
+bool MainWindow::ApplyRemoteEdit(uint32_t sender, const Delta &delta) {
+    if (delta.op == DELTA_CREATE) {
+        if (m_shapeIndices.count(delta.shape.Key())) {
+            return false;
+        }
+        int plugin = -1;
+        for (size_t i = 0; i < m_pluginNames.size(); i++) {
+            if (m_pluginNames[i] == delta.plugin) {
+                plugin = (int)i;
+            }
+        }
+        if (plugin < 0) {
+            return false;  // a plugin that is not installed here
+        }
+
+        Shape *shape = m_shapeFactories[plugin]->CreateShape();
+        for (const DeltaPoint &pt : delta.points) {
+            POINT point = { pt.x, pt.y };
+            shape->AddPoint(point);
+        }
+
+        m_shapes.push_back(shape);
+        m_painters.push_back(SharedPainter(plugin));
+        m_shapeStyles.push_back(m_styles.Intern(delta.style));
+        m_shapeBounds.push_back(shape->GetBounds());
+        m_shapeIds[shape] = delta.shape;
+        m_shapeIndices[delta.shape.Key()] = m_shapes.size() - 1;
+        AppendSceneItem();
+        if (++m_remoteCreates <= kBulkShapes) {
+            UpdateSnapAnchors(shape);
+        } else {
+            m_snapStale = true;
+        }
+        if (m_store) {
+            m_pagesStale = true;
+        }
+        return true;
+    }
+
+    auto it = m_shapeIndices.find(delta.shape.Key());
+    if (it == m_shapeIndices.end()) {
+        return false;
+    }
+    size_t index = it->second;
+    Shape *shape = m_shapes[index];
+
+    switch (delta.op) {
+        case DELTA_TRANSLATE:
+            if (sender == m_sync.GetClientId()) {
+                return false;
+            }
+            if (m_parked.count(shape)) {
+                // Moved along with its record once it is read back.
+                ParkedShape &parked = m_parked[shape];
+                parked.offset.x += delta.dx;
+                parked.offset.y += delta.dy;
+                ::OffsetRect(&parked.bounds, delta.dx, delta.dy);
+                m_pagesStale = true;
+            } else {
+                Dragger::Translate(shape, delta.dx, delta.dy);
+                UpdateSnapAnchors(shape);
+            }
+            break;
+
+        case DELTA_RESTYLE:
+            m_shapeStyles[index] = m_styles.Intern(delta.style);
+            break;
+
+        case DELTA_REMOVE:
+            RemoveShape(index);
+            return true;
+
+        default:
+            return false;
+    }
+
+    UpdateSceneItem(index);
+    return true;
 }
 
 void MainWindow::SetCursorStyle(LPCWSTR lpCursorName) {
@@ -234,18 +1245,32 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
         return 0;
     }
 
+    // DrawingBoard.exe -sync [port] shares the board through SyncServer.
+    if (wcsncmp(pCmdLine, L"-sync", 5) == 0) {
+        int port = _wtoi(pCmdLine + 5);
+        if (!win.JoinSession((port > 0) ? (unsigned short)port : kSyncPort)) {
+            ::MessageBoxW(win.Window(), L"Cannot reach the sync server.", L"Drawing Board", MB_OK | MB_ICONERROR);
+        }
+    }
+
     std::vector<const char*> items = { "move" };
-    const std::vector<HMODULE> &hModules = g_pluginLoader.GetModules();
-    for (HMODULE hMod : hModules) {
-        PluginNameFn pfnPluginName = (PluginNameFn)::GetProcAddress(hMod, "PluginName");
-        items.push_back(pfnPluginName());
+    for (const std::string &name : win.GetPluginNames()) {
+        items.push_back(name.c_str());
     }
+    items.insert(items.end(), std::begin(g_booleanItems), std::end(g_booleanItems));
+    items.push_back("export");
 
     HMENU hMenu = CreateMenu();
     for (auto &item : items) {
         ::AppendMenuA(hMenu, MF_STRING, (UINT_PTR)CreateMenu(), item);
     }
 
+    HMENU hStyleMenu = ::CreatePopupMenu();
+    for (const StyleMenuItem &item : g_styleItems) {
+        ::AppendMenuA(hStyleMenu, MF_STRING, 0, item.name);
+    }
+    ::AppendMenuA(hMenu, MF_POPUP, (UINT_PTR)hStyleMenu, "style");
+
     // https://www.codenong.com/7541750/
     MENUINFO mi;
     memset(&mi, 0, sizeof(mi));
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "shape.h"
+#include "style.h"
 
 class Painter {
   public:
@@ -15,11 +16,23 @@ class Painter {
     Painter(const Painter &) = delete;
     Painter& operator=(const Painter &) = delete;
 
-    virtual void Draw(HDC hdc, const std::vector<POINT> &points, COLORREF brushColor) const = 0;
+    // Draws a shape in `style'.
+    virtual void Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const = 0;
 
     virtual void StartDrawing(Shape *shape, const POINT &pt) const = 0;
 
     virtual void Update(Shape *shape, const POINT &pt) const = 0;
+
+    // Draws several shapes of the same style that do not overlap each other, so
+    // the order they are drawn in does not matter. The board selects a pen for
+    // the outline of `style' into `hdc' beforehand, for painters that outline
+    // with the DC's pen. Painters that can set up the DC once and submit all
+    // the geometry in one go should override this.
+    virtual void DrawBatch(HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style) const {
+        for (const std::vector<POINT> *points : batch) {
+            Draw(hdc, *points, style);
+        }
+    }
 };
 
 #endif // _PAINTER_H_
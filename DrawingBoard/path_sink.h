@@ -0,0 +1,27 @@
+#ifndef _PATH_SINK_H_
+#define _PATH_SINK_H_
+
+//
+// Receives the outline of a shape as a path, the way SVG and PDF describe
+// one. Coordinates are in board pixels with y pointing down.
+//
+class PathSink {
+  public:
+    PathSink() = default;
+    virtual ~PathSink() = default;
+
+    PathSink(const PathSink &) = delete;
+    PathSink& operator=(const PathSink &) = delete;
+
+    // Starts a new closed subpath.
+    virtual void MoveTo(double x, double y) = 0;
+
+    virtual void LineTo(double x, double y) = 0;
+
+    // A cubic Bezier curve from the current point to (x, y).
+    virtual void CurveTo(double x1, double y1, double x2, double y2, double x, double y) = 0;
+
+    virtual void ClosePath() = 0;
+};
+
+#endif // _PATH_SINK_H_
@@ -0,0 +1,516 @@
+#ifndef _RASTERIZER_H_
+#define _RASTERIZER_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "style.h"
+
+typedef std::vector<POINTFLOAT> Outline;
+
+// How coverage turns into ink where outlines overlap. Fills use the even-odd
+// rule, as the board does everywhere else (hit tests, GDI's ALTERNATE mode,
+// SVG and PDF); pens use nonzero, so that the overlapping pieces of a stroke
+// add up instead of cancelling out.
+enum FillRule {
+    FILL_EVENODD,
+    FILL_NONZERO,
+};
+
+//
+// Anti-aliased scanline rasterizer based on signed-area accumulation.
+//
+// Every edge deposits, for each pixel it crosses, the exact area it adds to
+// the pixels on its right; a running sum along each row then yields the
+// coverage of every pixel. Only closed outlines may be added, so each row sums
+// up to zero and rows can be resolved independently of each other.
+//
+// @see https://medium.com/@raphlinus/inside-the-fastest-font-renderer-in-the-world-75ae5270c445
+//
+class Rasterizer {
+  public:
+    // `clip' is the part of the target, in target pixels, that may be touched.
+    Rasterizer(const RECT &clip);
+    ~Rasterizer() = default;
+
+    Rasterizer(const Rasterizer &) = delete;
+    Rasterizer& operator=(const Rasterizer &) = delete;
+
+    void Clear();
+
+    // Adds the interior of a closed outline.
+    void Fill(const Outline &outline);
+
+    // Adds a line of the given width along every edge of a closed outline,
+    // broken into dashes of `dash.on' times the width if `dash.off' is not 0.
+    void Stroke(const Outline &outline, float width, const DashLengths &dash = kDashLengths[DASH_SOLID]);
+
+    // Blends `color' onto a 32bpp BGRA target, weighted by coverage times `opacity'.
+    void Composite(BYTE *bits, int stride, COLORREF color, float opacity = 1.0f, FillRule rule = FILL_EVENODD) const;
+
+  private:
+    // A quad around the part of the edge from `p' to `q' between distances
+    // `t0' and `t1' from `p'; a square end reaches half the width further.
+    void AddSegment(const POINTFLOAT &p, const POINTFLOAT &q, float len, float t0, float t1, float hw,
+                    bool squareStart, bool squareEnd);
+
+    void AddLine(POINTFLOAT p0, POINTFLOAT p1);
+
+    int m_left, m_top, m_width, m_height, m_stride;
+    std::vector<float> m_accum;
+};
+
+Rasterizer::Rasterizer(const RECT &clip) : m_left(clip.left), m_top(clip.top),
+    m_width(std::max(0, (int)(clip.right - clip.left))), m_height(std::max(0, (int)(clip.bottom - clip.top))),
+    m_stride(m_width + 2), m_accum((size_t)m_stride * m_height, 0.0f) {}
+
+void Rasterizer::Clear() {
+    std::fill(m_accum.begin(), m_accum.end(), 0.0f);
+}
+
+void Rasterizer::Fill(const Outline &outline) {
+    size_t n = outline.size();
+    for (size_t i = 0; i < n; i++) {
+        AddLine(outline[i], outline[(i + 1) % n]);
+    }
+}
+
+void Rasterizer::Stroke(const Outline &outline, float width, const DashLengths &dash) {
+    float hw = width / 2;
+    size_t n = outline.size();
+
+    // The pattern runs on across the corners, like a GDI pen's does.
+    bool on = true;
+    float left = dash.on * width;
+    for (size_t i = 0; i < n; i++) {
+        const POINTFLOAT &p = outline[i];
+        const POINTFLOAT &q = outline[(i + 1) % n];
+        float dx = q.x - p.x;
+        float dy = q.y - p.y;
+        float len = std::sqrt(dx * dx + dy * dy);
+        if (len == 0.0f) {
+            continue;
+        }
+
+        // Edges reach half the width past the vertices so that consecutive
+        // edges overlap at the joints; dashes end square with the pattern.
+        if (dash.off == 0.0f) {
+            AddSegment(p, q, len, 0.0f, len, hw, true, true);
+            continue;
+        }
+        float t = 0.0f;
+        while (t < len) {
+            float step = std::min(left, len - t);
+            if (on) {
+                AddSegment(p, q, len, t, t + step, hw, t == 0.0f, t + step == len);
+            }
+            t += step;
+            left -= step;
+            if (left <= 1e-4f) {
+                on = !on;
+                left = (on ? dash.on : dash.off) * width;
+            }
+        }
+    }
+}
+
+void Rasterizer::AddSegment(const POINTFLOAT &p, const POINTFLOAT &q, float len, float t0, float t1, float hw,
+                            bool squareStart, bool squareEnd) {
+    float ex = (q.x - p.x) / len, ey = (q.y - p.y) / len;
+    float s0 = squareStart ? t0 - hw : t0;
+    float s1 = squareEnd ? t1 + hw : t1;
+    POINTFLOAT a = { p.x + ex * s0, p.y + ey * s0 };
+    POINTFLOAT b = { p.x + ex * s1, p.y + ey * s1 };
+    float nx = -ey * hw, ny = ex * hw;
+    POINTFLOAT quad[4] = {
+        { a.x + nx, a.y + ny },
+        { b.x + nx, b.y + ny },
+        { b.x - nx, b.y - ny },
+        { a.x - nx, a.y - ny },
+    };
+    for (int j = 0; j < 4; j++) {
+        AddLine(quad[j], quad[(j + 1) % 4]);
+    }
+}
+
+void Rasterizer::AddLine(POINTFLOAT p0, POINTFLOAT p1) {
+    p0.x -= m_left; p0.y -= m_top;
+    p1.x -= m_left; p1.y -= m_top;
+
+    if (p0.y == p1.y) {
+        return;
+    }
+
+    float dir = 1.0f;
+    if (p0.y > p1.y) {
+        std::swap(p0, p1);
+        dir = -1.0f;
+    }
+
+    float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+    float x = p0.x;
+    if (p0.y < 0.0f) {
+        x -= p0.y * dxdy;
+    }
+
+    float w = (float)m_width;
+    int yEnd = std::min(m_height, (int)std::ceil(p1.y));
+    for (int y = std::max(0, (int)std::floor(p0.y)); y < yEnd; y++) {
+        float dy = std::min((float)(y + 1), p1.y) - std::max((float)y, p0.y);
+        float xnext = x + dxdy * dy;
+        float d = dy * dir;
+
+        // Whatever lies left or right of the clip still covers (or does not
+        // cover) the clip entirely, so it is enough to clamp x.
+        float x0 = std::min(std::max(std::min(x, xnext), 0.0f), w);
+        float x1 = std::min(std::max(std::max(x, xnext), 0.0f), w);
+        x = xnext;
+
+        float *row = &m_accum[(size_t)y * m_stride];
+        float x0floor = std::floor(x0);
+        int x0i = (int)x0floor;
+        float x1ceil = std::ceil(x1);
+        int x1i = (int)x1ceil;
+
+        if (x1i <= x0i + 1) {
+            float xmf = 0.5f * (x0 + x1) - x0floor;
+            row[x0i] += d - d * xmf;
+            row[x0i + 1] += d * xmf;
+        } else {
+            float s = 1.0f / (x1 - x0);
+            float x0f = x0 - x0floor;
+            float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+            float x1f = x1 - x1ceil + 1.0f;
+            float am = 0.5f * s * x1f * x1f;
+
+            row[x0i] += d * a0;
+            if (x1i == x0i + 2) {
+                row[x0i + 1] += d * (1.0f - a0 - am);
+            } else {
+                float a1 = s * (1.5f - x0f);
+                row[x0i + 1] += d * (a1 - a0);
+                for (int xi = x0i + 2; xi < x1i - 1; xi++) {
+                    row[xi] += d * s;
+                }
+                float a2 = a1 + (x1i - x0i - 3) * s;
+                row[x1i - 1] += d * (1.0f - a2 - am);
+            }
+            row[x1i] += d * am;
+        }
+    }
+}
+
+void Rasterizer::Composite(BYTE *bits, int stride, COLORREF color, float opacity, FillRule rule) const {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const bool evenOdd = (rule == FILL_EVENODD);
+    const __m128 fscale = _mm_set1_ps(256.0f * opacity);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    // BGRA source pixel widened to 16 bits, twice.
+    const __m128i src = _mm_setr_epi16(GetBValue(color), GetGValue(color), GetRValue(color), 255,
+                                       GetBValue(color), GetGValue(color), GetRValue(color), 255);
+
+    std::vector<float> coverage(m_width + 4, 0.0f);
+
+    for (int y = 0; y < m_height; y++) {
+        const float *row = &m_accum[(size_t)y * m_stride];
+        float acc = 0.0f;
+        for (int x = 0; x < m_width; x++) {
+            acc += row[x];
+            coverage[x] = acc;
+        }
+
+        BYTE *dst = bits + (ptrdiff_t)(m_top + y) * stride + (ptrdiff_t)m_left * 4;
+        int x = 0;
+        for (; x + 4 <= m_width; x += 4) {
+            // alpha = min(|coverage|, 1) * opacity * 256, where even-odd first
+            // folds the coverage into [0, 1]: 1.5 is as much as 0.5, 2 as 0.
+            __m128 c = _mm_and_ps(_mm_loadu_ps(&coverage[x]), absMask);
+            if (evenOdd) {
+                __m128 f = _mm_sub_ps(c, _mm_mul_ps(two, _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(c, half)))));
+                c = _mm_min_ps(f, _mm_sub_ps(two, f));
+            }
+            c = _mm_min_ps(c, one);
+            __m128i a = _mm_cvtps_epi32(_mm_mul_ps(c, fscale));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) == 0xffff) {
+                continue;
+            }
+
+            // Broadcast each pixel's alpha to its four channels.
+            __m128i a16 = _mm_packs_epi32(a, a);
+            __m128i a01 = _mm_unpacklo_epi16(a16, a16);
+            __m128i alo = _mm_unpacklo_epi32(a01, a01);
+            __m128i ahi = _mm_unpackhi_epi32(a01, a01);
+
+            // dst = (dst * (256 - alpha) + src * alpha) >> 8, all in unsigned 16 bits.
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + x * 4));
+            __m128i dlo = _mm_unpacklo_epi8(d, zero);
+            __m128i dhi = _mm_unpackhi_epi8(d, zero);
+            __m128i k = _mm_set1_epi16(256);
+            dlo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dlo, _mm_sub_epi16(k, alo)),
+                                               _mm_mullo_epi16(src, alo)), 8);
+            dhi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(dhi, _mm_sub_epi16(k, ahi)),
+                                               _mm_mullo_epi16(src, ahi)), 8);
+            _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(dlo, dhi));
+        }
+        for (; x < m_width; x++) {
+            float c = std::fabs(coverage[x]);
+            if (evenOdd) {
+                c = std::fmod(c, 2.0f);
+                c = std::min(c, 2.0f - c);
+            }
+            int a = (int)(std::min(c, 1.0f) * 256.0f * opacity + 0.5f);
+            if (a == 0) {
+                continue;
+            }
+            BYTE *p = dst + x * 4;
+            p[0] = (BYTE)((p[0] * (256 - a) + GetBValue(color) * a) >> 8);
+            p[1] = (BYTE)((p[1] * (256 - a) + GetGValue(color) * a) >> 8);
+            p[2] = (BYTE)((p[2] * (256 - a) + GetRValue(color) * a) >> 8);
+            p[3] = (BYTE)((p[3] * (256 - a) + 255 * a) >> 8);
+        }
+    }
+}
+
+// Rows per band; bounds the rasterizer's memory however large the target is.
+const int kBandRows = 64;
+
+// Targets with at least this many pixels are split among the threads of a
+// `BandPool', if there is one.
+const int kParallelPixels = 1 << 20;
+
+// Rasterizes every `step'-th band of `clip', starting with band `first'.
+void DrawBandsAA(const std::vector<Outline> &outlines, const Style &style, BYTE *bits, int stride,
+                 const RECT &clip, int first, int step) {
+    float opacity = style.opacity / 255.0f;
+    for (LONG top = clip.top + first * kBandRows; top < clip.bottom; top += step * kBandRows) {
+        RECT band = { clip.left, top, clip.right, std::min(clip.bottom, top + kBandRows) };
+        Rasterizer rasterizer(band);
+
+        for (const Outline &outline : outlines) {
+            rasterizer.Fill(outline);
+        }
+        rasterizer.Composite(bits, stride, style.fill, opacity);
+
+        if (style.strokeWidth > 0) {
+            rasterizer.Clear();
+            for (const Outline &outline : outlines) {
+                rasterizer.Stroke(outline, style.strokeWidth, kDashLengths[style.dash]);
+            }
+            rasterizer.Composite(bits, stride, style.stroke, opacity, FILL_NONZERO);
+        }
+    }
+}
+
+//
+// Threads that help one caller at a time rasterize a large target.
+//
+// They are started once and sleep in between, so that a draw does not pay
+// for creating threads. The caller draws a share of the bands itself and
+// returns once the workers are done with theirs.
+//
+class BandPool {
+  public:
+    // With no thread count, one for every core but the caller's.
+    BandPool(size_t nThreads = 0);
+    ~BandPool();
+
+    BandPool(const BandPool &) = delete;
+    BandPool& operator=(const BandPool &) = delete;
+
+    size_t GetThreadCount() const {
+        return m_threads.size();
+    }
+
+    // Same as `DrawBandsAA()' over all bands of `clip'. Bands do not
+    // overlap, so the threads may interleave them freely.
+    void DrawBands(const std::vector<Outline> &outlines, const Style &style, BYTE *bits, int stride, const RECT &clip);
+
+  private:
+    void Loop(int self, int step);
+
+    std::mutex m_mutex;
+    std::condition_variable m_start, m_done;
+
+    // The draw in progress, guarded by m_mutex.
+    const std::vector<Outline> *m_outlines;
+    const Style *m_style;
+    BYTE *m_bits;
+    int m_stride;
+    RECT m_clip;
+    unsigned m_generation;  // bumped by every draw
+    size_t m_running;       // workers still at it
+    bool m_quit;
+
+    std::vector<std::thread> m_threads;
+};
+
+BandPool::BandPool(size_t nThreads) : m_outlines(nullptr), m_style(nullptr), m_bits(nullptr), m_stride(0),
+    m_generation(0), m_running(0), m_quit(false) {
+
+    if (nThreads == 0) {
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    for (size_t i = 0; i < nThreads; i++) {
+        m_threads.push_back(std::thread(&BandPool::Loop, this, (int)i, (int)nThreads + 1));
+    }
+}
+
+BandPool::~BandPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_start.notify_all();
+    for (std::thread &t : m_threads) {
+        t.join();
+    }
+}
+
+void BandPool::DrawBands(const std::vector<Outline> &outlines, const Style &style, BYTE *bits, int stride,
+                         const RECT &clip) {
+    int step = (int)m_threads.size() + 1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_outlines = &outlines;
+        m_style = &style;
+        m_bits = bits;
+        m_stride = stride;
+        m_clip = clip;
+        m_running = m_threads.size();
+        m_generation++;
+    }
+    m_start.notify_all();
+
+    DrawBandsAA(outlines, style, bits, stride, clip, 0, step);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_running == 0; });
+}
+
+// Worker `self' draws the bands that follow the caller's.
+void BandPool::Loop(int self, int step) {
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_start.wait(lock, [this, seen]() { return m_quit || m_generation != seen; });
+        if (m_quit) {
+            return;
+        }
+        seen = m_generation;
+
+        const std::vector<Outline> &outlines = *m_outlines;
+        const Style &style = *m_style;
+        BYTE *bits = m_bits;
+        int stride = m_stride;
+        RECT clip = m_clip;
+        lock.unlock();
+        DrawBandsAA(outlines, style, bits, stride, clip, self + 1, step);
+        lock.lock();
+
+        if (--m_running == 0) {
+            m_done.notify_one();
+        }
+    }
+}
+
+//
+// A 32bpp BGRA bitmap in memory. `bits' points at the top row and `stride'
+// is the distance from one row to the next, negative for bottom-up bitmaps.
+//
+struct PixelTarget {
+    BYTE *bits;
+    int stride;
+    int width, height;
+};
+
+//
+// Fills and outlines closed shapes with anti-aliasing, the way GDI would with
+// a brush and a pen made after `style'.
+//
+//
+// Large targets are split among the threads of `bands' if it is not null.
+//
+void DrawOutlinesAA(const PixelTarget &target, const std::vector<Outline> &outlines, const Style &style,
+                    BandPool *bands = nullptr) {
+    // GDI puts a 1px pen on the pixels whose top-left corner is the vertex,
+    // so sample at pixel centers.
+    std::vector<Outline> shifted = outlines;
+    float left = 1e30f, top = 1e30f, right = -1e30f, bottom = -1e30f;
+    for (Outline &outline : shifted) {
+        for (POINTFLOAT &pt : outline) {
+            pt.x += 0.5f;
+            pt.y += 0.5f;
+            left = std::min(left, pt.x);
+            top = std::min(top, pt.y);
+            right = std::max(right, pt.x);
+            bottom = std::max(bottom, pt.y);
+        }
+    }
+
+    // Everything that is going to be touched, pen included. The square ends
+    // of a thick pen reach out to half the width along the diagonal.
+    LONG pen = (LONG)std::ceil(style.strokeWidth * 0.75f) + 1;
+    RECT clip;
+    clip.left = std::max(0L, (LONG)std::floor(left) - pen);
+    clip.top = std::max(0L, (LONG)std::floor(top) - pen);
+    clip.right = std::min((LONG)target.width, (LONG)std::ceil(right) + pen);
+    clip.bottom = std::min((LONG)target.height, (LONG)std::ceil(bottom) + pen);
+    if (clip.left >= clip.right || clip.top >= clip.bottom) {
+        return;
+    }
+
+    if (bands && (clip.right - clip.left) * (clip.bottom - clip.top) >= kParallelPixels) {
+        bands->DrawBands(shifted, style, target.bits, target.stride, clip);
+    } else {
+        DrawBandsAA(shifted, style, target.bits, target.stride, clip, 0, 1);
+    }
+}
+
+// The pixels of the 32bpp DIB section selected into `hdc'. Returns false if
+// there is none, so the caller can fall back on plain GDI.
+bool GetPixelTarget(HDC hdc, PixelTarget *target) {
+    HGDIOBJ hBitmap = ::GetCurrentObject(hdc, OBJ_BITMAP);
+    DIBSECTION ds;
+    if (!hBitmap || ::GetObject(hBitmap, sizeof(ds), &ds) != sizeof(ds) ||
+        ds.dsBm.bmBitsPixel != 32 || !ds.dsBm.bmBits) {
+        return false;
+    }
+
+    target->bits = (BYTE *)ds.dsBm.bmBits;
+    target->stride = (int)ds.dsBm.bmWidthBytes;
+    target->width = (int)ds.dsBm.bmWidth;
+    target->height = (int)ds.dsBm.bmHeight;
+    if (ds.dsBmih.biHeight > 0) {
+        // Bottom-up DIB, walk the rows backwards.
+        target->bits += (ptrdiff_t)(target->height - 1) * target->stride;
+        target->stride = -target->stride;
+    }
+
+    // GDI may still have drawing queued up for this bitmap.
+    ::GdiFlush();
+    return true;
+}
+
+// Only works if a 32bpp DIB section is selected into `hdc'; returns false
+// otherwise so the caller can fall back on plain GDI.
+bool DrawOutlinesAA(HDC hdc, const std::vector<Outline> &outlines, const Style &style) {
+    PixelTarget target;
+    if (!GetPixelTarget(hdc, &target)) {
+        return false;
+    }
+    DrawOutlinesAA(target, outlines, style);
+    return true;
+}
+
+#endif // _RASTERIZER_H_
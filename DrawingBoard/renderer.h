@@ -0,0 +1,177 @@
+#ifndef _RENDERER_H_
+#define _RENDERER_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+
+#include "batch_queue.h"
+#include "builtin_shape.h"
+#include "scene.h"
+#include "style.h"
+#include "triple_buffer.h"
+
+//
+// Paints the window on a dedicated thread.
+//
+// The UI thread fills `BeginFrame()' and calls `Submit()'; the render thread
+// wakes up, takes the latest scene through a lock-free triple buffer and
+// blits it onto the window. Submitting never waits for a frame in flight.
+//
+// The styles of the scene items are looked up in `styles', which has to
+// outlive the renderer; see `StyleTable' for why that needs no locking.
+//
+class Renderer {
+  public:
+    Renderer(HWND hWnd, const StyleTable *styles);
+    ~Renderer();
+
+    Renderer(const Renderer &) = delete;
+    Renderer& operator=(const Renderer &) = delete;
+
+    Scene &BeginFrame() {
+        return m_scenes.Back();
+    }
+
+    void Submit();
+
+  private:
+    void Run();
+    void DoubleBufferingPaint(const Scene &scene);
+    void DrawBatch(HDC hdc, const BatchQueue::Batch &batch);
+
+    HWND m_hWnd;
+    const StyleTable *m_styles;
+    HANDLE m_hWakeEvent;
+    std::atomic<bool> m_quit;
+    TripleBuffer<Scene> m_scenes;
+
+    // Owned by the render thread.
+    HDC m_hdcMemDC;
+    HBITMAP m_hBitmap;
+    int m_width, m_height;
+    BatchQueue m_batches;
+    std::vector<const std::vector<POINT>*> m_batchPoints;
+    BandPool m_bands;
+
+    std::thread m_thread;
+};
+
+Renderer::Renderer(HWND hWnd, const StyleTable *styles) : m_hWnd(hWnd), m_styles(styles), m_quit(false), m_hdcMemDC(NULL),
+    m_hBitmap(NULL), m_width(0), m_height(0) {
+
+    m_hWakeEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_thread = std::thread(&Renderer::Run, this);
+}
+
+Renderer::~Renderer() {
+    m_quit = true;
+    ::SetEvent(m_hWakeEvent);
+    m_thread.join();
+
+    if (m_hdcMemDC) {
+        ::DeleteDC(m_hdcMemDC);
+    }
+    if (m_hBitmap) {
+        ::DeleteObject(m_hBitmap);
+    }
+    ::CloseHandle(m_hWakeEvent);
+}
+
+void Renderer::Submit() {
+    m_scenes.Publish();
+    ::SetEvent(m_hWakeEvent);
+}
+
+void Renderer::Run() {
+    while (::WaitForSingleObject(m_hWakeEvent, INFINITE) == WAIT_OBJECT_0) {
+        if (m_quit) {
+            break;
+        }
+        if (m_scenes.Update()) {
+            DoubleBufferingPaint(m_scenes.Front());
+        }
+    }
+}
+
+void Renderer::DoubleBufferingPaint(const Scene &scene) {
+    RECT rect;
+    ::GetClientRect(m_hWnd, &rect);
+    int nWidth = rect.right - rect.left;
+    int nHeight = rect.bottom - rect.top;
+
+    if (nWidth <= 0 || nHeight <= 0) {
+        return;
+    }
+
+    HDC hdc = ::GetDC(m_hWnd);
+
+    // The back buffer is kept across frames and only recreated on resize. It is
+    // a top-down 32bpp DIB so that painters may rasterize into it directly.
+    if (!m_hdcMemDC || nWidth != m_width || nHeight != m_height) {
+        if (!m_hdcMemDC) {
+            m_hdcMemDC = ::CreateCompatibleDC(hdc);
+        }
+
+        BITMAPINFO bmi;
+        ZeroMemory(&bmi, sizeof(bmi));
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = nWidth;
+        bmi.bmiHeader.biHeight = -nHeight;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        void *bits;
+        HBITMAP hBitmap = ::CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+        ::SelectObject(m_hdcMemDC, hBitmap);
+        if (m_hBitmap) {
+            ::DeleteObject(m_hBitmap);
+        }
+        m_hBitmap = hBitmap;
+        m_width = nWidth;
+        m_height = nHeight;
+    }
+
+    ::FillRect(m_hdcMemDC, &rect, (HBRUSH)(COLOR_WINDOW + 1));
+
+    // Shapes of the same kind and style are drawn in batches, see
+    // `BatchQueue'. Shapes that are out of the window, or paged out (see
+    // `SceneItem::serial'), are left out before anything else.
+    auto draw = [this](const BatchQueue::Batch &batch) {
+        DrawBatch(m_hdcMemDC, batch);
+    };
+    scene.ForEach([this, &rect, &draw](const SceneItem &item) {
+        const RECT &bounds = item.bounds;
+        if (item.points.empty() || bounds.right < rect.left || bounds.left > rect.right || bounds.bottom < rect.top || bounds.top > rect.bottom) {
+            return;
+        }
+        m_batches.Add(&item, draw);
+    });
+    m_batches.Flush(draw);
+
+    ::BitBlt(hdc, 0, 0, nWidth, nHeight, m_hdcMemDC, 0, 0, SRCCOPY);
+
+    ::ReleaseDC(m_hWnd, hdc);
+}
+
+void Renderer::DrawBatch(HDC hdc, const BatchQueue::Batch &batch) {
+    m_batchPoints.clear();
+    for (const SceneItem *item : batch) {
+        m_batchPoints.push_back(&item->points);
+    }
+    // Built-in shapes skip the virtual Painter interface. Other painters get
+    // the style, and a pen for its outline in the DC.
+    const SceneItem *first = batch[0];
+    const Style &style = m_styles->Get(first->style);
+    if (!BuiltinDrawBatch(first->kind, hdc, m_batchPoints, style, &m_bands)) {
+        HPEN hPen = CreateStylePen(style);
+        HGDIOBJ hOldPen = ::SelectObject(hdc, hPen);
+        first->painter->DrawBatch(hdc, m_batchPoints, style);
+        ::SelectObject(hdc, hOldPen);
+        ::DeleteObject(hPen);
+    }
+}
+
+#endif // _RENDERER_H_
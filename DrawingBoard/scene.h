@@ -0,0 +1,170 @@
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "painter.h"
+#include "style.h"
+
+// A private copy of everything `Painter::Draw' needs for one shape, so that
+// the UI thread may keep editing the Shape while the frame is being drawn.
+struct SceneItem {
+    ShapeKind kind;
+    const Painter *painter;
+    std::vector<POINT> points;
+    StyleId style;
+    RECT bounds;  // of `points', pen included
+
+    // A shape whose points have been paged out to a `DocumentStore' has no
+    // points here; they are record `serial' of `tile' there, to be moved by
+    // `offset'. `serial' is 0 for the others.
+    uint64_t tile;
+    uint32_t serial;
+    POINT offset;
+};
+
+//
+// Persistent (structurally shared) list of scene items.
+//
+// Items live in the leaves of a 32-way trie whose nodes are never modified
+// once built. Copying a Scene only copies the root pointer, so taking a
+// snapshot is O(1); `PushBack()' and `Set()' copy the nodes on the path to
+// the touched leaf and share everything else with older copies. Since the
+// nodes are immutable, snapshots may be read from other threads freely.
+//
+class Scene {
+  public:
+    typedef std::shared_ptr<const SceneItem> ItemPtr;
+
+    Scene() : m_size(0), m_shift(0) {}
+    ~Scene() = default;
+
+    size_t Size() const {
+        return m_size;
+    }
+
+    const SceneItem &operator[](size_t index) const;
+
+    void PushBack(const ItemPtr &item);
+
+    void Set(size_t index, const ItemPtr &item);
+
+    template <class FUNC>
+    void ForEach(FUNC func) const {
+        ForEachItem([&func](const ItemPtr &item) {
+            func(*item);
+        });
+    }
+
+    // As `ForEach()', but hands out the items themselves, e.g. to share them
+    // with another scene.
+    template <class FUNC>
+    void ForEachItem(FUNC func) const {
+        if (m_root) {
+            ForEachItem(m_root.get(), m_shift, func);
+        }
+    }
+
+  private:
+    static const int kBits = 5;
+    static const size_t kMask = (1 << kBits) - 1;
+
+    struct Node;
+    typedef std::shared_ptr<const Node> NodePtr;
+
+    struct Node {
+        std::vector<NodePtr> children;  // inner nodes
+        std::vector<ItemPtr> items;     // leaves
+    };
+
+    static NodePtr NewPath(int level, const ItemPtr &item);
+    static NodePtr PushTail(const NodePtr &node, int level, size_t index, const ItemPtr &item);
+    static NodePtr SetPath(const NodePtr &node, int level, size_t index, const ItemPtr &item);
+
+    template <class FUNC>
+    static void ForEachItem(const Node *node, int level, FUNC &func) {
+        if (level == 0) {
+            for (const ItemPtr &item : node->items) {
+                func(item);
+            }
+        } else {
+            for (const NodePtr &child : node->children) {
+                ForEachItem(child.get(), level - kBits, func);
+            }
+        }
+    }
+
+    NodePtr m_root;
+    size_t m_size;
+    int m_shift;
+};
+
+const SceneItem &Scene::operator[](size_t index) const {
+    const Node *node = m_root.get();
+    for (int level = m_shift; level > 0; level -= kBits) {
+        node = node->children[(index >> level) & kMask].get();
+    }
+    return *node->items[index & kMask];
+}
+
+void Scene::PushBack(const ItemPtr &item) {
+    if (!m_root) {
+        m_root = NewPath(0, item);
+    } else if ((m_size >> kBits) >= ((size_t)1 << m_shift)) {
+        // The trie is full, grow it by one level.
+        std::shared_ptr<Node> root = std::make_shared<Node>();
+        root->children.push_back(m_root);
+        root->children.push_back(NewPath(m_shift, item));
+        m_root = root;
+        m_shift += kBits;
+    } else {
+        m_root = PushTail(m_root, m_shift, m_size, item);
+    }
+    m_size++;
+}
+
+void Scene::Set(size_t index, const ItemPtr &item) {
+    m_root = SetPath(m_root, m_shift, index, item);
+}
+
+Scene::NodePtr Scene::NewPath(int level, const ItemPtr &item) {
+    std::shared_ptr<Node> node = std::make_shared<Node>();
+    if (level == 0) {
+        node->items.push_back(item);
+    } else {
+        node->children.push_back(NewPath(level - kBits, item));
+    }
+    return node;
+}
+
+Scene::NodePtr Scene::PushTail(const NodePtr &node, int level, size_t index, const ItemPtr &item) {
+    std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+    if (level == 0) {
+        copy->items.push_back(item);
+    } else {
+        size_t sub = (index >> level) & kMask;
+        if (sub < copy->children.size()) {
+            copy->children[sub] = PushTail(copy->children[sub], level - kBits, index, item);
+        } else {
+            copy->children.push_back(NewPath(level - kBits, item));
+        }
+    }
+    return copy;
+}
+
+Scene::NodePtr Scene::SetPath(const NodePtr &node, int level, size_t index, const ItemPtr &item) {
+    std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+    if (level == 0) {
+        copy->items[index & kMask] = item;
+    } else {
+        size_t sub = (index >> level) & kMask;
+        copy->children[sub] = SetPath(copy->children[sub], level - kBits, index, item);
+    }
+    return copy;
+}
+
+#endif // _SCENE_H_
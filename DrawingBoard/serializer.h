@@ -0,0 +1,30 @@
+#ifndef _SERIALIZER_H_
+#define _SERIALIZER_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <vector>
+
+#include "path_sink.h"
+
+//
+// Describes the shapes of a plugin to the exporter.
+//
+// Built-in shapes are exported by the board itself; other plugins may export
+// `CreateSerializerFactory', and their shapes are taken as the polygon through
+// their points if they do not.
+//
+class Serializer {
+  public:
+    Serializer() = default;
+    virtual ~Serializer() = default;
+
+    Serializer(const Serializer &) = delete;
+    Serializer& operator=(const Serializer &) = delete;
+
+    // Emits the outline of the shape with the given points; subpaths are
+    // filled with the even-odd rule.
+    virtual void Serialize(const std::vector<POINT> &points, PathSink *sink) const = 0;
+};
+
+#endif // _SERIALIZER_H_
@@ -3,11 +3,45 @@
 
 #define NOMINMAX
 #include <Windows.h>
+#include <algorithm>
+#include <climits>
 #include <vector>
 
+// Shapes whose layout the board knows about; see builtin_shape.h.
+enum ShapeKind {
+    SHAPE_CUSTOM,
+    SHAPE_RECTANGLE,
+    SHAPE_ELLIPSE,
+    SHAPE_POLYGON,
+};
+
+// Separates the rings of a shape that has several, e.g. a polygon with holes.
+// It is not a point of the shape: bounds leave it out and moves keep it put.
+const POINT kRingBreak = { LONG_MIN, LONG_MIN };
+
+bool IsRingBreak(const POINT &pt) {
+    return pt.x == kRingBreak.x && pt.y == kRingBreak.y;
+}
+
+// The smallest rectangle that holds all of `points', edges included. With no
+// points it is empty, i.e. `left' is greater than `right'.
+RECT PointsExtent(const std::vector<POINT> &points) {
+    RECT rect = { LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN };
+    for (const POINT &pt : points) {
+        if (IsRingBreak(pt)) {
+            continue;
+        }
+        rect.left = std::min(rect.left, pt.x);
+        rect.top = std::min(rect.top, pt.y);
+        rect.right = std::max(rect.right, pt.x);
+        rect.bottom = std::max(rect.bottom, pt.y);
+    }
+    return rect;
+}
+
 class Shape {
   public:
-    Shape() = default;
+    Shape() : m_kind(SHAPE_CUSTOM) {}
     virtual ~Shape() = default;
 
     Shape(const Shape&) = delete;
@@ -25,9 +59,25 @@ class Shape {
 
     virtual bool Contains(const POINT &pt) const = 0;
 
-    virtual COLORREF GetBrushColor() const = 0;
+    // A box around every point `Contains()' accepts, edges included, so that
+    // callers can rule a shape out without asking it. By default it is the
+    // extent of the points; shapes that reach beyond their points have to
+    // override this, and shapes that keep their box up to date as the points
+    // change should, as `BuiltinShape' does.
+    virtual RECT GetBounds() const {
+        return PointsExtent(GetPoints());
+    }
+
+    // Not virtual: the board trusts anything but SHAPE_CUSTOM to be a
+    // `BuiltinShape', and only `BuiltinShape' can say so.
+    ShapeKind GetKind() const {
+        return m_kind;
+    }
+
+  private:
+    friend class BuiltinShape;
 
-    virtual void SetBrushColor(COLORREF color) = 0;
+    ShapeKind m_kind;
 };
 
 #endif // _SHAPE_H_
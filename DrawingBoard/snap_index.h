@@ -0,0 +1,174 @@
+#ifndef _SNAP_INDEX_H_
+#define _SNAP_INDEX_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "builtin_shape.h"
+#include "scene.h"
+#include "worker_pool.h"
+
+//
+// Points that the cursor snaps to, e.g. the vertices and edge midpoints of
+// every committed shape, kept in a hashed grid.
+//
+// The cells are twice as wide as the snap radius, so a query looks at no more
+// than four of them however many points the board has. Points are grouped by
+// an opaque owner, usually the shape they belong to, which is how they are
+// replaced when the shape moves and how a shape avoids snapping to itself.
+//
+class SnapIndex {
+  public:
+    SnapIndex(LONG radius) : m_radius(radius), m_cellSize(2 * radius) {}
+    ~SnapIndex() = default;
+
+    SnapIndex(const SnapIndex &) = delete;
+    SnapIndex& operator=(const SnapIndex &) = delete;
+
+    LONG GetRadius() const {
+        return m_radius;
+    }
+
+    // Replaces the points of `owner', if any.
+    void Update(const void *owner, const std::vector<POINT> &anchors);
+
+    void Remove(const void *owner);
+
+    void Clear() {
+        m_cells.clear();
+        m_owners.clear();
+    }
+
+    void Swap(SnapIndex &other) {
+        std::swap(m_radius, other.m_radius);
+        std::swap(m_cellSize, other.m_cellSize);
+        m_cells.swap(other.m_cells);
+        m_owners.swap(other.m_owners);
+    }
+
+    // Finds the point closest to `pt' within the snap radius, ignoring those of `exclude'.
+    bool Snap(const POINT &pt, const void *exclude, POINT *anchor) const;
+
+  private:
+    struct Entry {
+        POINT pt;
+        const void *owner;
+    };
+
+    LONG CellOf(LONG v) const {
+        return (v >= 0) ? (v / m_cellSize) : -((-v + m_cellSize - 1) / m_cellSize);
+    }
+
+    static uint64_t Key(LONG cx, LONG cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+
+    LONG m_radius, m_cellSize;
+    std::unordered_map<uint64_t, std::vector<Entry> > m_cells;
+    std::unordered_map<const void*, std::vector<POINT> > m_owners;
+};
+
+void SnapIndex::Update(const void *owner, const std::vector<POINT> &anchors) {
+    Remove(owner);
+    if (anchors.empty()) {
+        return;
+    }
+
+    for (const POINT &pt : anchors) {
+        Entry entry = { pt, owner };
+        m_cells[Key(CellOf(pt.x), CellOf(pt.y))].push_back(entry);
+    }
+    m_owners[owner] = anchors;
+}
+
+void SnapIndex::Remove(const void *owner) {
+    auto it = m_owners.find(owner);
+    if (it == m_owners.end()) {
+        return;
+    }
+
+    for (const POINT &pt : it->second) {
+        auto cell = m_cells.find(Key(CellOf(pt.x), CellOf(pt.y)));
+        std::vector<Entry> &entries = cell->second;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].owner == owner && entries[i].pt.x == pt.x && entries[i].pt.y == pt.y) {
+                entries[i] = entries.back();
+                entries.pop_back();
+                break;
+            }
+        }
+        if (entries.empty()) {
+            m_cells.erase(cell);
+        }
+    }
+    m_owners.erase(it);
+}
+
+bool SnapIndex::Snap(const POINT &pt, const void *exclude, POINT *anchor) const {
+    int64_t best = (int64_t)m_radius * m_radius + 1;
+    for (LONG cx = CellOf(pt.x - m_radius); cx <= CellOf(pt.x + m_radius); cx++) {
+        for (LONG cy = CellOf(pt.y - m_radius); cy <= CellOf(pt.y + m_radius); cy++) {
+            auto cell = m_cells.find(Key(cx, cy));
+            if (cell == m_cells.end()) {
+                continue;
+            }
+            for (const Entry &entry : cell->second) {
+                int64_t dx = entry.pt.x - pt.x, dy = entry.pt.y - pt.y;
+                int64_t d = dx * dx + dy * dy;
+                if (d < best && entry.owner != exclude) {
+                    best = d;
+                    *anchor = entry.pt;
+                }
+            }
+        }
+    }
+    return best <= (int64_t)m_radius * m_radius;
+}
+
+//
+// Indexes a snapshot of the board from scratch on a `WorkerPool'.
+//
+// The anchors of the shapes are collected in parallel; the worker that
+// collects the last of them then fills the index. `owners[i]' is the owner of
+// the anchors of `scene[i]'; the owners are only used as keys. Shapes that
+// are paged out have no anchors until they are back.
+//
+class SnapIndexJob : public Job {
+  public:
+    SnapIndexJob(const Scene &scene, const std::vector<const void*> &owners, LONG radius)
+        : Job(scene.Size()), m_scene(scene), m_owners(owners), m_anchors(scene.Size()), m_index(radius) {}
+    virtual ~SnapIndexJob() = default;
+
+    // Complete once the job has finished without being cancelled.
+    SnapIndex &GetIndex() {
+        return m_index;
+    }
+
+  protected:
+    virtual void Run(size_t begin, size_t end) override {
+        for (size_t i = begin; i < end; i++) {
+            const SceneItem &item = m_scene[i];
+            if (!item.points.empty()) {
+                GetSnapAnchors(item.kind, item.points, &m_anchors[i]);
+            }
+        }
+    }
+
+    virtual void Finish() override {
+        for (size_t i = 0; i < m_anchors.size(); i++) {
+            m_index.Update(m_owners[i], m_anchors[i]);
+            std::vector<POINT>().swap(m_anchors[i]);
+        }
+    }
+
+  private:
+    Scene m_scene;
+    std::vector<const void*> m_owners;
+    std::vector<std::vector<POINT> > m_anchors;
+    SnapIndex m_index;
+};
+
+#endif // _SNAP_INDEX_H_
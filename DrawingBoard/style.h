@@ -0,0 +1,148 @@
+#ifndef _STYLE_H_
+#define _STYLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+//
+// How a shape is filled and outlined.
+//
+// Colors are laid out like a COLORREF, 0x00BBGGRR. Nothing in here touches
+// Win32, so styles can go over the wire and into exported files as they are.
+//
+enum DashPattern {
+    DASH_SOLID,
+    DASH_DASHED,
+    DASH_DOTTED,
+    DASH_COUNT,
+};
+
+// On and off lengths of every pattern, in multiples of the stroke width. A
+// solid outline has no off length.
+struct DashLengths {
+    float on, off;
+};
+
+const DashLengths kDashLengths[DASH_COUNT] = {
+    { 1.0f, 0.0f },
+    { 4.0f, 2.0f },
+    { 1.0f, 1.0f },
+};
+
+struct Style {
+    uint32_t fill;
+    uint32_t stroke;
+    uint8_t strokeWidth;  // in pixels; 0 for no outline
+    uint8_t opacity;      // of fill and outline alike, 255 for opaque
+    uint8_t dash;         // a DashPattern
+
+    bool operator==(const Style &other) const {
+        return fill == other.fill && stroke == other.stroke && strokeWidth == other.strokeWidth &&
+            opacity == other.opacity && dash == other.dash;
+    }
+};
+
+inline uint8_t ColorRed(uint32_t color) {
+    return (uint8_t)color;
+}
+
+inline uint8_t ColorGreen(uint32_t color) {
+    return (uint8_t)(color >> 8);
+}
+
+inline uint8_t ColorBlue(uint32_t color) {
+    return (uint8_t)(color >> 16);
+}
+
+// What the board drew every shape with before it had styles: a white fill
+// and a 1px black outline.
+inline Style DefaultStyle() {
+    Style style = { 0xFFFFFF, 0x000000, 1, 255, DASH_SOLID };
+    return style;
+}
+
+// Index of a style in a `StyleTable'.
+typedef uint16_t StyleId;
+
+// Always the id of `DefaultStyle()'.
+const StyleId kDefaultStyle = 0;
+
+//
+// Interned styles.
+//
+// Every distinct style is stored once and shapes refer to it by a 16-bit id,
+// so a shape takes the same room however many styles the board has, and two
+// shapes look alike exactly when their ids are equal.
+//
+// Styles live in fixed-size chunks that are never moved or freed, so a
+// reference returned by `Get()' stays valid for the life of the table.
+// Another thread may look up any id that was handed to it after `Intern()'
+// returned it, e.g. through a scene submitted to the renderer, while the
+// owner keeps interning new ones.
+//
+class StyleTable {
+  public:
+    StyleTable();
+    ~StyleTable() = default;
+
+    StyleTable(const StyleTable &) = delete;
+    StyleTable& operator=(const StyleTable &) = delete;
+
+    // Returns the id of `style', adding it if it is new. Once the table is
+    // full, styles that are not in it yet map to the default one.
+    StyleId Intern(const Style &style);
+
+    const Style &Get(StyleId id) const {
+        return m_chunks[id >> kChunkBits][id & kChunkMask];
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+  private:
+    static const int kChunkBits = 8;
+    static const size_t kChunkSize = (size_t)1 << kChunkBits;
+    static const size_t kChunkMask = kChunkSize - 1;
+    static const size_t kMaxStyles = (size_t)1 << 16;
+
+    struct StyleHash {
+        size_t operator()(const Style &style) const {
+            uint64_t h = ((uint64_t)style.fill << 32) ^ style.stroke;
+            h ^= ((uint64_t)style.strokeWidth << 16 | (uint64_t)style.opacity << 8 | style.dash) * 0x9E3779B97F4A7C15ull;
+            return std::hash<uint64_t>()(h);
+        }
+    };
+
+    std::unique_ptr<Style[]> m_chunks[kMaxStyles / kChunkSize];
+    size_t m_size;
+    std::unordered_map<Style, StyleId, StyleHash> m_ids;
+};
+
+StyleTable::StyleTable() : m_size(0) {
+    Intern(DefaultStyle());
+}
+
+StyleId StyleTable::Intern(const Style &style) {
+    auto it = m_ids.find(style);
+    if (it != m_ids.end()) {
+        return it->second;
+    }
+    if (m_size == kMaxStyles) {
+        return kDefaultStyle;
+    }
+
+    StyleId id = (StyleId)m_size;
+    std::unique_ptr<Style[]> &chunk = m_chunks[id >> kChunkBits];
+    if (!chunk) {
+        chunk.reset(new Style[kChunkSize]);
+    }
+    chunk[id & kChunkMask] = style;
+    m_ids[style] = id;
+    m_size++;
+    return id;
+}
+
+#endif // _STYLE_H_
@@ -0,0 +1,212 @@
+#ifndef _SYNC_CLIENT_H_
+#define _SYNC_CLIENT_H_
+
+#include "sync_socket.h"
+#include "delta.h"
+
+//
+// The board's end of a session.
+//
+// Edits are collected into a `DeltaBatch' and go out once per frame; what the
+// server relays back is handed out by `Poll()' in the server's order. The
+// socket never blocks once the session is up, so both can be called from the
+// window's message loop.
+//
+class SyncClient {
+  public:
+    SyncClient() : m_socket(INVALID_SOCKET), m_client(0), m_serial(0), m_inboxRead(0), m_bytesSent(0), m_bytesReceived(0) {}
+    ~SyncClient() {
+        Disconnect();
+    }
+
+    SyncClient(const SyncClient &) = delete;
+    SyncClient& operator=(const SyncClient &) = delete;
+
+    // Joins the session of the server on this machine; waits for the server
+    // to hand out an id, which takes a round trip.
+    bool Connect(unsigned short port);
+
+    void Disconnect();
+
+    bool IsConnected() const {
+        return m_socket != INVALID_SOCKET;
+    }
+
+    uint32_t GetClientId() const {
+        return m_client;
+    }
+
+    ShapeId NewShapeId() {
+        ShapeId id = { m_client, ++m_serial };
+        return id;
+    }
+
+    DeltaBatch &Edits() {
+        return m_batch;
+    }
+
+    // Sends the edits collected since the last call. Returns false if the
+    // session is over.
+    bool Flush();
+
+    // Calls `func(sender, delta)' for every delta that has arrived, where
+    // `sender' is the id of the client that made the edit. Returns false if
+    // the session is over.
+    template <class FUNC>
+    bool Poll(FUNC func);
+
+    uint64_t BytesSent() const {
+        return m_bytesSent;
+    }
+
+    uint64_t BytesReceived() const {
+        return m_bytesReceived;
+    }
+
+  private:
+    static const size_t kMaxFrame = 16 * 1024 * 1024;
+
+    bool Receive();
+
+    SOCKET m_socket;
+    uint32_t m_client, m_serial;
+    DeltaBatch m_batch;
+    std::vector<uint8_t> m_outbox, m_inbox;
+    size_t m_inboxRead;
+    uint64_t m_bytesSent, m_bytesReceived;
+};
+
+bool SyncClient::Connect(unsigned short port) {
+    Disconnect();
+
+    m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_socket == INVALID_SOCKET) {
+        return false;
+    }
+
+    sockaddr_in addr = LoopbackAddress(port);
+    if (::connect(m_socket, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        Disconnect();
+        return false;
+    }
+    SetupSocket(m_socket, false);
+
+    // The server greets every client with its id before anything else; what
+    // follows is the history of the session, which is left to `Poll()'.
+    size_t header = 0, size = 0;
+    FrameStatus status;
+    while ((status = PeekFrame(m_inbox.data(), m_inbox.size(), kMaxFrame, &header, &size)) == FRAME_INCOMPLETE) {
+        if (!Receive()) {
+            break;
+        }
+    }
+
+    Delta delta;
+    uint64_t sender;
+    DeltaReader reader(m_inbox.data() + header, (status == FRAME_READY) ? size : 0);
+    if (!reader.ReadVarint(&sender) || sender != 0 || !reader.Next(&delta) || delta.op != DELTA_HELLO || delta.client == 0) {
+        Disconnect();
+        return false;
+    }
+    m_client = delta.client;
+    m_inboxRead = header + size;
+
+    SetupSocket(m_socket, true);
+    return true;
+}
+
+void SyncClient::Disconnect() {
+    if (m_socket != INVALID_SOCKET) {
+        ::closesocket(m_socket);
+        m_socket = INVALID_SOCKET;
+    }
+    m_outbox.clear();
+    m_inbox.clear();
+    m_inboxRead = 0;
+}
+
+bool SyncClient::Flush() {
+    if (!IsConnected()) {
+        return false;
+    }
+
+    m_batch.Flush(&m_outbox);
+    size_t sent = 0;
+    while (sent < m_outbox.size()) {
+        int n = ::send(m_socket, (const char*)m_outbox.data() + sent, (int)(m_outbox.size() - sent), 0);
+        if (n <= 0) {
+            if (n < 0 && LastCallWouldBlock()) {
+                break;  // the rest goes out with the next frame
+            }
+            Disconnect();
+            return false;
+        }
+        sent += n;
+    }
+    m_outbox.erase(m_outbox.begin(), m_outbox.begin() + sent);
+    m_bytesSent += sent;
+    return true;
+}
+
+// Reads whatever the socket has. Until the session is up, the socket blocks
+// and this waits for at least one byte.
+bool SyncClient::Receive() {
+    char buffer[64 * 1024];
+    for (;;) {
+        int n = ::recv(m_socket, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            m_inbox.insert(m_inbox.end(), buffer, buffer + n);
+            m_bytesReceived += n;
+            if (m_client == 0 || n < (int)sizeof(buffer)) {
+                return true;
+            }
+        } else if (n < 0 && LastCallWouldBlock()) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+template <class FUNC>
+bool SyncClient::Poll(FUNC func) {
+    if (!IsConnected()) {
+        return false;
+    }
+    if (!Receive()) {
+        Disconnect();
+        return false;
+    }
+
+    for (;;) {
+        size_t header, size;
+        FrameStatus status = PeekFrame(m_inbox.data() + m_inboxRead, m_inbox.size() - m_inboxRead, kMaxFrame, &header, &size);
+        if (status == FRAME_CORRUPT) {
+            Disconnect();
+            return false;
+        }
+        if (status == FRAME_INCOMPLETE) {
+            break;
+        }
+
+        const uint8_t *payload = m_inbox.data() + m_inboxRead + header;
+        m_inboxRead += header + size;
+
+        DeltaReader reader(payload, size);
+        uint64_t sender;
+        Delta delta;
+        if (reader.ReadVarint(&sender)) {
+            while (reader.Next(&delta)) {
+                func((uint32_t)sender, delta);
+            }
+        }
+    }
+
+    if (m_inboxRead > 0 && m_inboxRead * 2 >= m_inbox.size()) {
+        m_inbox.erase(m_inbox.begin(), m_inbox.begin() + m_inboxRead);
+        m_inboxRead = 0;
+    }
+    return true;
+}
+
+#endif // _SYNC_CLIENT_H_
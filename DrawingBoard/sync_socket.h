@@ -0,0 +1,82 @@
+#ifndef _SYNC_SOCKET_H_
+#define _SYNC_SOCKET_H_
+
+//
+// Just enough of a socket layer for the session code to build against
+// Winsock and, for the server and for tests, against BSD sockets.
+//
+// On Windows this has to be included before Windows.h, which would pull in
+// the old winsock.h otherwise.
+//
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <WinSock2.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+const SOCKET INVALID_SOCKET = -1;
+
+inline int closesocket(SOCKET s) {
+    return close(s);
+}
+#endif
+
+#include <cstring>
+
+inline bool StartSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    return ::WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void StopSockets() {
+#ifdef _WIN32
+    ::WSACleanup();
+#endif
+}
+
+// Edits are small and latency matters more than packet count, so Nagle is off.
+inline void SetupSocket(SOCKET s, bool nonBlocking) {
+    int one = 1;
+    ::setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+    if (nonBlocking) {
+#ifdef _WIN32
+        u_long mode = 1;
+        ::ioctlsocket(s, FIONBIO, &mode);
+#else
+        ::fcntl(s, F_SETFL, ::fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    }
+}
+
+inline bool LastCallWouldBlock() {
+#ifdef _WIN32
+    return ::WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+inline sockaddr_in LoopbackAddress(unsigned short port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+#endif // _SYNC_SOCKET_H_
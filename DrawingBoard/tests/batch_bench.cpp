@@ -0,0 +1,108 @@
+//
+// How many draw calls and state changes a frame of 100k shapes takes, and
+// how long sorting it into batches takes: one call per shape, batches of
+// consecutive shapes only, and `BatchQueue' with a few numbers of open
+// batches. A state change is a batch whose style differs from the one
+// before, i.e. a new pen and brush.
+//
+// Shapes of 3 kinds in 8 styles, 8 to 48 pixels wide and high, are scattered
+// over a board of 20000 x 20000 pixels, as if the window showed all of it.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../batch_queue.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t kShapes = 100000;
+const int kStyles = 8;
+const int kBoard = 20000;
+const int kRuns = 5;
+
+Scene MakeBoard() {
+    std::mt19937 rng(1);
+    Scene scene;
+    for (size_t i = 0; i < kShapes; i++) {
+        std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+        item->kind = (ShapeKind)(SHAPE_RECTANGLE + rng() % 3);
+        item->painter = nullptr;
+        LONG x = rng() % kBoard, y = rng() % kBoard;
+        LONG w = 8 + rng() % 40, h = 8 + rng() % 40;
+        POINT corners[2] = { { x, y }, { x + w, y + h } };
+        item->points.assign(corners, corners + 2);
+        item->style = (StyleId)(rng() % kStyles);
+        item->bounds = PointsExtent(item->points);
+        scene.PushBack(item);
+    }
+    return scene;
+}
+
+struct Counts {
+    size_t calls, changes;
+    double ms;
+};
+
+Counts Count(const Scene &scene, size_t maxPending) {
+    Counts counts = { 0, 0, 1e30 };
+    for (int run = 0; run < kRuns; run++) {
+        BatchQueue queue(maxPending);
+        size_t calls = 0, changes = 0;
+        const SceneItem *last = nullptr;
+        auto flush = [&](const BatchQueue::Batch &batch) {
+            calls++;
+            if (!last || last->style != batch[0]->style || last->kind != batch[0]->kind) {
+                changes++;
+            }
+            last = batch[0];
+        };
+
+        Clock::time_point start = Clock::now();
+        scene.ForEach([&](const SceneItem &item) {
+            queue.Add(&item, flush);
+        });
+        queue.Flush(flush);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        counts.calls = calls;
+        counts.changes = changes;
+        counts.ms = std::min(counts.ms, ms);
+    }
+    return counts;
+}
+
+void Report(const char *name, const Counts &counts) {
+    std::printf("%-24s %9u calls %9u state changes %9.2f ms\n", name, (unsigned)counts.calls, (unsigned)counts.changes,
+                counts.ms);
+}
+
+int main() {
+    Scene scene = MakeBoard();
+
+    // One call per shape, and a state change whenever the style differs.
+    size_t changes = 0;
+    const SceneItem *last = nullptr;
+    scene.ForEach([&](const SceneItem &item) {
+        if (!last || last->style != item.style || last->kind != item.kind) {
+            changes++;
+        }
+        last = &item;
+    });
+    std::printf("%u shapes\n", (unsigned)kShapes);
+    Counts single = { kShapes, changes, 0.0 };
+    Report("one call per shape", single);
+
+    Report("consecutive runs", Count(scene, 1));
+    const size_t pending[] = { 8, 32, 64 };
+    for (size_t n : pending) {
+        char name[64];
+        std::sprintf(name, "%u open batches", (unsigned)n);
+        Report(name, Count(scene, n));
+    }
+    return 0;
+}
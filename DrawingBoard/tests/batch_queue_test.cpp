@@ -0,0 +1,67 @@
+//
+// Batches of random frames have to draw what the frame says: no two items of
+// a batch overlap or differ in kind or style, every item is drawn exactly
+// once, and items that overlap are drawn in the order of the frame.
+//
+
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "../batch_queue.h"
+
+bool Intersect(const RECT &a, const RECT &b) {
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+void TestFrame(std::mt19937 &rng, size_t count, int board, size_t maxPending) {
+    std::vector<SceneItem> items(count);
+    for (SceneItem &item : items) {
+        item.kind = (ShapeKind)(rng() % 4);
+        item.painter = (const Painter *)(size_t)(1 + rng() % 2);
+        LONG x = rng() % board, y = rng() % board;
+        RECT bounds = { x, y, x + (LONG)(rng() % 30), y + (LONG)(rng() % 30) };
+        item.bounds = bounds;
+        item.style = (StyleId)(rng() % 3);
+    }
+
+    std::vector<size_t> order(count, count);  // when each item was drawn
+    size_t drawn = 0;
+    BatchQueue queue(maxPending);
+    auto flush = [&](const BatchQueue::Batch &batch) {
+        CHECK(!batch.empty() && batch.size() <= BatchQueue::kMaxBatch);
+        for (size_t i = 0; i < batch.size(); i++) {
+            CHECK(SameBatch(*batch[0], *batch[i]));
+            for (size_t j = 0; j < i; j++) {
+                CHECK(!Intersect(batch[i]->bounds, batch[j]->bounds));
+            }
+            size_t index = batch[i] - &items[0];
+            CHECK(order[index] == count);
+            order[index] = drawn++;
+        }
+    };
+    for (const SceneItem &item : items) {
+        queue.Add(&item, flush);
+    }
+    queue.Flush(flush);
+    CHECK(drawn == count);
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (Intersect(items[i].bounds, items[j].bounds)) {
+                CHECK(order[j] < order[i]);
+            }
+        }
+    }
+}
+
+int main() {
+    std::mt19937 rng(1);
+    const size_t pending[] = { 1, 2, 8, 32 };
+    for (int round = 0; round < 50; round++) {
+        for (size_t n : pending) {
+            TestFrame(rng, 500, 100 + round * 20, n);
+        }
+    }
+    return TestResult();
+}
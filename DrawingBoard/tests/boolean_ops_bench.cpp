@@ -0,0 +1,67 @@
+//
+// Running time of the boolean operations on two overlapping star-shaped
+// polygons of 1k to 100k vertices each, where every edge of one crosses
+// edges of the other.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../boolean_ops.h"
+
+const int kRuns = 3;
+
+// Best of `kRuns', in milliseconds.
+template <class FUNC>
+double Time(FUNC func) {
+    double best = 1e30;
+    for (int i = 0; i < kRuns; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+// `n' vertices around (cx, cy) at random radii between `r0' and `r1'.
+Contour Star(int n, double cx, double cy, double r0, double r1, unsigned seed) {
+    std::mt19937 rng(seed);
+    Contour c;
+    for (int i = 0; i < n; i++) {
+        double a = 6.283185307 * i / n;
+        double r = r0 + (rng() % 1000) / 1000.0 * (r1 - r0);
+        POINT pt = { std::lround(cx + r * std::cos(a)), std::lround(cy + r * std::sin(a)) };
+        if (c.empty() || c.back().x != pt.x || c.back().y != pt.y) {
+            c.push_back(pt);
+        }
+    }
+    return c;
+}
+
+int main() {
+    const char *names[] = { "union", "intersection", "difference" };
+    const int sizes[] = { 1000, 10000, 50000, 100000 };
+    for (int n : sizes) {
+        std::vector<Contour> a(1, Star(n, 20000, 20000, 15000, 16000, 1));
+        std::vector<Contour> b(1, Star(n, 23000, 21000, 15000, 16000, 2));
+        for (int op = BOOLEAN_UNION; op <= BOOLEAN_DIFFERENCE; op++) {
+            size_t vertices = 0;
+            double ms = Time([&]() {
+                BooleanEngine engine;
+                std::vector<Contour> result;
+                engine.Compute(a, b, (BooleanOp)op, &result);
+                vertices = 0;
+                for (const Contour &c : result) {
+                    vertices += c.size();
+                }
+            });
+            std::printf("%6d vertices %-12s %9.2f ms %8u result vertices\n", n, names[op], ms, (unsigned)vertices);
+        }
+    }
+    return 0;
+}
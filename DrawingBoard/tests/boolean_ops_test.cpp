@@ -0,0 +1,266 @@
+//
+// Fuzz test of the boolean operations, and of how their results are kept in
+// the points of a polygon.
+//
+// Random operands are combined and the result is point-sampled against what
+// the operands say about the same point. Crossings are rounded to whole
+// pixels, which moves the edges of the result by less than a pixel, so only
+// samples at least a pixel away from every edge of the operands count; those
+// have to agree exactly.
+//
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "../boolean_ops.h"
+#include "../builtin_shape.h"
+
+// A polygon shape as the Polygon plugin makes them.
+class TestPolygon : public BuiltinShape {
+  public:
+    TestPolygon() : BuiltinShape(SHAPE_POLYGON) {}
+
+    virtual Shape* Reset() const override {
+        return new TestPolygon;
+    }
+
+    virtual bool Contains(const POINT &pt) const override {
+        return BuiltinGeometry<SHAPE_POLYGON>::Contains(m_points, m_bounds, pt);
+    }
+};
+
+bool EvenOdd(const std::vector<Contour> &contours, double x, double y) {
+    bool inside = false;
+    for (const Contour &c : contours) {
+        for (size_t i = 0, j = c.size() - 1; i < c.size(); j = i++) {
+            double ax = c[i].x, ay = c[i].y, bx = c[j].x, by = c[j].y;
+            if ((ay > y) != (by > y) && x < ax + (y - ay) * (bx - ax) / (by - ay)) {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+int Winding(const std::vector<Contour> &contours, double x, double y) {
+    int winding = 0;
+    for (const Contour &c : contours) {
+        for (size_t i = 0, j = c.size() - 1; i < c.size(); j = i++) {
+            double ax = c[j].x, ay = c[j].y, bx = c[i].x, by = c[i].y;
+            if ((ay > y) != (by > y) && x < ax + (y - ay) * (bx - ax) / (by - ay)) {
+                winding += (by > ay) ? 1 : -1;
+            }
+        }
+    }
+    return winding;
+}
+
+double DistanceToEdges(const std::vector<Contour> &contours, double x, double y) {
+    double best = 1e30;
+    for (const Contour &c : contours) {
+        for (size_t i = 0, j = c.size() - 1; i < c.size(); j = i++) {
+            double ax = c[j].x, ay = c[j].y, ex = c[i].x - ax, ey = c[i].y - ay;
+            double len2 = ex * ex + ey * ey;
+            double t = len2 > 0 ? std::max(0.0, std::min(1.0, ((x - ax) * ex + (y - ay) * ey) / len2)) : 0.0;
+            best = std::min(best, std::hypot(x - ax - t * ex, y - ay - t * ey));
+        }
+    }
+    return best;
+}
+
+// A rectangle, a star-shaped polygon, or a polygon through random points that
+// may cross itself and repeat vertices, all within [0, range] scaled by `scale'.
+Contour RandomContour(std::mt19937 &rng, int range, int scale) {
+    std::uniform_int_distribution<int> coord(0, range);
+    Contour c;
+    switch (rng() % 3) {
+        case 0: {
+            LONG x0 = coord(rng), x1 = x0 + 1 + coord(rng) / 2, y0 = coord(rng), y1 = y0 + 1 + coord(rng) / 2;
+            POINT pts[4] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y1 } };
+            c.assign(pts, pts + 4);
+            break;
+        }
+        case 1: {
+            std::vector<double> angles(3 + rng() % 8);
+            for (double &a : angles) {
+                a = (rng() % 10000) / 10000.0 * 6.2831853;
+            }
+            std::sort(angles.begin(), angles.end());
+            for (double a : angles) {
+                double r = 1 + (rng() % 1000) / 1000.0 * range / 2;
+                POINT pt = { std::lround(range / 2.0 + r * std::cos(a)), std::lround(range / 2.0 + r * std::sin(a)) };
+                c.push_back(pt);
+            }
+            break;
+        }
+        default:
+            for (int i = 3 + rng() % 6; i > 0; i--) {
+                POINT pt = { coord(rng), coord(rng) };
+                c.push_back(pt);
+            }
+            break;
+    }
+    for (POINT &pt : c) {
+        pt.x *= scale;
+        pt.y *= scale;
+    }
+    return c;
+}
+
+// Stores `result' in a polygon the way the board does and reads it back.
+void CheckStored(const std::vector<Contour> &result, std::mt19937 &rng, LONG extent) {
+    TestPolygon polygon;
+    for (const Contour &contour : result) {
+        if (!polygon.GetPoints().empty()) {
+            polygon.AddPoint(kRingBreak);
+        }
+        for (const POINT &pt : contour) {
+            polygon.AddPoint(pt);
+        }
+    }
+
+    std::vector<Contour> rings;
+    ForEachPolygonRing(polygon.GetPoints(), [&](const POINT *ring, size_t n) {
+        rings.push_back(Contour(ring, ring + n));
+    });
+    CHECK(rings.size() == result.size());
+    for (size_t i = 0; i < rings.size() && i < result.size(); i++) {
+        CHECK(rings[i].size() == result[i].size());
+        CHECK(std::equal(rings[i].begin(), rings[i].end(), result[i].begin(), [](const POINT &a, const POINT &b) {
+            return a.x == b.x && a.y == b.y;
+        }));
+    }
+
+    std::uniform_int_distribution<LONG> coord(-1, extent + 1);
+    for (int s = 0; s < 50; s++) {
+        POINT pt = { coord(rng), coord(rng) };
+        if (DistanceToEdges(result, pt.x, pt.y) >= 0.5) {
+            CHECK(polygon.Contains(pt) == EvenOdd(result, pt.x, pt.y));
+        }
+    }
+}
+
+void TestRandomOperands(int range, int scale, int cases) {
+    std::mt19937 rng(range * 1000 + scale);
+    std::uniform_real_distribution<double> coord(-1.0, range * scale + 1.0);
+    int samples = 0;
+    for (int it = 0; it < cases; it++) {
+        std::vector<Contour> a(1, RandomContour(rng, range, scale)), b(1, RandomContour(rng, range, scale));
+        if (rng() % 4 == 0) {
+            a.push_back(RandomContour(rng, range, scale));
+        }
+
+        for (int op = BOOLEAN_UNION; op <= BOOLEAN_DIFFERENCE; op++) {
+            BooleanEngine engine;
+            std::vector<Contour> result;
+            CHECK(engine.Compute(a, b, (BooleanOp)op, &result));
+
+            for (int s = 0; s < 100; s++) {
+                double x = coord(rng), y = coord(rng);
+                if (DistanceToEdges(a, x, y) < 1.0 || DistanceToEdges(b, x, y) < 1.0) {
+                    continue;
+                }
+                bool inA = EvenOdd(a, x, y), inB = EvenOdd(b, x, y);
+                bool expected = (op == BOOLEAN_UNION) ? (inA || inB) :
+                                (op == BOOLEAN_INTERSECTION) ? (inA && inB) : (inA && !inB);
+                CHECK(EvenOdd(result, x, y) == expected);
+                // Contours do not cross and holes wind the other way round,
+                // so the nonzero rule says the same.
+                CHECK((Winding(result, x, y) != 0) == expected);
+                samples++;
+            }
+
+            CheckStored(result, rng, range * scale);
+        }
+    }
+    std::printf("range %d, scale %d: %d cases, %d samples\n", range, scale, cases, samples);
+}
+
+// A polygon drawn through its first point again is still one ring, and a
+// ring break starts a new one wherever it is.
+void TestRings() {
+    const POINT bowtie[] = { { 10, 10 }, { 20, 10 }, { 20, 20 }, { 10, 20 }, { 10, 10 }, { 0, 10 }, { 0, 0 }, { 10, 0 } };
+    TestPolygon polygon;
+    for (const POINT &pt : bowtie) {
+        polygon.AddPoint(pt);
+    }
+    int rings = 0;
+    ForEachPolygonRing(polygon.GetPoints(), [&](const POINT *, size_t n) {
+        CHECK(n == 8);
+        rings++;
+    });
+    CHECK(rings == 1);
+    POINT inFirst = { 15, 15 }, inSecond = { 7, 7 }, outside = { 15, 5 };
+    CHECK(polygon.Contains(inFirst));
+    CHECK(polygon.Contains(inSecond));
+    CHECK(!polygon.Contains(outside));
+
+    // A square with a square hole; the break is neither in the bounds nor moved.
+    const POINT holed[] = { { 0, 0 }, { 30, 0 }, { 30, 30 }, { 0, 30 }, kRingBreak,
+                            { 10, 10 }, { 10, 20 }, { 20, 20 }, { 20, 10 } };
+    TestPolygon square;
+    for (const POINT &pt : holed) {
+        square.AddPoint(pt);
+    }
+    RECT bounds = square.GetBounds();
+    CHECK(bounds.left == 0 && bounds.top == 0 && bounds.right == 30 && bounds.bottom == 30);
+    POINT inHole = { 15, 15 }, inRing = { 5, 15 };
+    CHECK(!square.Contains(inHole));
+    CHECK(square.Contains(inRing));
+
+    square.Translate(100, 50);
+    CHECK(IsRingBreak(square.GetPoints()[4]));
+    bounds = square.GetBounds();
+    CHECK(bounds.left == 100 && bounds.top == 50 && bounds.right == 130 && bounds.bottom == 80);
+
+    POINT moved = { 105, 55 };
+    square.SetPoint(moved, 0);
+    bounds = square.GetBounds();
+    CHECK(bounds.left == 100 && bounds.top == 50);
+    square.SetPoint(kRingBreak, 6);
+    bounds = square.GetBounds();
+    CHECK(bounds.left == 100 && bounds.right == 130 && bounds.bottom == 80);
+
+    // Two squares that touch at a corner make one contour through the corner
+    // twice; it has to survive being stored.
+    std::vector<Contour> a(1), b(1);
+    const POINT sa[] = { { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 } };
+    const POINT sb[] = { { 10, 10 }, { 20, 10 }, { 20, 20 }, { 10, 20 } };
+    a[0].assign(sa, sa + 4);
+    b[0].assign(sb, sb + 4);
+    BooleanEngine engine;
+    std::vector<Contour> result;
+    CHECK(engine.Compute(a, b, BOOLEAN_UNION, &result));
+    std::mt19937 rng(1);
+    CheckStored(result, rng, 20);
+
+    // Operands beyond the range of the engine are refused, even where the
+    // result would be trivial, and the result is left empty.
+    const LONG far = BooleanEngine::kMaxCoordinate + 1;
+    const POINT sc[] = { { far - 10, 0 }, { far, 0 }, { far, 10 }, { far - 10, 10 } };
+    b[0].assign(sc, sc + 4);
+    for (int op = BOOLEAN_UNION; op <= BOOLEAN_DIFFERENCE; op++) {
+        result.assign(1, a[0]);
+        CHECK(!engine.Compute(a, b, (BooleanOp)op, &result) && result.empty());
+        CHECK(!engine.Compute(b, a, (BooleanOp)op, &result) && result.empty());
+    }
+    for (POINT &pt : b[0]) {
+        pt.x = -pt.x;
+    }
+    CHECK(!engine.Compute(a, b, BOOLEAN_UNION, &result));
+    b[0][1].x = -BooleanEngine::kMaxCoordinate;
+    b[0][2].x = -BooleanEngine::kMaxCoordinate;
+    b[0][0].x = -BooleanEngine::kMaxCoordinate + 10;
+    b[0][3].x = -BooleanEngine::kMaxCoordinate + 10;
+    CHECK(engine.Compute(a, b, BOOLEAN_UNION, &result) && result.size() == 2);
+}
+
+int main() {
+    TestRings();
+    TestRandomOperands(8, 1, 3000);
+    TestRandomOperands(200, 1, 3000);
+    TestRandomOperands(40, 16, 3000);
+    return TestResult();
+}
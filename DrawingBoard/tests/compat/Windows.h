@@ -0,0 +1,161 @@
+#ifndef _COMPAT_WINDOWS_H_
+#define _COMPAT_WINDOWS_H_
+
+//
+// Stand-in for the Windows SDK header when the tests are built elsewhere.
+//
+// Only what the headers under test refer to is here, with the sizes the
+// board relies on; nothing that would draw or talk to a window.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+
+typedef long LONG;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef uint32_t DWORD;
+typedef uint32_t COLORREF;
+typedef unsigned char BYTE;
+typedef float FLOAT;
+
+typedef struct HDC__ *HDC;
+typedef void *HGDIOBJ;
+typedef struct HPEN__ *HPEN;
+typedef struct HWND__ *HWND;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef const wchar_t *LPCWSTR;
+
+struct POINT {
+    LONG x, y;
+};
+
+struct RECT {
+    LONG left, top, right, bottom;
+};
+
+struct POINTFLOAT {
+    FLOAT x, y;
+};
+
+#define RGB(r, g, b) ((COLORREF)(((BYTE)(r) | ((uint32_t)(BYTE)(g) << 8)) | ((uint32_t)(BYTE)(b) << 16)))
+#define GetRValue(rgb) ((BYTE)(rgb))
+#define GetGValue(rgb) ((BYTE)((rgb) >> 8))
+#define GetBValue(rgb) ((BYTE)((rgb) >> 16))
+
+// GDI, of which there is none: no bitmap is ever selected into a DC, so
+// drawing through one always takes the fallback path.
+
+const UINT OBJ_BITMAP = 7;
+
+struct BITMAP {
+    LONG bmType, bmWidth, bmHeight, bmWidthBytes;
+    uint16_t bmPlanes, bmBitsPixel;
+    void *bmBits;
+};
+
+struct BITMAPINFOHEADER {
+    DWORD biSize;
+    LONG biWidth, biHeight;
+};
+
+struct DIBSECTION {
+    BITMAP dsBm;
+    BITMAPINFOHEADER dsBmih;
+};
+
+inline HGDIOBJ GetCurrentObject(HDC, UINT) {
+    return nullptr;
+}
+
+inline int GetObject(HGDIOBJ, int, void *) {
+    return 0;
+}
+
+inline BOOL GdiFlush() {
+    return 1;
+}
+
+// Pens, brushes and shapes only exist as far as the code that makes them
+// has to compile.
+
+const int PS_SOLID = 0;
+const int PS_NULL = 5;
+const int PS_USERSTYLE = 7;
+const int PS_ENDCAP_SQUARE = 0x100;
+const int PS_ENDCAP_FLAT = 0x200;
+const int PS_JOIN_MITER = 0x2000;
+const int PS_GEOMETRIC = 0x10000;
+const UINT BS_SOLID = 0;
+const int DC_BRUSH = 18;
+
+struct LOGBRUSH {
+    UINT lbStyle;
+    COLORREF lbColor;
+    uintptr_t lbHatch;
+};
+
+inline HPEN CreatePen(int, int, COLORREF) {
+    return nullptr;
+}
+
+inline HPEN ExtCreatePen(DWORD, DWORD, const LOGBRUSH *, DWORD, const DWORD *) {
+    return nullptr;
+}
+
+inline HGDIOBJ GetStockObject(int) {
+    return nullptr;
+}
+
+inline HGDIOBJ SelectObject(HDC, HGDIOBJ) {
+    return nullptr;
+}
+
+inline BOOL DeleteObject(HGDIOBJ) {
+    return 1;
+}
+
+inline COLORREF SetDCBrushColor(HDC, COLORREF color) {
+    return color;
+}
+
+inline BOOL Rectangle(HDC, int, int, int, int) {
+    return 1;
+}
+
+inline BOOL Ellipse(HDC, int, int, int, int) {
+    return 1;
+}
+
+inline BOOL PolyPolygon(HDC, const POINT *, const int *, int) {
+    return 1;
+}
+
+inline BOOL OffsetRect(RECT *rect, int dx, int dy) {
+    rect->left += dx;
+    rect->right += dx;
+    rect->top += dy;
+    rect->bottom += dy;
+    return 1;
+}
+
+// Windows, of which there are none either: whoever waits for a posted
+// message polls instead.
+
+inline BOOL PostMessage(HWND, UINT, WPARAM, LPARAM) {
+    return 1;
+}
+
+// Files; the tests only use paths in ASCII.
+inline BOOL DeleteFileW(LPCWSTR path) {
+    std::string narrow;
+    for (; *path; path++) {
+        narrow += (char)*path;
+    }
+    return std::remove(narrow.c_str()) == 0;
+}
+
+#endif // _COMPAT_WINDOWS_H_
@@ -0,0 +1,212 @@
+//
+// Round trips of the delta encoding: varints and zigzag-encoded integers at
+// the ends of their ranges, every kind of delta, and frames that are cut
+// short or malformed.
+//
+
+#include <climits>
+#include <random>
+#include <vector>
+
+#include "test.h"
+#include "../delta.h"
+
+void TestVarints() {
+    const uint64_t unsignedValues[] = {
+        0, 1, 127, 128, 255, 16383, 16384, 0xFFFFFFFFu, 0x100000000ull, 0x7FFFFFFFFFFFFFFFull, 0x8000000000000000ull, UINT64_MAX,
+    };
+    const int64_t signedValues[] = {
+        0, 1, -1, 63, -64, 64, -65, INT32_MAX, INT32_MIN, (int64_t)INT32_MAX + 1, (int64_t)INT32_MIN - 1, INT64_MAX, INT64_MIN,
+    };
+
+    std::vector<uint8_t> bytes;
+    for (uint64_t v : unsignedValues) {
+        PutVarint(&bytes, v);
+    }
+    for (int64_t v : signedValues) {
+        PutSigned(&bytes, v);
+    }
+
+    DeltaReader reader(bytes.data(), bytes.size());
+    for (uint64_t v : unsignedValues) {
+        uint64_t read = 0;
+        CHECK(reader.ReadVarint(&read) && read == v);
+    }
+    for (int64_t v : signedValues) {
+        int64_t read = 0;
+        CHECK(reader.ReadSigned(&read) && read == v);
+    }
+    uint64_t extra;
+    CHECK(!reader.ReadVarint(&extra));
+
+    // Small magnitudes of either sign take a byte.
+    bytes.clear();
+    PutSigned(&bytes, -64);
+    CHECK(bytes.size() == 1);
+
+    std::mt19937_64 rng(1);
+    for (int i = 0; i < 100000; i++) {
+        int64_t v = (int64_t)(rng() >> (rng() % 64));
+        v = (rng() & 1) ? v : ~v;
+        bytes.clear();
+        PutSigned(&bytes, v);
+        DeltaReader random(bytes.data(), bytes.size());
+        int64_t read = 0;
+        CHECK(random.ReadSigned(&read) && read == v);
+    }
+
+    // A varint that is cut short, and one that does not end within 64 bits.
+    bytes.clear();
+    PutVarint(&bytes, UINT64_MAX);
+    DeltaReader cut(bytes.data(), bytes.size() - 1);
+    CHECK(!cut.ReadVarint(&extra));
+    std::vector<uint8_t> endless(11, 0x80);
+    DeltaReader overlong(endless.data(), endless.size());
+    CHECK(!overlong.ReadVarint(&extra));
+}
+
+bool SameStyle(const Style &a, const Style &b) {
+    return a.fill == b.fill && a.stroke == b.stroke && a.strokeWidth == b.strokeWidth && a.opacity == b.opacity && a.dash == b.dash;
+}
+
+// Reads back the one frame in `bytes', which has to fill it.
+std::vector<Delta> ReadFrame(const std::vector<uint8_t> &bytes) {
+    std::vector<Delta> deltas;
+    size_t header = 0, size = 0;
+    CHECK(PeekFrame(bytes.data(), bytes.size(), bytes.size(), &header, &size) == FRAME_READY);
+    CHECK(header + size == bytes.size());
+    DeltaReader reader(bytes.data() + header, size);
+    Delta delta;
+    while (reader.Next(&delta)) {
+        deltas.push_back(delta);
+    }
+    return deltas;
+}
+
+void TestBatch() {
+    ShapeId a = { 1, 1 }, b = { 2, 0xFFFFFFFFu };
+    Style style = DefaultStyle();
+    style.fill = 0x00123456;
+    style.stroke = 0x00FFFFFF;
+    style.strokeWidth = 255;
+    style.opacity = 0;
+    style.dash = DASH_DOTTED;
+
+    // Points at the far ends of the range, e.g. a ring break between two rings.
+    std::vector<DeltaPoint> points;
+    const DeltaPoint pts[] = { { 0, 0 }, { 10, -10 }, { INT32_MAX, INT32_MAX }, { INT32_MIN, INT32_MIN }, { -5, 7 }, { INT32_MAX, INT32_MIN } };
+    points.assign(pts, pts + 6);
+
+    DeltaBatch batch;
+    CHECK(batch.Empty());
+    batch.Create(a, "polygon", points, style);
+    batch.Translate(b, 3, -4);
+    batch.Translate(a, 1, 1);
+    batch.Translate(b, -3, 4);   // cancels out and is dropped
+    batch.Translate(a, 2, INT32_MIN);
+    batch.Restyle(b, style);
+    batch.Remove(a);
+    CHECK(!batch.Empty());
+
+    std::vector<uint8_t> bytes;
+    batch.Flush(&bytes);
+    CHECK(batch.Empty());
+
+    std::vector<Delta> deltas = ReadFrame(bytes);
+    CHECK(deltas.size() == 4);
+    if (deltas.size() == 4) {
+        CHECK(deltas[0].op == DELTA_CREATE && deltas[0].shape == a && deltas[0].plugin == "polygon");
+        CHECK(SameStyle(deltas[0].style, style));
+        CHECK(deltas[0].points.size() == points.size());
+        for (size_t i = 0; i < points.size() && i < deltas[0].points.size(); i++) {
+            CHECK(deltas[0].points[i].x == points[i].x && deltas[0].points[i].y == points[i].y);
+        }
+        CHECK(deltas[1].op == DELTA_TRANSLATE && deltas[1].shape == a && deltas[1].dx == 3 && deltas[1].dy == INT32_MIN + 1);
+        CHECK(deltas[2].op == DELTA_RESTYLE && deltas[2].shape == b && SameStyle(deltas[2].style, style));
+        CHECK(deltas[3].op == DELTA_REMOVE && deltas[3].shape == a);
+    }
+
+    // Nothing but translations that cancel out makes no frame at all.
+    batch.Translate(a, 5, 5);
+    batch.Translate(a, -5, -5);
+    bytes.clear();
+    batch.Flush(&bytes);
+    CHECK(bytes.empty());
+
+    // As the server relays a frame: the sender, then the deltas.
+    batch.Remove(b);
+    bytes.clear();
+    batch.Flush(&bytes, 7);
+    size_t header = 0, size = 0;
+    CHECK(PeekFrame(bytes.data(), bytes.size(), bytes.size(), &header, &size) == FRAME_READY);
+    DeltaReader reader(bytes.data() + header, size);
+    uint64_t sender = 0;
+    Delta delta;
+    CHECK(reader.ReadVarint(&sender) && sender == 7);
+    CHECK(reader.Next(&delta) && delta.op == DELTA_REMOVE && delta.shape == b);
+    CHECK(!reader.Next(&delta));
+}
+
+void TestMalformed() {
+    std::vector<DeltaPoint> points(100);
+    DeltaBatch batch;
+    ShapeId id = { 3, 4 };
+    batch.Create(id, "ellipse", points, DefaultStyle());
+    std::vector<uint8_t> bytes;
+    batch.Flush(&bytes);
+
+    // Every cut of the frame is incomplete, and every cut of the payload
+    // makes the create unreadable.
+    size_t header = 0, size = 0;
+    for (size_t n = 0; n < bytes.size(); n++) {
+        CHECK(PeekFrame(bytes.data(), n, bytes.size(), &header, &size) == FRAME_INCOMPLETE);
+    }
+    CHECK(PeekFrame(bytes.data(), bytes.size(), bytes.size(), &header, &size) == FRAME_READY);
+    size_t payload = size;
+    CHECK(PeekFrame(bytes.data(), bytes.size(), payload - 1, &header, &size) == FRAME_CORRUPT);
+    for (size_t n = 0; n < payload; n++) {
+        DeltaReader reader(bytes.data() + header, n);
+        Delta delta;
+        CHECK(!reader.Next(&delta));
+    }
+
+    // An unknown op, a dash pattern out of range, and offsets out of 32 bits.
+    Delta delta;
+    const uint8_t unknownOps[] = { DELTA_REMOVE + 1, 0x7F, 0xFF };
+    for (uint8_t op : unknownOps) {
+        const uint8_t unknown[] = { op, 0, 0 };
+        DeltaReader unknownReader(unknown, sizeof(unknown));
+        CHECK(!unknownReader.Next(&delta));
+    }
+
+    std::vector<uint8_t> restyle(1, (uint8_t)DELTA_RESTYLE);
+    PutShapeId(&restyle, id);
+    Style style = DefaultStyle();
+    style.dash = DASH_COUNT;
+    PutStyle(&restyle, style);
+    DeltaReader restyleReader(restyle.data(), restyle.size());
+    CHECK(!restyleReader.Next(&delta));
+
+    std::vector<uint8_t> translate(1, (uint8_t)DELTA_TRANSLATE);
+    PutShapeId(&translate, id);
+    PutSigned(&translate, (int64_t)INT32_MAX + 1);
+    PutSigned(&translate, 0);
+    DeltaReader translateReader(translate.data(), translate.size());
+    CHECK(!translateReader.Next(&delta));
+
+    // A count of points that the payload cannot hold.
+    std::vector<uint8_t> create(1, (uint8_t)DELTA_CREATE);
+    PutShapeId(&create, id);
+    PutVarint(&create, 0);
+    PutStyle(&create, DefaultStyle());
+    PutVarint(&create, UINT64_MAX / 2);
+    DeltaReader createReader(create.data(), create.size());
+    CHECK(!createReader.Next(&delta));
+}
+
+int main() {
+    TestVarints();
+    TestBatch();
+    TestMalformed();
+    return TestResult();
+}
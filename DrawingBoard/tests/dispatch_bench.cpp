@@ -0,0 +1,242 @@
+//
+// The statically dispatched paths for built-in shapes against the virtual
+// Shape and Painter interfaces that shapes of other plugins go through, on
+// the same boards of 100k shapes:
+//
+//   - bounds of every shape, as the board gathers them for culling;
+//   - hit-testing from the topmost shape down, as a click does;
+//   - moving every shape, as a drag does to one;
+//   - painting into a DIB section, on Windows only; elsewhere there is no
+//     DC to paint into.
+//
+// The shapes are laid out like those of the plugins, so the virtual path is
+// what a plugin that does not use `BuiltinShape' costs.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../builtin_shape.h"
+#include "../dragger.h"
+#include "../painter.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t kShapes = 100000;
+const int kBoard = 4000;
+const int kRuns = 5;
+
+// Best of `kRuns', in milliseconds.
+template <class FUNC>
+double Time(FUNC func) {
+    double best = 1e30;
+    for (int run = 0; run < kRuns; run++) {
+        Clock::time_point start = Clock::now();
+        func();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+template <ShapeKind KIND>
+class BenchShape : public BuiltinShape {
+  public:
+    BenchShape() : BuiltinShape(KIND) {}
+    virtual ~BenchShape() = default;
+
+    virtual Shape* Reset() const override {
+        return new BenchShape;
+    }
+
+    virtual bool Contains(const POINT &pt) const override {
+        return BuiltinGeometry<KIND>::Contains(m_points, m_bounds, pt);
+    }
+};
+
+template <ShapeKind KIND>
+class BenchPainter : public Painter {
+  public:
+    virtual void Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const override {
+        std::vector<const std::vector<POINT>*> batch(1, &points);
+        DrawBuiltinBatch<KIND>(hdc, batch, style);
+    }
+
+    virtual void StartDrawing(Shape *shape, const POINT &pt) const override {}
+
+    virtual void Update(Shape *shape, const POINT &pt) const override {}
+};
+
+std::vector<Shape*> MakeBoard(std::mt19937 &rng) {
+    std::vector<Shape*> shapes;
+    for (size_t i = 0; i < kShapes; i++) {
+        Shape *shape;
+        size_t n = 2;
+        switch (rng() % 3) {
+            case 0:
+                shape = new BenchShape<SHAPE_RECTANGLE>;
+                break;
+            case 1:
+                shape = new BenchShape<SHAPE_ELLIPSE>;
+                break;
+            default:
+                shape = new BenchShape<SHAPE_POLYGON>;
+                n = 3 + rng() % 10;
+                break;
+        }
+        LONG x = rng() % kBoard, y = rng() % kBoard;
+        for (size_t k = 0; k < n; k++) {
+            POINT pt = { x + (LONG)(rng() % 40), y + (LONG)(rng() % 40) };
+            shape->AddPoint(pt);
+        }
+        shapes.push_back(shape);
+    }
+    return shapes;
+}
+
+void Report(const char *name, double staticMs, double virtualMs) {
+    std::printf("%-12s %10.3f ms static %10.3f ms virtual %8.2fx\n", name, staticMs, virtualMs, virtualMs / staticMs);
+}
+
+#ifdef _WIN32
+void BenchPaint(const std::vector<Shape*> &shapes) {
+    BITMAPINFO bmi;
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = kBoard;
+    bmi.bmiHeader.biHeight = -kBoard;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    void *bits;
+    HDC hdc = ::CreateCompatibleDC(NULL);
+    HBITMAP hBitmap = ::CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    HGDIOBJ hOld = ::SelectObject(hdc, hBitmap);
+
+    BenchPainter<SHAPE_RECTANGLE> rectangles;
+    BenchPainter<SHAPE_ELLIPSE> ellipses;
+    BenchPainter<SHAPE_POLYGON> polygons;
+    const Painter *painters[] = { nullptr, &rectangles, &ellipses, &polygons };
+    Style style = DefaultStyle();
+
+    // Runs of shapes of a kind go in one call, as the renderer batches them.
+    double staticMs = Time([&]() {
+        std::vector<const std::vector<POINT>*> batch;
+        for (size_t i = 0; i < shapes.size(); i++) {
+            batch.push_back(&static_cast<const BuiltinShape*>(shapes[i])->BuiltinShape::GetPoints());
+            if (i + 1 == shapes.size() || shapes[i + 1]->GetKind() != shapes[i]->GetKind()) {
+                BuiltinDrawBatch(shapes[i]->GetKind(), hdc, batch, style);
+                batch.clear();
+            }
+        }
+    });
+    double virtualMs = Time([&]() {
+        for (const Shape *shape : shapes) {
+            painters[shape->GetKind()]->Draw(hdc, shape->GetPoints(), style);
+        }
+    });
+    Report("paint", staticMs, virtualMs);
+
+    ::SelectObject(hdc, hOld);
+    ::DeleteObject(hBitmap);
+    ::DeleteDC(hdc);
+}
+#endif
+
+int main() {
+    std::mt19937 rng(1);
+    std::vector<Shape*> shapes = MakeBoard(rng);
+    std::printf("%u shapes\n", (unsigned)kShapes);
+
+    std::vector<RECT> bounds(shapes.size());
+    Report("bounds", Time([&]() {
+        GetShapeBounds(shapes.data(), shapes.size(), bounds.data());
+    }), Time([&]() {
+        for (size_t i = 0; i < shapes.size(); i++) {
+            bounds[i] = shapes[i]->GetBounds();
+        }
+    }));
+
+    // Every click checks the bounds of every shape; only those that contain
+    // the point are asked.
+    std::vector<POINT> clicks(200);
+    for (POINT &pt : clicks) {
+        pt.x = rng() % kBoard;
+        pt.y = rng() % kBoard;
+    }
+    std::vector<int> hitsStatic(clicks.size()), hitsVirtual(clicks.size());
+    GetShapeBounds(shapes.data(), shapes.size(), bounds.data());
+    double staticMs = Time([&]() {
+        for (size_t c = 0; c < clicks.size(); c++) {
+            const POINT &pt = clicks[c];
+            hitsStatic[c] = -1;
+            for (size_t i = shapes.size(); i-- > 0;) {
+                const RECT &r = bounds[i];
+                if (pt.x < r.left || pt.x > r.right || pt.y < r.top || pt.y > r.bottom) {
+                    continue;
+                }
+                const BuiltinShape *shape = static_cast<const BuiltinShape*>(shapes[i]);
+                bool contains;
+                BuiltinContains(shape->GetKind(), shape->BuiltinShape::GetPoints(), r, pt, &contains);
+                if (contains) {
+                    hitsStatic[c] = (int)i;
+                    break;
+                }
+            }
+        }
+    });
+    double virtualMs = Time([&]() {
+        for (size_t c = 0; c < clicks.size(); c++) {
+            const POINT &pt = clicks[c];
+            hitsVirtual[c] = -1;
+            for (size_t i = shapes.size(); i-- > 0;) {
+                RECT r = shapes[i]->GetBounds();
+                if (pt.x < r.left || pt.x > r.right || pt.y < r.top || pt.y > r.bottom) {
+                    continue;
+                }
+                if (shapes[i]->Contains(pt)) {
+                    hitsVirtual[c] = (int)i;
+                    break;
+                }
+            }
+        }
+    });
+    Report("hit-test", staticMs, virtualMs);
+    if (hitsStatic != hitsVirtual) {
+        std::printf("the paths disagree on what was hit\n");
+        return 1;
+    }
+
+    // Back and forth, so that every run starts from the same board.
+    Report("drag", Time([&]() {
+        for (Shape *shape : shapes) {
+            Dragger::Translate(shape, 3, -2);
+        }
+        for (Shape *shape : shapes) {
+            Dragger::Translate(shape, -3, 2);
+        }
+    }), Time([&]() {
+        for (int d = 1; d >= -1; d -= 2) {
+            for (Shape *shape : shapes) {
+                const std::vector<POINT> &points = shape->GetPoints();
+                for (size_t i = 0; i < points.size(); i++) {
+                    POINT pt = { points[i].x + 3 * d, points[i].y - 2 * d };
+                    shape->SetPoint(pt, (int)i);
+                }
+            }
+        }
+    }));
+
+#ifdef _WIN32
+    BenchPaint(shapes);
+#else
+    std::printf("%-12s not measured without a DC\n", "paint");
+#endif
+
+    for (Shape *shape : shapes) {
+        delete shape;
+    }
+    return 0;
+}
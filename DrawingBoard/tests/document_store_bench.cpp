@@ -0,0 +1,201 @@
+//
+// A board of 10M shapes that does not fit into memory, kept in a document
+// store, while the window pans over all of it:
+//
+//   - writing the board out, a tile at a time, as shapes come in from a
+//     session, and how much memory the store takes for it;
+//   - panning row by row over every tile, reading tiles back as they come
+//     into view and paging the ones that have been out of view the longest
+//     out again once the points in memory take more than 256 MB, as
+//     `MainWindow::UpdatePages()' does.
+//
+// Memory is counted by replacing the global allocator. The number of shapes
+// may be given on the command line.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <new>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "../document_store.h"
+
+// Bytes currently allocated; every block carries its size in front.
+std::atomic<long long> g_allocated(0);
+
+const size_t kHeader = 16;
+
+void *operator new(size_t size) {
+    char *block = (char*)std::malloc(size + kHeader);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *(size_t*)block = size;
+    g_allocated += size;
+    return block + kHeader;
+}
+
+void operator delete(void *p) throw() {
+    if (p) {
+        char *block = (char*)p - kHeader;
+        g_allocated -= *(size_t*)block;
+        std::free(block);
+    }
+}
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t kResidentBytes = 256 << 20;
+const LONG kPrefetch = 1024;
+const LONG kWindowWidth = 1920, kWindowHeight = 1080;
+const LONG kTile = 1 << DocumentStore::kTileShift;
+
+double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+uint64_t TileKey(LONG x, LONG y) {
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+// The shapes of one tile, small ones around points inside it.
+void MakeTile(std::mt19937 &rng, LONG tx, LONG ty, size_t count, uint32_t *serial, std::vector<StoredShape> *shapes) {
+    shapes->resize(count);
+    for (StoredShape &shape : *shapes) {
+        shape.id.client = 1 + rng() % 8;
+        shape.id.serial = ++*serial;
+        shape.serial = *serial;
+        shape.points.resize((rng() % 3 == 2) ? 3 + rng() % 14 : 2);
+        LONG cx = tx * kTile + 32 + rng() % (kTile - 64), cy = ty * kTile + 32 + rng() % (kTile - 64);
+        for (POINT &pt : shape.points) {
+            pt.x = cx + (LONG)(rng() % 64) - 32;
+            pt.y = cy + (LONG)(rng() % 64) - 32;
+        }
+    }
+}
+
+size_t PointBytes(const std::vector<StoredShape> &shapes) {
+    size_t bytes = 0;
+    for (const StoredShape &shape : shapes) {
+        bytes += shape.points.size() * sizeof(POINT);
+    }
+    return bytes;
+}
+
+struct Resident {
+    std::vector<StoredShape> shapes;
+    std::list<uint64_t>::iterator use;
+};
+
+int main(int argc, char **argv) {
+    size_t nShapes = (argc > 1) ? (size_t)std::atoll(argv[1]) : 10000000;
+    LONG side = 1;
+    while ((size_t)(side * side) * 250 < nShapes) {
+        side++;
+    }
+    size_t perTile = (nShapes + side * side - 1) / (side * side);
+    std::printf("%u shapes on %ld x %ld tiles of %ld pixels\n", (unsigned)(perTile * side * side), (long)side,
+                (long)side, (long)kTile);
+
+    long long before = g_allocated;
+    DocumentStore store(std::tmpfile());
+
+    // Every tile is written once, as one block.
+    std::mt19937 rng(1);
+    uint32_t serial = 0;
+    std::vector<StoredShape> shapes;
+    Clock::time_point start = Clock::now();
+    for (LONG ty = 0; ty < side; ty++) {
+        for (LONG tx = 0; tx < side; tx++) {
+            MakeTile(rng, tx, ty, perTile, &serial, &shapes);
+            if (!store.Write(TileKey(tx, ty), shapes)) {
+                std::printf("cannot write the store\n");
+                return 1;
+            }
+        }
+    }
+    std::vector<StoredShape>().swap(shapes);
+    double writeSeconds = Seconds(start);
+    long long storeBytes = g_allocated - before;
+    std::printf("%-32s %12.2f s, %.1f MB on disk\n", "write", writeSeconds, store.GetFileSize() / 1048576.0);
+    std::printf("%-32s %12.1f bytes per shape, %.1f KB in all\n", "store in memory", (double)storeBytes / store.GetCurrentCount(),
+                storeBytes / 1024.0);
+
+    // Panning, one tile at a time, along every row; back and forth.
+    std::unordered_map<uint64_t, Resident> resident;
+    std::list<uint64_t> uses;  // the most recently used first
+    size_t residentBytes = 0, peakBytes = 0, tilesRead = 0, tilesWritten = 0;
+    long long peakAllocated = 0;
+    double worstStep = 0.0;
+    size_t steps = 0;
+    start = Clock::now();
+    for (LONG ty = 0; ty < side; ty++) {
+        for (LONG i = 0; i < side; i++) {
+            LONG tx = (ty % 2 == 0) ? i : side - 1 - i;
+            Clock::time_point stepStart = Clock::now();
+
+            RECT view = { tx * kTile - kPrefetch, ty * kTile - kPrefetch, tx * kTile + kWindowWidth + kPrefetch,
+                          ty * kTile + kWindowHeight + kPrefetch };
+            std::vector<uint64_t> wanted;
+            DocumentStore::ForEachTile(view, [&](uint64_t tile) {
+                wanted.push_back(tile);
+            });
+            for (uint64_t tile : wanted) {
+                auto it = resident.find(tile);
+                if (it != resident.end()) {
+                    uses.splice(uses.begin(), uses, it->second.use);
+                    continue;
+                }
+                Resident &entry = resident[tile];
+                if (!store.Read(tile, &entry.shapes)) {
+                    std::printf("cannot read the store\n");
+                    return 1;
+                }
+                store.Discard(tile, entry.shapes.size());
+                uses.push_front(tile);
+                entry.use = uses.begin();
+                residentBytes += PointBytes(entry.shapes);
+                tilesRead++;
+            }
+
+            while (residentBytes > kResidentBytes) {
+                uint64_t tile = uses.back();
+                if (std::find(wanted.begin(), wanted.end(), tile) != wanted.end()) {
+                    break;
+                }
+                Resident &entry = resident[tile];
+                for (StoredShape &shape : entry.shapes) {
+                    shape.serial = ++serial;
+                }
+                if (!store.Write(tile, entry.shapes)) {
+                    std::printf("cannot write the store\n");
+                    return 1;
+                }
+                residentBytes -= PointBytes(entry.shapes);
+                uses.pop_back();
+                resident.erase(tile);
+                tilesWritten++;
+            }
+
+            peakBytes = std::max(peakBytes, residentBytes);
+            peakAllocated = std::max(peakAllocated, (long long)g_allocated);
+            worstStep = std::max(worstStep, Seconds(stepStart));
+            steps++;
+        }
+    }
+    double panSeconds = Seconds(start);
+
+    std::printf("%-32s %12.2f s, %.3f ms per step on average, %.3f ms at worst\n", "pan over the board", panSeconds,
+                1000.0 * panSeconds / steps, 1000.0 * worstStep);
+    std::printf("%-32s %12u read, %u written\n", "tiles", (unsigned)tilesRead, (unsigned)tilesWritten);
+    std::printf("%-32s %12.1f MB of points, %.1f MB allocated in all\n", "peak in memory", peakBytes / 1048576.0,
+                peakAllocated / 1048576.0);
+    std::printf("%-32s %12.1f MB\n", "on disk at the end", store.GetFileSize() / 1048576.0);
+    return 0;
+}
@@ -0,0 +1,251 @@
+//
+// Round trips through the document store: records of every size, tiles that
+// take several blocks, records that stop being current, pinning, paging on a
+// worker pool, and an export of a board some of whose shapes are paged out,
+// which has to come out the same as that of the board in memory.
+//
+
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "../exporter.h"
+
+StoredShape MakeShape(std::mt19937 &rng, uint32_t serial) {
+    StoredShape shape;
+    shape.id.client = rng();
+    shape.id.serial = rng();
+    shape.serial = serial;
+    shape.points.resize(rng() % 50);
+    for (POINT &pt : shape.points) {
+        if (rng() % 10 == 0) {
+            pt = kRingBreak;
+        } else {
+            pt.x = (LONG)(int32_t)rng();
+            pt.y = (LONG)(int32_t)rng();
+        }
+    }
+    return shape;
+}
+
+bool SameShape(const StoredShape &a, const StoredShape &b) {
+    if (a.id.client != b.id.client || a.id.serial != b.id.serial || a.serial != b.serial ||
+        a.points.size() != b.points.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.points.size(); i++) {
+        if (a.points[i].x != b.points[i].x || a.points[i].y != b.points[i].y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestTiles() {
+    RECT origin = { 0, 0, 10, 10 };
+    RECT negative = { -10, -10, -2, -2 };
+    RECT far = { (LONG)1 << 20, 0, ((LONG)1 << 20) + 10, 10 };
+    CHECK(DocumentStore::TileOf(origin) != DocumentStore::TileOf(negative));
+    CHECK(DocumentStore::TileOf(origin) != DocumentStore::TileOf(far));
+
+    // A shape goes with the tile of its center.
+    RECT across = { -100, 0, 200, 10 };
+    CHECK(DocumentStore::TileOf(across) == DocumentStore::TileOf(origin));
+
+    // Every tile a rectangle touches, each once, among them those of the
+    // shapes inside it.
+    RECT view = { -3000, -10, 3000, 10 };
+    std::vector<uint64_t> tiles;
+    DocumentStore::ForEachTile(view, [&](uint64_t tile) {
+        tiles.push_back(tile);
+    });
+    CHECK(tiles.size() == 8);
+    bool hasOrigin = false, hasNegative = false;
+    for (uint64_t tile : tiles) {
+        hasOrigin |= tile == DocumentStore::TileOf(origin);
+        hasNegative |= tile == DocumentStore::TileOf(negative);
+    }
+    CHECK(hasOrigin && hasNegative);
+}
+
+void TestRoundTrip() {
+    DocumentStore store(std::tmpfile());
+    std::mt19937 rng(1);
+
+    // Three tiles, written in blocks that interleave in the file.
+    std::vector<StoredShape> written[3];
+    uint32_t serial = 0;
+    for (int block = 0; block < 20; block++) {
+        int tile = rng() % 3;
+        std::vector<StoredShape> shapes;
+        for (int i = rng() % 30; i > 0; i--) {
+            shapes.push_back(MakeShape(rng, ++serial));
+        }
+        CHECK(store.Write(tile, shapes));
+        written[tile].insert(written[tile].end(), shapes.begin(), shapes.end());
+    }
+    CHECK(store.GetCurrentCount() == written[0].size() + written[1].size() + written[2].size());
+
+    for (int tile = 0; tile < 3; tile++) {
+        std::vector<StoredShape> read;
+        CHECK(store.Read(tile, &read));
+        CHECK(read.size() == written[tile].size());
+        for (size_t i = 0; i < read.size() && i < written[tile].size(); i++) {
+            CHECK(SameShape(read[i], written[tile][i]));
+        }
+    }
+
+    // A tile that was never written has no records.
+    std::vector<StoredShape> none;
+    CHECK(store.Read(7, &none) && none.empty());
+
+    // Neither has a tile once none of its records are current, while the
+    // others keep theirs.
+    uint64_t size = store.GetFileSize();
+    store.Discard(0, written[0].size() - 1);
+    CHECK(store.Read(0, &none) && none.size() == written[0].size());
+    none.clear();
+    store.Discard(0, 1);
+    CHECK(store.Read(0, &none) && none.empty());
+    CHECK(store.GetCurrentCount() == written[1].size() + written[2].size());
+    CHECK(store.GetFileSize() == size);
+
+    // Unless it is pinned.
+    store.Pin();
+    store.Discard(1, written[1].size());
+    CHECK(store.Read(1, &none) && none.size() == written[1].size());
+    none.clear();
+    store.Unpin();
+    CHECK(store.Read(1, &none) && none.empty());
+}
+
+// Writes tiles on a pool, then reads them back on it.
+void TestPageJob() {
+    DocumentStore store(std::tmpfile());
+    std::mt19937 rng(2);
+    std::vector<PageJob::Page> pages(64), expected;
+    uint32_t serial = 0;
+    for (size_t i = 0; i < pages.size(); i++) {
+        pages[i].tile = i;
+        for (int k = rng() % 20; k > 0; k--) {
+            pages[i].shapes.push_back(MakeShape(rng, ++serial));
+        }
+    }
+    expected = pages;
+
+    WorkerPool pool(nullptr, 0, 4);
+    for (int write = 1; write >= 0; write--) {
+        if (!write) {
+            for (PageJob::Page &page : pages) {
+                page.shapes.clear();
+            }
+        }
+        std::shared_ptr<PageJob> job = std::make_shared<PageJob>(&store, pages, write != 0);
+        bool done = false;
+        pool.Submit(job, 1, [&]() {
+            done = true;
+        });
+        while (!done) {
+            pool.DispatchCompletions();
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < job->GetPages().size(); i++) {
+            CHECK(job->Succeeded(i));
+        }
+        pages.swap(job->GetPages());
+    }
+
+    CHECK(pages.size() == expected.size());
+    for (size_t i = 0; i < pages.size() && i < expected.size(); i++) {
+        CHECK(pages[i].tile == expected[i].tile);
+        CHECK(pages[i].shapes.size() == expected[i].shapes.size());
+        for (size_t k = 0; k < pages[i].shapes.size() && k < expected[i].shapes.size(); k++) {
+            CHECK(SameShape(pages[i].shapes[k], expected[i].shapes[k]));
+        }
+    }
+}
+
+std::string ReadAll(FILE *file) {
+    std::string text;
+    std::rewind(file);
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+    return text;
+}
+
+std::string Export(const Scene &scene, const DocumentStore *store) {
+    StyleTable styles;
+    FILE *file = std::tmpfile();
+    SvgWriter writer(file);
+    CHECK(ExportScene(scene, styles, SerializerMap(), &writer, store));
+    std::string text = ReadAll(file);
+    std::fclose(file);
+    return text;
+}
+
+// Every other shape of the board is paged out, some of them after they have
+// been moved, as the board does it.
+void TestExport() {
+    std::mt19937 rng(3);
+    Scene resident, paged;
+    DocumentStore store(std::tmpfile());
+    uint32_t serial = 0;
+    for (int i = 0; i < 2000; i++) {
+        std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+        item->kind = (ShapeKind)(SHAPE_RECTANGLE + rng() % 3);
+        item->painter = nullptr;
+        item->points.resize((item->kind == SHAPE_POLYGON) ? 3 + rng() % 10 : 2);
+        for (POINT &pt : item->points) {
+            pt.x = rng() % 20000;
+            pt.y = rng() % 20000;
+        }
+        item->style = kDefaultStyle;
+        item->bounds = PointsExtent(item->points);
+        resident.PushBack(item);
+
+        if (i % 2 == 0) {
+            paged.PushBack(item);
+            continue;
+        }
+        POINT offset = { (LONG)(rng() % 100) - 50, (LONG)(rng() % 100) - 50 };
+        std::vector<StoredShape> shapes(1);
+        shapes[0].id.client = 1;
+        shapes[0].id.serial = i;
+        shapes[0].serial = ++serial;
+        for (const POINT &pt : item->points) {
+            POINT moved = { pt.x - offset.x, pt.y - offset.y };
+            shapes[0].points.push_back(moved);
+        }
+
+        std::shared_ptr<SceneItem> stub = std::make_shared<SceneItem>(*item);
+        stub->points.clear();
+        stub->tile = DocumentStore::TileOf(item->bounds);
+        stub->serial = serial;
+        stub->offset = offset;
+        CHECK(store.Write(stub->tile, shapes));
+        paged.PushBack(stub);
+    }
+
+    std::string expected = Export(resident, nullptr);
+    CHECK(!expected.empty());
+    CHECK(Export(paged, &store) == expected);
+
+    // Without the store the paged out shapes are left out.
+    CHECK(Export(paged, nullptr) != expected);
+}
+
+int main() {
+    TestTiles();
+    TestRoundTrip();
+    TestPageJob();
+    TestExport();
+    return TestResult();
+}
@@ -0,0 +1,109 @@
+//
+// Exporting boards of 100k and 1M shapes to SVG and PDF: how long it takes,
+// how large the file gets, and how much memory the export needs on top of
+// the board, which should not grow with it.
+//
+// Memory is counted by replacing the global allocator; the peak is what was
+// allocated at most at any time during the export.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "../exporter.h"
+
+// Bytes currently allocated, and the most there were since the last reset;
+// every block carries its size in front.
+std::atomic<long long> g_allocated(0), g_peak(0);
+
+const size_t kHeader = 16;
+
+void *operator new(size_t size) {
+    char *block = (char*)std::malloc(size + kHeader);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *(size_t*)block = size;
+    long long now = g_allocated += size;
+    long long peak = g_peak;
+    while (now > peak && !g_peak.compare_exchange_weak(peak, now)) {
+    }
+    return block + kHeader;
+}
+
+void operator delete(void *p) throw() {
+    if (p) {
+        char *block = (char*)p - kHeader;
+        g_allocated -= *(size_t*)block;
+        std::free(block);
+    }
+}
+
+typedef std::chrono::steady_clock Clock;
+
+Scene MakeBoard(size_t count, StyleTable *styles) {
+    const Style translucent = { RGB(140, 180, 255), RGB(128, 128, 128), 2, 128, DASH_DASHED };
+    StyleId ids[2] = { kDefaultStyle, styles->Intern(translucent) };
+
+    std::mt19937 rng(1);
+    Scene scene;
+    for (size_t i = 0; i < count; i++) {
+        std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+        item->kind = (ShapeKind)(SHAPE_RECTANGLE + rng() % 3);
+        item->painter = nullptr;
+        item->points.resize((item->kind == SHAPE_POLYGON) ? 3 + rng() % 10 : 2);
+        LONG x = rng() % 20000, y = rng() % 20000;
+        for (POINT &pt : item->points) {
+            pt.x = x + rng() % 50;
+            pt.y = y + rng() % 50;
+        }
+        item->style = ids[rng() % 2];
+        item->bounds = PointsExtent(item->points);
+        scene.PushBack(item);
+    }
+    return scene;
+}
+
+template <class WRITER>
+void Bench(const char *name, const Scene &scene, const StyleTable &styles) {
+    FILE *file = std::tmpfile();
+    if (!file) {
+        std::printf("cannot create a temporary file\n");
+        return;
+    }
+
+    long long before = g_allocated;
+    g_peak = before;
+    Clock::time_point start = Clock::now();
+    bool ok;
+    {
+        WRITER writer(file);
+        ok = ExportScene(scene, styles, SerializerMap(), &writer);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    long long peak = g_peak - before;
+
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    std::printf("%-4s %8u shapes %8.2f s %10.1f MB %10.1f KB peak memory%s\n", name, (unsigned)scene.Size(), seconds,
+                size / 1048576.0, peak / 1024.0, ok ? "" : " (failed)");
+}
+
+int main() {
+    const size_t sizes[] = { 100000, 1000000 };
+    for (size_t count : sizes) {
+        StyleTable styles;
+        Scene scene = MakeBoard(count, &styles);
+        Bench<SvgWriter>("SVG", scene, styles);
+        Bench<PdfWriter>("PDF", scene, styles);
+    }
+    return 0;
+}
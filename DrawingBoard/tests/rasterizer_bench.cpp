@@ -0,0 +1,100 @@
+//
+// Throughput of the anti-aliased rasterizer on an 8K (7680x4320) target:
+// a shape as large as the target, on all cores and on one, many small
+// shapes, and the SIMD blend on its own.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../rasterizer.h"
+
+const int kWidth = 7680;
+const int kHeight = 4320;
+const int kRuns = 3;
+
+// Best of `kRuns', in milliseconds.
+template <class FUNC>
+double Time(FUNC func) {
+    double best = 1e30;
+    for (int i = 0; i < kRuns; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+Outline Ellipse(float cx, float cy, float a, float b, int n) {
+    Outline outline(n);
+    for (int i = 0; i < n; i++) {
+        outline[i].x = cx + a * std::cos(6.2831853f * i / n);
+        outline[i].y = cy + b * std::sin(6.2831853f * i / n);
+    }
+    return outline;
+}
+
+void Report(const char *name, double ms, double pixels) {
+    std::printf("%-28s %9.2f ms %9.1f Mpixel/s\n", name, ms, pixels / ms / 1000.0);
+}
+
+int main() {
+    std::vector<BYTE> pixels((size_t)kWidth * kHeight * 4, 255);
+    PixelTarget target = { pixels.data(), kWidth * 4, kWidth, kHeight };
+    double frame = (double)kWidth * kHeight;
+
+    Style style = DefaultStyle();
+    style.fill = RGB(40, 90, 200);
+    style.strokeWidth = 4;
+
+    std::printf("%dx%d, %u hardware threads\n", kWidth, kHeight, std::thread::hardware_concurrency());
+
+    // One shape that covers the target: the band-parallel path.
+    std::vector<Outline> big(1, Ellipse(kWidth / 2.0f, kHeight / 2.0f, kWidth * 0.49f, kHeight * 0.49f, 4096));
+    Report("full-frame ellipse", Time([&]() {
+        DrawOutlinesAA(target, big, style);
+    }), frame);
+
+    RECT clip = { 0, 0, kWidth, kHeight };
+    Report("full-frame ellipse, 1 thread", Time([&]() {
+        DrawBandsAA(big, style, pixels.data(), kWidth * 4, clip, 0, 1);
+    }), frame);
+
+    // Many small shapes, one call each.
+    std::mt19937 rng(7);
+    std::vector<std::vector<Outline> > small;
+    double area = 0.0;
+    for (int i = 0; i < 20000; i++) {
+        float r = 5.0f + rng() % 36;
+        float cx = (float)(rng() % kWidth), cy = (float)(rng() % kHeight);
+        small.push_back(std::vector<Outline>(1, Ellipse(cx, cy, r, r * 0.7f, 64)));
+        area += (2 * r + 6) * (1.4 * r + 6);
+    }
+    Report("20000 small ellipses", Time([&]() {
+        for (const std::vector<Outline> &shape : small) {
+            DrawOutlinesAA(target, shape, style);
+        }
+    }), area);
+
+    // The blend alone, over coverage that is partial everywhere.
+    RECT band = { 0, 0, kWidth, kBandRows };
+    Rasterizer rasterizer(band);
+    std::vector<Outline> wedge(1, Outline(3));
+    wedge[0][0].x = 0.0f;          wedge[0][0].y = 0.0f;
+    wedge[0][1].x = (float)kWidth; wedge[0][1].y = 0.0f;
+    wedge[0][2].x = 0.0f;          wedge[0][2].y = (float)kBandRows * 4;
+    rasterizer.Fill(wedge[0]);
+    Report("composite only", Time([&]() {
+        for (int top = 0; top + kBandRows <= kHeight; top += kBandRows) {
+            rasterizer.Composite(pixels.data() + (size_t)top * kWidth * 4, kWidth * 4, style.fill, 0.8f);
+        }
+    }), (double)kWidth * (kHeight / kBandRows * kBandRows));
+
+    return 0;
+}
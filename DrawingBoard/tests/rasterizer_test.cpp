@@ -0,0 +1,320 @@
+//
+// Quality tests of the anti-aliased rasterizer.
+//
+// Every shape is drawn black on white and compared with a reference image
+// made by point-sampling the same shape on a dense grid inside every pixel;
+// the two have to agree to within the sampling error of the reference. The
+// reference knows nothing about area accumulation, so this checks the
+// coverage, the fill rule, clipping and the SIMD blend all at once.
+//
+// Fills follow the even-odd rule, as hit tests and GDI's ALTERNATE mode do:
+// the middle of a star, which the outline winds around twice, stays empty.
+// Pen coverage adds up where the pen turns a sharp corner and saturates at
+// one. The references do the same: a pixel is as dark as the share of its
+// samples inside the shape, or the mean number of pen segments over it, says.
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "test.h"
+#include "../rasterizer.h"
+
+const float kPi = 3.14159265f;
+
+// A white 32bpp image.
+struct Image {
+    int width, height;
+    std::vector<BYTE> pixels;
+
+    Image(int w, int h) : width(w), height(h), pixels((size_t)w * h * 4, 255) {}
+
+    PixelTarget Target() {
+        PixelTarget target = { pixels.data(), width * 4, width, height };
+        return target;
+    }
+
+    BYTE Gray(int x, int y) const {
+        return pixels[((size_t)y * width + x) * 4];
+    }
+};
+
+// 1 if `(x, y)' is inside the outlines by the even-odd rule, 0 otherwise.
+int EvenOdd(const std::vector<Outline> &outlines, float x, float y) {
+    int winding = 0;
+    for (const Outline &outline : outlines) {
+        for (size_t i = 0, n = outline.size(); i < n; i++) {
+            const POINTFLOAT &a = outline[i], &b = outline[(i + 1) % n];
+            if ((a.y <= y) != (b.y <= y)) {
+                float t = (y - a.y) / (b.y - a.y);
+                if (a.x + t * (b.x - a.x) > x) {
+                    winding += (b.y > a.y) ? 1 : -1;
+                }
+            }
+        }
+    }
+    return winding & 1;
+}
+
+// How many segments of a pen of width `width' along the outlines cover
+// `(x, y)'; a segment is the edge extended by half the width at both ends,
+// and as wide as the pen.
+int PenCount(const std::vector<Outline> &outlines, float width, float x, float y) {
+    float hw = width / 2;
+    int count = 0;
+    for (const Outline &outline : outlines) {
+        for (size_t i = 0, n = outline.size(); i < n; i++) {
+            const POINTFLOAT &a = outline[i], &b = outline[(i + 1) % n];
+            float ex = b.x - a.x, ey = b.y - a.y;
+            float len = std::sqrt(ex * ex + ey * ey);
+            if (len == 0.0f) {
+                continue;
+            }
+            ex /= len;
+            ey /= len;
+            float t = (x - a.x) * ex + (y - a.y) * ey;
+            float d = (x - a.x) * -ey + (y - a.y) * ex;
+            if (std::fabs(d) <= hw && t >= -hw && t <= len + hw) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+// The image `DrawOutlinesAA()' should produce when it draws black on white
+// what `coverage' describes: how much ink a point gets, saturating at one.
+// Pixel (px, py) is centered on the point (px, py), as with GDI.
+template <class COVERAGE>
+Image Reference(int w, int h, int samples, COVERAGE coverage) {
+    Image image(w, h);
+    for (int py = 0; py < h; py++) {
+        for (int px = 0; px < w; px++) {
+            int sum = 0;
+            for (int j = 0; j < samples; j++) {
+                for (int i = 0; i < samples; i++) {
+                    float x = px - 0.5f + (i + 0.5f) / samples;
+                    float y = py - 0.5f + (j + 0.5f) / samples;
+                    sum += coverage(x, y);
+                }
+            }
+            float mean = std::min((float)sum / (samples * samples), 1.0f);
+            int a = (int)(mean * 256.0f + 0.5f);
+            BYTE gray = (BYTE)((255 * (256 - a)) >> 8);
+            BYTE *p = &image.pixels[((size_t)py * w + px) * 4];
+            p[0] = p[1] = p[2] = gray;
+        }
+    }
+    return image;
+}
+
+// Compares the color channels of two images; `maxError' bounds every pixel
+// and `meanError' the average over the pixels that are not white in either.
+void Compare(const char *name, const Image &actual, const Image &expected, int maxError, double meanError) {
+    int worst = 0;
+    double sum = 0.0;
+    int count = 0;
+    for (int y = 0; y < actual.height; y++) {
+        for (int x = 0; x < actual.width; x++) {
+            const BYTE *p = &actual.pixels[((size_t)y * actual.width + x) * 4];
+            const BYTE *q = &expected.pixels[((size_t)y * actual.width + x) * 4];
+            for (int c = 0; c < 3; c++) {
+                int error = std::abs((int)p[c] - (int)q[c]);
+                worst = std::max(worst, error);
+                if (p[c] != 255 || q[c] != 255) {
+                    sum += error;
+                    count++;
+                }
+            }
+        }
+    }
+    double mean = count ? sum / count : 0.0;
+    std::printf("%-16s max error %3d, mean error %.3f\n", name, worst, mean);
+    CHECK(worst <= maxError);
+    CHECK(mean <= meanError);
+}
+
+Style FillStyle() {
+    Style style = DefaultStyle();
+    style.fill = RGB(0, 0, 0);
+    style.strokeWidth = 0;
+    return style;
+}
+
+Style StrokeStyle(int width) {
+    Style style = DefaultStyle();
+    style.strokeWidth = (uint8_t)width;
+    return style;
+}
+
+Outline Polygon(const float *xy, size_t n) {
+    Outline outline(n);
+    for (size_t i = 0; i < n; i++) {
+        outline[i].x = xy[2 * i];
+        outline[i].y = xy[2 * i + 1];
+    }
+    return outline;
+}
+
+Outline Ellipse(float cx, float cy, float a, float b, int n) {
+    Outline outline(n);
+    for (int i = 0; i < n; i++) {
+        outline[i].x = cx + a * std::cos(2 * kPi * i / n);
+        outline[i].y = cy + b * std::sin(2 * kPi * i / n);
+    }
+    return outline;
+}
+
+void TestFill(const char *name, int w, int h, const std::vector<Outline> &outlines, int maxError = 6,
+              double meanError = 0.6) {
+    Image actual(w, h);
+    DrawOutlinesAA(actual.Target(), outlines, FillStyle());
+    Image expected = Reference(w, h, 32, [&](float x, float y) {
+        return EvenOdd(outlines, x, y);
+    });
+    Compare(name, actual, expected, maxError, meanError);
+}
+
+void TestFills() {
+    // Edges at quarter pixels, where the reference is exact.
+    const float rect[] = { 10.25f, 7.5f, 40.75f, 7.5f, 40.75f, 30.25f, 10.25f, 30.25f };
+    TestFill("rectangle", 51, 38, std::vector<Outline>(1, Polygon(rect, 4)), 2);
+
+    TestFill("disc", 64, 64, std::vector<Outline>(1, Ellipse(32.4f, 31.7f, 20.3f, 20.3f, 256)));
+    TestFill("thin ellipse", 70, 20, std::vector<Outline>(1, Ellipse(35.0f, 9.6f, 30.0f, 2.2f, 256)));
+
+    // Self-intersecting: the pentagon in the middle winds twice and is left out.
+    // Coverage is folded after it has been summed up, so a pixel where two
+    // edges cross, with as much of it outside as in the pentagon, comes out
+    // as if it were all inside; that is the few pixels at the corners of the
+    // pentagon.
+    Outline star(5);
+    for (int i = 0; i < 5; i++) {
+        star[i].x = 30.0f + 24.0f * std::sin(4 * kPi * i / 5);
+        star[i].y = 30.0f - 24.0f * std::cos(4 * kPi * i / 5);
+    }
+    TestFill("star", 60, 60, std::vector<Outline>(1, star), 96, 0.8);
+    Image starImage(60, 60);
+    DrawOutlinesAA(starImage.Target(), std::vector<Outline>(1, star), FillStyle());
+    CHECK(starImage.Gray(30, 30) == 255);
+    CHECK(starImage.Gray(30, 10) == 0);
+
+    // Two overlapping squares wound the same way: the overlap is a hole too.
+    const float left[] = { 5, 5, 35, 5, 35, 35, 5, 35 };
+    const float right[] = { 20.5f, 20.5f, 50.5f, 20.5f, 50.5f, 50.5f, 20.5f, 50.5f };
+    std::vector<Outline> overlap;
+    overlap.push_back(Polygon(left, 4));
+    overlap.push_back(Polygon(right, 4));
+    TestFill("overlap", 56, 56, overlap);
+
+    // A hole wound the other way round, as boolean operations produce them.
+    const float outer[] = { 4, 4, 52, 6, 50, 50, 6, 48 };
+    const float inner[] = { 18.5f, 18.5f, 18.5f, 34.2f, 36.7f, 34.2f, 36.7f, 18.5f };
+    std::vector<Outline> ring;
+    ring.push_back(Polygon(outer, 4));
+    ring.push_back(Polygon(inner, 4));
+    TestFill("hole", 56, 56, ring);
+
+    const float sliver[] = { 2.0f, 3.0f, 60.0f, 5.5f, 2.0f, 4.0f };
+    TestFill("sliver", 64, 10, std::vector<Outline>(1, Polygon(sliver, 3)));
+
+    // Partly off the target on every side.
+    TestFill("clipped", 40, 30, std::vector<Outline>(1, Ellipse(20.0f, 15.0f, 26.0f, 19.0f, 256)));
+}
+
+void TestStroke(const char *name, const std::vector<Outline> &outlines, int width) {
+    Image actual(64, 64);
+    DrawOutlinesAA(actual.Target(), outlines, StrokeStyle(width));
+    Image expected = Reference(64, 64, 32, [&](float x, float y) {
+        return PenCount(outlines, (float)width, x, y);
+    });
+    Compare(name, actual, expected, 6, 0.6);
+}
+
+void TestStrokes() {
+    const float square[] = { 10, 10, 50, 10, 50, 50, 10, 50 };
+    TestStroke("thin outline", std::vector<Outline>(1, Polygon(square, 4)), 1);
+    TestStroke("thick outline", std::vector<Outline>(1, Polygon(square, 4)), 5);
+
+    const float slanted[] = { 8.3f, 12.1f, 55.2f, 4.7f, 40.6f, 57.9f };
+    TestStroke("slanted outline", std::vector<Outline>(1, Polygon(slanted, 3)), 3);
+}
+
+// Dashes of four times the width with gaps of twice the width along the top
+// edge of a square: about two thirds of it is inked, in one run per dash.
+void TestDashes() {
+    const float square[] = { 10, 10, 70, 10, 70, 40, 10, 40 };
+    Style style = StrokeStyle(2);
+    style.dash = DASH_DASHED;
+
+    Image image(80, 50);
+    DrawOutlinesAA(image.Target(), std::vector<Outline>(1, Polygon(square, 4)), style);
+
+    int inked = 0, runs = 0;
+    bool inside = false;
+    for (int x = 12; x < 69; x++) {
+        bool dark = image.Gray(x, 10) < 128;
+        inked += dark ? 1 : 0;
+        runs += (dark && !inside) ? 1 : 0;
+        inside = dark;
+    }
+    std::printf("dashes           %d of 57 pixels inked in %d runs\n", inked, runs);
+    CHECK(runs >= 4 && runs <= 6);
+    CHECK(inked > 57 / 2 && inked < 57 * 5 / 6);
+}
+
+void TestOpacity() {
+    const float rect[] = { 5, 5, 25, 5, 25, 25, 5, 25 };
+    Style style = FillStyle();
+    style.opacity = 128;
+
+    Image image(30, 30);
+    DrawOutlinesAA(image.Target(), std::vector<Outline>(1, Polygon(rect, 4)), style);
+    CHECK(std::abs((int)image.Gray(15, 15) - 127) <= 1);
+    CHECK(image.Gray(2, 2) == 255);
+}
+
+// Large targets are split among the threads of a band pool, and bottom-up
+// bitmaps are walked backwards; neither may change a single pixel.
+void TestThreadsAndStride() {
+    const int w = 1280, h = 900;
+    std::vector<Outline> outlines(1, Ellipse(640.3f, 450.8f, 600.0f, 420.0f, 4096));
+    Style style = StrokeStyle(3);
+    style.fill = RGB(40, 90, 200);
+
+    BandPool bands(3);
+    Image threaded(w, h);
+    DrawOutlinesAA(threaded.Target(), outlines, style, &bands);
+
+    Image serial(w, h);
+    std::vector<Outline> shifted = outlines;
+    for (Outline &outline : shifted) {
+        for (POINTFLOAT &pt : outline) {
+            pt.x += 0.5f;
+            pt.y += 0.5f;
+        }
+    }
+    RECT clip = { 0, 0, w, h };
+    DrawBandsAA(shifted, style, serial.pixels.data(), w * 4, clip, 0, 1);
+    CHECK(threaded.pixels == serial.pixels);
+
+    Image flipped(w, h);
+    PixelTarget target = { flipped.pixels.data() + (size_t)(h - 1) * w * 4, -w * 4, w, h };
+    DrawOutlinesAA(target, outlines, style, &bands);
+    bool same = true;
+    for (int y = 0; y < h && same; y++) {
+        same = std::equal(&flipped.pixels[(size_t)(h - 1 - y) * w * 4], &flipped.pixels[(size_t)(h - y) * w * 4],
+                          &threaded.pixels[(size_t)y * w * 4]);
+    }
+    CHECK(same);
+}
+
+int main() {
+    TestFills();
+    TestStrokes();
+    TestDashes();
+    TestOpacity();
+    TestThreadsAndStride();
+    return TestResult();
+}
@@ -0,0 +1,146 @@
+//
+// Cost of the persistent scene on a board of 100k shapes, against deep
+// copying every shape into a frame, as the board did before `Scene':
+//
+//   - a snapshot, i.e. what handing a frame to the render thread costs;
+//   - an edit of one shape followed by a snapshot, as on every mouse move
+//     of a drag;
+//   - the memory the trie takes on top of the items, and what a snapshot
+//     that the render thread still holds keeps alive after an edit.
+//
+// Memory is counted by replacing the global allocator.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "../scene.h"
+
+// Bytes currently allocated; every block carries its size in front.
+std::atomic<long long> g_allocated(0);
+
+const size_t kHeader = 16;
+
+void *operator new(size_t size) {
+    char *block = (char*)std::malloc(size + kHeader);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *(size_t*)block = size;
+    g_allocated += size;
+    return block + kHeader;
+}
+
+void operator delete(void *p) throw() {
+    if (p) {
+        char *block = (char*)p - kHeader;
+        g_allocated -= *(size_t*)block;
+        std::free(block);
+    }
+}
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t kShapes = 100000;
+const int kRuns = 5;
+
+// Best of `kRuns', in microseconds, of `func()' repeated `count' times.
+template <class FUNC>
+double Time(int count, FUNC func) {
+    double best = 1e30;
+    for (int run = 0; run < kRuns; run++) {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < count; i++) {
+            func(i);
+        }
+        best = std::min(best, std::chrono::duration<double, std::micro>(Clock::now() - start).count() / count);
+    }
+    return best;
+}
+
+Scene::ItemPtr MakeItem(std::mt19937 &rng) {
+    std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+    item->kind = (ShapeKind)(SHAPE_RECTANGLE + rng() % 3);
+    item->painter = nullptr;
+    item->points.resize((item->kind == SHAPE_POLYGON) ? 3 + rng() % 30 : 2);
+    for (POINT &pt : item->points) {
+        pt.x = rng() % 4000;
+        pt.y = rng() % 4000;
+    }
+    item->style = kDefaultStyle;
+    item->bounds = PointsExtent(item->points);
+    return item;
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::vector<Scene::ItemPtr> items;
+    for (size_t i = 0; i < kShapes; i++) {
+        items.push_back(MakeItem(rng));
+    }
+
+    long long before = g_allocated;
+    Scene scene;
+    for (const Scene::ItemPtr &item : items) {
+        scene.PushBack(item);
+    }
+    long long trie = g_allocated - before;
+
+    // What the board used to hand the render thread: a copy of every shape.
+    before = g_allocated;
+    std::vector<SceneItem> deep;
+    deep.reserve(kShapes);
+    for (const Scene::ItemPtr &item : items) {
+        deep.push_back(*item);
+    }
+    long long deepBytes = g_allocated - before;
+
+    std::printf("%u shapes\n", (unsigned)kShapes);
+    std::printf("%-36s %12.3f us\n", "snapshot: copy a Scene", Time(10000, [&](int) {
+        Scene copy = scene;
+        (void)copy;
+    }));
+    std::printf("%-36s %12.3f us\n", "snapshot: deep copy", Time(1, [&](int) {
+        std::vector<SceneItem> copy(deep);
+        (void)copy;
+    }));
+
+    // A drag: one shape is replaced, then the frame is handed over.
+    std::vector<Scene::ItemPtr> edits;
+    for (int i = 0; i < 1000; i++) {
+        edits.push_back(MakeItem(rng));
+    }
+    std::vector<size_t> indices;
+    for (int i = 0; i < 1000; i++) {
+        indices.push_back(rng() % kShapes);
+    }
+    std::printf("%-36s %12.3f us\n", "edit + snapshot: Scene", Time(1000, [&](int i) {
+        scene.Set(indices[i], edits[i]);
+        Scene copy = scene;
+        (void)copy;
+    }));
+    std::printf("%-36s %12.3f us\n", "edit + snapshot: deep copy", Time(1, [&](int i) {
+        deep[indices[i]] = *edits[i];
+        std::vector<SceneItem> copy(deep);
+        (void)copy;
+    }));
+
+    // A snapshot held across an edit keeps the old path alive, and only that.
+    Scene held = scene;
+    before = g_allocated;
+    scene.Set(indices[0], edits[1]);
+    long long path = g_allocated - before;
+    held = Scene();
+
+    std::printf("%-36s %12.1f bytes per shape\n", "trie on top of the items", (double)trie / kShapes);
+    std::printf("%-36s %12.1f bytes per shape\n", "deep copy", (double)deepBytes / kShapes);
+    std::printf("%-36s %12lld bytes\n", "kept alive by a held snapshot", path);
+    return 0;
+}
@@ -0,0 +1,188 @@
+//
+// The snap index on boards with millions of anchors, against the linear scan
+// over every anchor that it replaces:
+//
+//   - building the index from a scene on a worker pool, as a session that
+//     has just been joined does;
+//   - snapping, near anchors where there is something to find and anywhere
+//     on the board, as the cursor does on every mouse move;
+//   - moving a shape, as a drag does, and removing one;
+//   - the linear scan, for a few of the same queries.
+//
+// The number of shapes may be given on the command line.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../snap_index.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const LONG kRadius = 8;
+const LONG kBoard = 100000;
+
+double Nanoseconds(Clock::time_point start, size_t count) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+}
+
+Scene MakeBoard(size_t count) {
+    std::mt19937 rng(1);
+    Scene scene;
+    for (size_t i = 0; i < count; i++) {
+        std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+        item->kind = (ShapeKind)(SHAPE_RECTANGLE + rng() % 3);
+        item->painter = nullptr;
+        item->points.resize((item->kind == SHAPE_POLYGON) ? 3 + rng() % 10 : 2);
+        LONG x = rng() % kBoard, y = rng() % kBoard;
+        for (POINT &pt : item->points) {
+            pt.x = x + rng() % 100;
+            pt.y = y + rng() % 100;
+        }
+        item->style = kDefaultStyle;
+        item->bounds = PointsExtent(item->points);
+        scene.PushBack(item);
+    }
+    return scene;
+}
+
+// Points within a few radii of an anchor, and points anywhere. Shapes that
+// have been removed have no anchors to be near.
+std::vector<POINT> MakeQueries(std::mt19937 &rng, const std::vector<std::vector<POINT> > &anchors, bool near, size_t count) {
+    std::vector<POINT> queries(count);
+    for (POINT &pt : queries) {
+        if (near) {
+            const std::vector<POINT> *owner;
+            do {
+                owner = &anchors[rng() % anchors.size()];
+            } while (owner->empty());
+            const POINT &anchor = (*owner)[rng() % owner->size()];
+            pt.x = anchor.x + (LONG)(rng() % (4 * kRadius + 1)) - 2 * kRadius;
+            pt.y = anchor.y + (LONG)(rng() % (4 * kRadius + 1)) - 2 * kRadius;
+        } else {
+            pt.x = rng() % kBoard;
+            pt.y = rng() % kBoard;
+        }
+    }
+    return queries;
+}
+
+bool Scan(const std::vector<std::vector<POINT> > &anchors, const POINT &pt, POINT *found) {
+    int64_t best = (int64_t)kRadius * kRadius + 1;
+    for (const std::vector<POINT> &owner : anchors) {
+        for (const POINT &anchor : owner) {
+            int64_t dx = anchor.x - pt.x, dy = anchor.y - pt.y;
+            int64_t d = dx * dx + dy * dy;
+            if (d < best) {
+                best = d;
+                *found = anchor;
+            }
+        }
+    }
+    return best <= (int64_t)kRadius * kRadius;
+}
+
+int main(int argc, char **argv) {
+    size_t nShapes = (argc > 1) ? (size_t)std::atoll(argv[1]) : 1000000;
+    Scene scene = MakeBoard(nShapes);
+    std::vector<int> keys(nShapes);
+    std::vector<const void*> owners(nShapes);
+    std::vector<std::vector<POINT> > anchors(nShapes);
+    size_t nAnchors = 0;
+    for (size_t i = 0; i < nShapes; i++) {
+        owners[i] = &keys[i];
+        GetSnapAnchors(scene[i].kind, scene[i].points, &anchors[i]);
+        nAnchors += anchors[i].size();
+    }
+    std::printf("%u shapes, %u anchors on %ld x %ld pixels\n", (unsigned)nShapes, (unsigned)nAnchors, (long)kBoard,
+                (long)kBoard);
+
+    // Built on a pool, as `MainWindow' does; the index itself is filled on
+    // the thread that collects the job.
+    SnapIndex index(kRadius);
+    Clock::time_point start = Clock::now();
+    {
+        std::shared_ptr<SnapIndexJob> job = std::make_shared<SnapIndexJob>(scene, owners, kRadius);
+        bool done = false;
+        WorkerPool pool(nullptr, 0, std::max(1u, std::thread::hardware_concurrency()));
+        pool.Submit(job, 4096, [&]() {
+            done = true;
+        });
+        while (!done) {
+            pool.DispatchCompletions();
+            std::this_thread::yield();
+        }
+        index.Swap(job->GetIndex());
+    }
+    std::printf("%-24s %12.1f ms\n", "build", Nanoseconds(start, 1) / 1e6);
+
+    std::mt19937 rng(2);
+    const size_t kQueries = 1000000;
+    for (int near = 1; near >= 0; near--) {
+        std::vector<POINT> queries = MakeQueries(rng, anchors, near != 0, kQueries);
+        size_t snapped = 0;
+        POINT anchor;
+        start = Clock::now();
+        for (const POINT &pt : queries) {
+            snapped += index.Snap(pt, nullptr, &anchor) ? 1 : 0;
+        }
+        double ns = Nanoseconds(start, queries.size());
+        std::printf("%-24s %12.1f ns per query, %.1f%% snapped\n", near ? "snap near anchors" : "snap anywhere", ns,
+                    100.0 * snapped / queries.size());
+    }
+
+    // A drag moves one shape a few pixels at a time, replacing its anchors.
+    const size_t kMoves = 200000;
+    start = Clock::now();
+    for (size_t i = 0; i < kMoves; i++) {
+        std::vector<POINT> &moved = anchors[rng() % nShapes];
+        LONG dx = (LONG)(rng() % 7) - 3, dy = (LONG)(rng() % 7) - 3;
+        for (POINT &pt : moved) {
+            pt.x += dx;
+            pt.y += dy;
+        }
+        index.Update(&keys[&moved - anchors.data()], moved);
+    }
+    std::printf("%-24s %12.1f ns per shape\n", "move", Nanoseconds(start, kMoves));
+
+    // Every fifth shape, so that there are anchors left to scan for.
+    const size_t nRemoves = nShapes / 5;
+    start = Clock::now();
+    for (size_t i = 0; i < nRemoves; i++) {
+        index.Remove(&keys[5 * i]);
+    }
+    std::printf("%-24s %12.1f ns per shape\n", "remove", Nanoseconds(start, nRemoves));
+    for (size_t i = 0; i < nRemoves; i++) {
+        std::vector<POINT>().swap(anchors[5 * i]);
+    }
+
+    // What every mouse move cost before there was an index; the answers have
+    // to agree with it.
+    const size_t kScans = 20;
+    std::vector<POINT> queries = MakeQueries(rng, anchors, true, kScans);
+    size_t disagree = 0;
+    start = Clock::now();
+    for (const POINT &pt : queries) {
+        POINT found = { 0, 0 }, anchor = { 0, 0 };
+        bool scanned = Scan(anchors, pt, &found);
+        bool snapped = index.Snap(pt, nullptr, &anchor);
+        int64_t dFound = (int64_t)(found.x - pt.x) * (found.x - pt.x) + (int64_t)(found.y - pt.y) * (found.y - pt.y);
+        int64_t dAnchor = (int64_t)(anchor.x - pt.x) * (anchor.x - pt.x) + (int64_t)(anchor.y - pt.y) * (anchor.y - pt.y);
+        if (scanned != snapped || (scanned && dFound != dAnchor)) {
+            disagree++;
+        }
+    }
+    std::printf("%-24s %12.1f ms per query\n", "linear scan", Nanoseconds(start, kScans) / 1e6);
+    if (disagree) {
+        std::printf("the index and the scan disagree on %u queries\n", (unsigned)disagree);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,233 @@
+//
+// The snap index against a linear scan over the same points: random updates,
+// moves and removals of owners, with queries around them, on both sides of
+// the origin and with and without an owner to leave out; then an index built
+// from a scene on a worker pool, against one built owner by owner.
+//
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "test.h"
+#include "../snap_index.h"
+
+const LONG kRadius = 8;
+
+typedef std::unordered_map<const void*, std::vector<POINT> > Owners;
+
+// Squared distance to the closest point within the radius, or -1.
+int64_t Nearest(const Owners &owners, const POINT &pt, const void *exclude) {
+    int64_t best = -1;
+    for (const auto &owner : owners) {
+        if (owner.first == exclude) {
+            continue;
+        }
+        for (const POINT &anchor : owner.second) {
+            int64_t dx = anchor.x - pt.x, dy = anchor.y - pt.y;
+            int64_t d = dx * dx + dy * dy;
+            if (d <= (int64_t)kRadius * kRadius && (best < 0 || d < best)) {
+                best = d;
+            }
+        }
+    }
+    return best;
+}
+
+// Whether the index answers `pt' as the scan does. Ties may go either way, so
+// the anchor found only has to be as close as the closest one.
+bool SameAnswer(const SnapIndex &index, const Owners &owners, const POINT &pt, const void *exclude) {
+    POINT anchor = { 0, 0 };
+    bool snapped = index.Snap(pt, exclude, &anchor);
+    int64_t best = Nearest(owners, pt, exclude);
+    if (!snapped || best < 0) {
+        return snapped == (best >= 0);
+    }
+
+    int64_t dx = anchor.x - pt.x, dy = anchor.y - pt.y;
+    if (dx * dx + dy * dy != best) {
+        return false;
+    }
+    // It has to be a point of an owner that is not left out.
+    for (const auto &owner : owners) {
+        if (owner.first == exclude) {
+            continue;
+        }
+        for (const POINT &p : owner.second) {
+            if (p.x == anchor.x && p.y == anchor.y) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::vector<POINT> RandomAnchors(std::mt19937 &rng, LONG range) {
+    std::vector<POINT> anchors(1 + rng() % 10);
+    LONG x = (LONG)(rng() % (2 * range)) - range, y = (LONG)(rng() % (2 * range)) - range;
+    for (POINT &pt : anchors) {
+        pt.x = x + (LONG)(rng() % 40) - 20;
+        pt.y = y + (LONG)(rng() % 40) - 20;
+    }
+    // Now and then a point twice, as a degenerate shape has them.
+    if (rng() % 8 == 0) {
+        anchors.push_back(anchors[0]);
+    }
+    return anchors;
+}
+
+void TestAgainstScan(LONG range, int rounds) {
+    std::mt19937 rng(range);
+    SnapIndex index(kRadius);
+    Owners owners;
+    std::vector<int> keys(300);  // the owners are only compared, so any address does
+    const void *last = nullptr;
+
+    for (int round = 0; round < rounds; round++) {
+        const void *owner = &keys[rng() % keys.size()];
+        switch (rng() % 4) {
+            case 0:
+            case 1: {
+                std::vector<POINT> anchors = RandomAnchors(rng, range);
+                index.Update(owner, anchors);
+                owners[owner] = anchors;
+                break;
+            }
+            case 2: {
+                // A move: the same points, shifted.
+                auto it = owners.find(owner);
+                if (it != owners.end()) {
+                    LONG dx = (LONG)(rng() % 21) - 10, dy = (LONG)(rng() % 21) - 10;
+                    for (POINT &pt : it->second) {
+                        pt.x += dx;
+                        pt.y += dy;
+                    }
+                    index.Update(owner, it->second);
+                }
+                break;
+            }
+            default:
+                index.Remove(owner);
+                owners.erase(owner);
+                break;
+        }
+        last = owner;
+
+        for (int q = 0; q < 20; q++) {
+            POINT pt;
+            if (!owners.empty() && q % 2 == 0) {
+                // Near a point of some owner, where there is something to find.
+                auto it = owners.begin();
+                std::advance(it, rng() % owners.size());
+                const POINT &near = it->second[rng() % it->second.size()];
+                pt.x = near.x + (LONG)(rng() % (4 * kRadius + 1)) - 2 * kRadius;
+                pt.y = near.y + (LONG)(rng() % (4 * kRadius + 1)) - 2 * kRadius;
+            } else {
+                pt.x = (LONG)(rng() % (2 * range)) - range;
+                pt.y = (LONG)(rng() % (2 * range)) - range;
+            }
+            const void *exclude = (q % 3 == 0) ? last : nullptr;
+            CHECK(SameAnswer(index, owners, pt, exclude));
+        }
+    }
+
+    // Removing everything leaves nothing to snap to.
+    for (const auto &owner : owners) {
+        index.Remove(owner.first);
+    }
+    index.Remove(&keys[0]);
+    POINT pt = { 0, 0 }, anchor;
+    for (int q = 0; q < 100; q++) {
+        pt.x = (LONG)(rng() % (2 * range)) - range;
+        pt.y = (LONG)(rng() % (2 * range)) - range;
+        CHECK(!index.Snap(pt, nullptr, &anchor));
+    }
+}
+
+// Points right at the radius snap, one further do not; cells are
+// 2 * radius wide, so these sit on both sides of cell borders.
+void TestRadius() {
+    SnapIndex index(kRadius);
+    int owner;
+    std::vector<POINT> anchors(1);
+    for (LONG x = -3 * kRadius; x <= 3 * kRadius; x++) {
+        anchors[0].x = x;
+        anchors[0].y = -x;
+        index.Update(&owner, anchors);
+        for (LONG dx = -kRadius - 1; dx <= kRadius + 1; dx++) {
+            POINT pt = { x + dx, -x }, anchor = { 0, 0 };
+            bool snapped = index.Snap(pt, nullptr, &anchor);
+            CHECK(snapped == (dx >= -kRadius && dx <= kRadius));
+            CHECK(!snapped || (anchor.x == x && anchor.y == -x));
+            CHECK(!index.Snap(pt, &owner, &anchor));
+        }
+    }
+}
+
+// A scene indexed on a pool; paged out items have no points and no anchors.
+void TestJob() {
+    std::mt19937 rng(7);
+    Scene scene;
+    std::vector<int> keys(2000);
+    std::vector<const void*> owners;
+    Owners expected;
+    SnapIndex incremental(kRadius);
+    for (size_t i = 0; i < keys.size(); i++) {
+        std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+        item->kind = (ShapeKind)(SHAPE_RECTANGLE + rng() % 3);
+        item->painter = nullptr;
+        if (i % 10 != 0) {
+            item->points.resize((item->kind == SHAPE_POLYGON) ? 3 + rng() % 5 : 2);
+            for (POINT &pt : item->points) {
+                pt.x = rng() % 3000;
+                pt.y = rng() % 3000;
+            }
+        }
+        item->style = kDefaultStyle;
+        item->bounds = PointsExtent(item->points);
+        scene.PushBack(item);
+        owners.push_back(&keys[i]);
+
+        std::vector<POINT> anchors;
+        if (!item->points.empty()) {
+            GetSnapAnchors(item->kind, item->points, &anchors);
+            expected[&keys[i]] = anchors;
+        }
+        incremental.Update(&keys[i], anchors);
+    }
+
+    std::shared_ptr<SnapIndexJob> job = std::make_shared<SnapIndexJob>(scene, owners, kRadius);
+    bool done = false;
+    {
+        WorkerPool pool(nullptr, 0, 4);
+        pool.Submit(job, 64, [&]() {
+            done = true;
+        });
+        while (!done) {
+            pool.DispatchCompletions();
+            std::this_thread::yield();
+        }
+    }
+
+    SnapIndex built(1);
+    built.Swap(job->GetIndex());
+    CHECK(built.GetRadius() == kRadius);
+    for (int q = 0; q < 2000; q++) {
+        POINT pt = { (LONG)(rng() % 3000), (LONG)(rng() % 3000) };
+        const void *exclude = owners[rng() % owners.size()];
+        CHECK(SameAnswer(built, expected, pt, exclude));
+        CHECK(SameAnswer(incremental, expected, pt, exclude));
+    }
+}
+
+int main() {
+    TestAgainstScan(100, 3000);
+    TestAgainstScan(5000, 3000);
+    TestRadius();
+    TestJob();
+    return TestResult();
+}
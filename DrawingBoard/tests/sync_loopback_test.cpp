@@ -0,0 +1,313 @@
+//
+// A session over loopback: a server on its own thread and a few clients, each
+// on a thread of its own, editing a shared board at a frame rate for a couple
+// of seconds. Every client keeps its board the way MainWindow does; at the
+// end all boards have to agree, and so does the board of a client that joins
+// only then.
+//
+// Along the way it measures how long an edit takes to reach the other
+// clients and how many bytes an edit costs. Every client moves a probe shape
+// of its own one pixel right per frame, so where a board sees a probe says
+// which frame of its client it has got to.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "../sync_client.h"
+#include "../../SyncServer/sync_server.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const int kClients = 4;
+const int kFrameMs = 16;
+const int kSessionMs = 2000;
+const int kSettleMs = 10000;
+
+struct BoardShape {
+    std::vector<DeltaPoint> points;
+    Style style;
+
+    bool operator==(const BoardShape &other) const {
+        return points.size() == other.points.size() && style.fill == other.style.fill &&
+               std::equal(points.begin(), points.end(), other.points.begin(), [](const DeltaPoint &a, const DeltaPoint &b) {
+                   return a.x == b.x && a.y == b.y;
+               });
+    }
+};
+
+// Shapes by id, edited the way `MainWindow::ApplyRemoteEdit()' does.
+struct Board {
+    std::map<uint64_t, BoardShape> shapes;
+
+    void Apply(uint32_t self, uint32_t sender, const Delta &delta) {
+        auto it = shapes.find(delta.shape.Key());
+        switch (delta.op) {
+            case DELTA_CREATE:
+                if (it == shapes.end()) {
+                    BoardShape shape = { delta.points, delta.style };
+                    shapes[delta.shape.Key()] = shape;
+                }
+                break;
+            case DELTA_TRANSLATE:
+                if (it != shapes.end() && sender != self) {
+                    Move(&it->second, delta.dx, delta.dy);
+                }
+                break;
+            case DELTA_RESTYLE:
+                if (it != shapes.end()) {
+                    it->second.style = delta.style;
+                }
+                break;
+            case DELTA_REMOVE:
+                if (it != shapes.end()) {
+                    shapes.erase(it);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void Move(BoardShape *shape, int32_t dx, int32_t dy) {
+        for (DeltaPoint &pt : shape->points) {
+            pt.x += dx;
+            pt.y += dy;
+        }
+    }
+};
+
+struct ClientStats {
+    uint64_t sent, received;
+    long edits;
+};
+
+// Shared by the clients, by client id.
+std::mutex g_mutex;
+std::map<uint32_t, std::vector<Clock::time_point> > g_frameSent;  // when each frame went out
+std::map<uint32_t, int32_t> g_lastFrame;                          // of the clients done editing
+std::vector<double> g_latencies;                                  // in milliseconds
+
+bool IsProbe(const ShapeId &id) {
+    return id.serial == 1;
+}
+
+void RunClient(unsigned short port, Board *board, ClientStats *stats) {
+    SyncClient client;
+    if (!client.Connect(port)) {
+        CHECK(!"cannot connect");
+        return;
+    }
+    uint32_t self = client.GetClientId();
+    std::mt19937 rng(self);
+    std::vector<ShapeId> mine;
+    std::map<uint32_t, int32_t> seen;  // the last frame of every other client that arrived
+    stats->edits = 0;
+
+    ShapeId probe = client.NewShapeId();
+    CHECK(IsProbe(probe));
+    std::vector<DeltaPoint> probePoints(1);
+    probePoints[0].x = 0;
+    probePoints[0].y = 0;
+    client.Edits().Create(probe, "probe", probePoints, DefaultStyle());
+    BoardShape probeShape = { probePoints, DefaultStyle() };
+    board->shapes[probe.Key()] = probeShape;
+
+    auto receive = [&](uint32_t sender, const Delta &delta) {
+        board->Apply(self, sender, delta);
+        if (delta.op != DELTA_TRANSLATE || sender == self || !IsProbe(delta.shape) || delta.shape.client != sender) {
+            return;
+        }
+        auto it = board->shapes.find(delta.shape.Key());
+        if (it == board->shapes.end()) {
+            return;
+        }
+        int32_t frame = it->second.points[0].x;
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(g_mutex);
+        const std::vector<Clock::time_point> &sent = g_frameSent[sender];
+        if (frame >= 1 && frame <= (int32_t)sent.size()) {
+            g_latencies.push_back(std::chrono::duration<double, std::milli>(now - sent[frame - 1]).count());
+        }
+        seen[sender] = frame;
+    };
+
+    // Edits go out once per frame; in between, what arrives is applied right
+    // away, so that latencies are not rounded up to whole frames.
+    Clock::time_point start = Clock::now(), next = start;
+    int32_t frame = 0;
+    while (Clock::now() - start < std::chrono::milliseconds(kSessionMs)) {
+        if (Clock::now() >= next) {
+            next += std::chrono::milliseconds(kFrameMs);
+            frame++;
+            Board::Move(&board->shapes[probe.Key()], 1, 0);
+            client.Edits().Translate(probe, 1, 0);
+            stats->edits++;
+
+            if (mine.size() < 5 || rng() % 10 == 0) {
+                ShapeId id = client.NewShapeId();
+                std::vector<DeltaPoint> points(4);
+                int32_t x = rng() % 1000, y = rng() % 1000;
+                for (DeltaPoint &pt : points) {
+                    pt.x = x + (int32_t)(rng() % 50);
+                    pt.y = y + (int32_t)(rng() % 50);
+                }
+                client.Edits().Create(id, "polygon", points, DefaultStyle());
+                BoardShape shape = { points, DefaultStyle() };
+                board->shapes[id.Key()] = shape;
+                mine.push_back(id);
+                stats->edits++;
+            }
+
+            // A drag: several moves a frame, which the batch merges.
+            for (int k = 0; k < 4; k++) {
+                ShapeId id = mine[rng() % mine.size()];
+                auto it = board->shapes.find(id.Key());
+                if (it != board->shapes.end()) {
+                    int32_t dx = (int32_t)(rng() % 7) - 3, dy = (int32_t)(rng() % 7) - 3;
+                    Board::Move(&it->second, dx, dy);
+                    client.Edits().Translate(id, dx, dy);
+                    stats->edits++;
+                }
+            }
+
+            // Restyles and removals of anyone's shapes but the probes.
+            if (rng() % 3 == 0) {
+                auto it = board->shapes.begin();
+                std::advance(it, rng() % board->shapes.size());
+                ShapeId id = { (uint32_t)(it->first >> 32), (uint32_t)it->first };
+                if (!IsProbe(id)) {
+                    if (rng() % 4 != 0 || board->shapes.size() < 20) {
+                        it->second.style.fill = rng() & 0xFFFFFF;
+                        client.Edits().Restyle(id, it->second.style);
+                    } else {
+                        board->shapes.erase(it);
+                        client.Edits().Remove(id);
+                    }
+                    stats->edits++;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                g_frameSent[self].push_back(Clock::now());
+            }
+            CHECK(client.Flush());
+        }
+        CHECK(client.Poll(receive));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    // Then waits for the last frames of everyone else.
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_lastFrame[self] = frame;
+    }
+    Clock::time_point settle = Clock::now();
+    for (;;) {
+        CHECK(client.Flush());
+        CHECK(client.Poll(receive));
+
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            done = g_lastFrame.size() == kClients;
+            for (const auto &last : g_lastFrame) {
+                done = done && (last.first == self || seen[last.first] == last.second);
+            }
+        }
+        if (done) {
+            break;
+        }
+        if (Clock::now() - settle > std::chrono::milliseconds(kSettleMs)) {
+            CHECK(!"the last frames of the other clients never arrived");
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stats->sent = client.BytesSent();
+    stats->received = client.BytesReceived();
+}
+
+int main() {
+    if (!StartSockets()) {
+        return 1;
+    }
+
+    // Any free port will do.
+    std::unique_ptr<SyncServer> server;
+    unsigned short port = kSyncPort + 100;
+    for (; port < kSyncPort + 200; port++) {
+        server.reset(new SyncServer);
+        if (server->Listen(port)) {
+            break;
+        }
+    }
+    std::atomic<bool> stop(false);
+    std::thread serverThread([&]() {
+        while (!stop && server->Serve(10)) {
+        }
+    });
+
+    std::vector<Board> boards(kClients);
+    std::vector<ClientStats> stats(kClients);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kClients; i++) {
+        clients.push_back(std::thread(RunClient, port, &boards[i], &stats[i]));
+    }
+    for (std::thread &client : clients) {
+        client.join();
+    }
+    for (int i = 1; i < kClients; i++) {
+        CHECK(boards[i].shapes == boards[0].shapes);
+    }
+
+    // A late client gets the board as it is now.
+    SyncClient late;
+    CHECK(late.Connect(port));
+    Board lateBoard;
+    Clock::time_point start = Clock::now();
+    while (lateBoard.shapes.size() < boards[0].shapes.size() && Clock::now() - start < std::chrono::milliseconds(kSettleMs)) {
+        CHECK(late.Poll([&](uint32_t sender, const Delta &delta) {
+            lateBoard.Apply(late.GetClientId(), sender, delta);
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(lateBoard.shapes == boards[0].shapes);
+    late.Disconnect();
+
+    stop = true;
+    serverThread.join();
+    server.reset();
+    StopSockets();
+
+    long edits = 0;
+    uint64_t sent = 0, received = 0;
+    for (const ClientStats &s : stats) {
+        edits += s.edits;
+        sent += s.sent;
+        received += s.received;
+    }
+    std::sort(g_latencies.begin(), g_latencies.end());
+    CHECK(!g_latencies.empty() && edits > 0);
+    if (!g_latencies.empty() && edits > 0) {
+        std::printf("%d clients, %ld edits in %d ms, %.0f edits/s\n", kClients, edits, kSessionMs, edits * 1000.0 / kSessionMs);
+        std::printf("propagation: median %.2f ms, 99th percentile %.2f ms, max %.2f ms\n", g_latencies[g_latencies.size() / 2],
+                    g_latencies[g_latencies.size() * 99 / 100], g_latencies.back());
+        std::printf("bytes per edit: %.2f sent, %.2f received per client\n", (double)sent / edits, (double)received / kClients / edits);
+        std::printf("late join: %u shapes in %u bytes, against %u received by every client in the session\n",
+                    (unsigned)lateBoard.shapes.size(), (unsigned)late.BytesReceived(), (unsigned)(received / kClients));
+    }
+
+    // Joining costs the board, not the session: far less than the session did.
+    CHECK(late.BytesReceived() * 4 < received / kClients);
+    return TestResult();
+}
@@ -0,0 +1,29 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <cstdio>
+
+//
+// Just enough to write a test as a plain program: `CHECK()' reports what
+// failed and carries on, and `main()' returns `TestResult()'.
+//
+
+int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_failures++; \
+        } \
+    } while (0)
+
+int TestResult() {
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
+
+#endif // _TEST_H_
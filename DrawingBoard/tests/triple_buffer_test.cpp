@@ -0,0 +1,138 @@
+//
+// Stress test of the handoff between the UI thread and the render thread:
+// one thread publishes frames through a `TripleBuffer' as fast as it can,
+// the other one reads whatever is newest, the way `Renderer' does. Meant to
+// be run under ThreadSanitizer; the checks catch torn frames as well.
+//
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "../scene.h"
+#include "../triple_buffer.h"
+
+// Every element of a frame holds the frame's number, so a frame that is
+// written while it is being read shows up as a mix of numbers.
+void TestPlainFrames() {
+    const int kFrames = 200000;
+    const size_t kValues = 64;
+
+    TripleBuffer<std::vector<int> > buffer;
+    std::atomic<bool> done(false);
+
+    std::thread producer([&]() {
+        for (int frame = 1; frame <= kFrames; frame++) {
+            std::vector<int> &back = buffer.Back();
+            back.assign(kValues, frame);
+            buffer.Publish();
+        }
+        done = true;
+    });
+
+    int last = 0, seen = 0;
+    for (;;) {
+        bool finished = done;
+        if (buffer.Update()) {
+            const std::vector<int> &front = buffer.Front();
+            CHECK(front.size() == kValues);
+            int frame = front.empty() ? 0 : front[0];
+            for (int value : front) {
+                CHECK(value == frame);
+            }
+            CHECK(frame > last);
+            last = frame;
+            seen++;
+        } else if (finished) {
+            break;
+        }
+    }
+    producer.join();
+
+    // Whatever happened in between, the last frame always gets through.
+    CHECK(last == kFrames);
+    std::printf("plain frames: %d published, %d seen\n", kFrames, seen);
+}
+
+std::shared_ptr<SceneItem> MakeItem(int frame, int index) {
+    std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+    item->kind = SHAPE_RECTANGLE;
+    item->painter = nullptr;
+    POINT pts[2] = { { frame, index }, { frame + 1, index + 1 } };
+    item->points.assign(pts, pts + 2);
+    item->style = kDefaultStyle;
+    RECT bounds = { frame, index, frame + 1, index + 1 };
+    item->bounds = bounds;
+    return item;
+}
+
+// Frames as the board publishes them: a persistent scene that the UI thread
+// keeps editing, copied into the back slot and topped with items that only
+// exist in that frame. Frame `f' has `f / 4 + 2' items.
+void TestSceneFrames() {
+    const int kFrames = 20000;
+
+    TripleBuffer<Scene> buffer;
+    std::atomic<bool> done(false);
+
+    std::thread producer([&]() {
+        std::mt19937 rng(42);
+        Scene board;
+        for (int frame = 1; frame <= kFrames; frame++) {
+            // Edit the board: grow it every few frames, move some shape always.
+            if (frame % 4 == 0) {
+                board.PushBack(MakeItem(frame, (int)board.Size()));
+            }
+            if (board.Size() > 0) {
+                int index = (int)(rng() % board.Size());
+                board.Set(index, MakeItem(frame, index));
+            }
+
+            Scene &scene = buffer.Back();
+            scene = board;
+            scene.PushBack(MakeItem(frame, (int)scene.Size()));
+            scene.PushBack(MakeItem(frame, -1));
+            buffer.Publish();
+        }
+        done = true;
+    });
+
+    int last = 0;
+    for (;;) {
+        bool finished = done;
+        if (buffer.Update()) {
+            const Scene &scene = buffer.Front();
+            CHECK(scene.Size() >= 2);
+            int frame = (int)scene[scene.Size() - 1].points[0].x;
+            CHECK(frame > last);
+            CHECK(scene.Size() == (size_t)(frame / 4 + 2));
+
+            // Every item was made in this frame or an earlier one, and sits
+            // where it was put.
+            int index = 0;
+            scene.ForEach([&](const SceneItem &item) {
+                CHECK(item.points.size() == 2);
+                CHECK(item.points[0].x <= frame);
+                CHECK(item.points[1].x == item.points[0].x + 1);
+                if (index < (int)scene.Size() - 1) {
+                    CHECK(item.points[0].y == index);
+                }
+                index++;
+            });
+            last = frame;
+        } else if (finished) {
+            break;
+        }
+    }
+    producer.join();
+    CHECK(last == kFrames);
+}
+
+int main() {
+    TestPlainFrames();
+    TestSceneFrames();
+    return TestResult();
+}
@@ -0,0 +1,244 @@
+//
+// Exports of small boards, checked against what the files have to say: the
+// SVG of every kind of shape and style, the structure of the PDF (the
+// offsets in its cross-reference table and the length of its content stream,
+// on a board large enough to go through several flushes of the buffer), how
+// shapes of other plugins are exported with and without a serializer, and a
+// file that cannot be written.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "../exporter.h"
+
+class TestPainter : public Painter {
+  public:
+    virtual void Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const override {}
+    virtual void StartDrawing(Shape *shape, const POINT &pt) const override {}
+    virtual void Update(Shape *shape, const POINT &pt) const override {}
+};
+
+// Exports a shape as a curve from its first point to its last, so that it
+// cannot be taken for the polygon through its points.
+class TestSerializer : public Serializer {
+  public:
+    virtual void Serialize(const std::vector<POINT> &points, PathSink *sink) const override {
+        const POINT &a = points.front(), &b = points.back();
+        sink->MoveTo(a.x, a.y);
+        sink->CurveTo(a.x, b.y, b.x, a.y, b.x, b.y);
+        sink->ClosePath();
+    }
+};
+
+void Add(Scene *scene, ShapeKind kind, const Painter *painter, const POINT *points, size_t n, StyleId style) {
+    std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+    item->kind = kind;
+    item->painter = painter;
+    item->points.assign(points, points + n);
+    item->style = style;
+    item->bounds = PointsExtent(item->points);
+    scene->PushBack(item);
+}
+
+std::string ReadAll(FILE *file) {
+    std::string text;
+    std::rewind(file);
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+    return text;
+}
+
+template <class WRITER>
+std::string Export(const Scene &scene, const StyleTable &styles, const SerializerMap &serializers) {
+    FILE *file = std::tmpfile();
+    CHECK(file);
+    std::string text;
+    {
+        WRITER writer(file);
+        CHECK(ExportScene(scene, styles, serializers, &writer));
+    }
+    text = ReadAll(file);
+    std::fclose(file);
+    return text;
+}
+
+bool Contains(const std::string &text, const char *part) {
+    return text.find(part) != std::string::npos;
+}
+
+size_t Count(const std::string &text, const char *part) {
+    size_t count = 0;
+    for (size_t at = text.find(part); at != std::string::npos; at = text.find(part, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+void TestNumbers() {
+    FILE *file = std::tmpfile();
+    {
+        OutputBuffer out(file);
+        out.WriteNumber(1.5);
+        out.Put(' ');
+        out.WriteNumber(2.0);
+        out.Put(' ');
+        out.WriteNumber(-0.25);
+        out.Put(' ');
+        out.WriteNumber(0.004);
+        out.Put(' ');
+        out.WriteNumber(128 / 255.0, 3);
+        out.Put(' ');
+        out.WriteInteger(7, 10);
+        CHECK(out.Offset() == 30);
+        CHECK(out.Flush());
+    }
+    CHECK(ReadAll(file) == "1.5 2 -0.25 0 0.502 0000000007");
+    std::fclose(file);
+}
+
+void TestSvg() {
+    StyleTable styles;
+    const Style plain = { RGB(255, 230, 120), RGB(0, 0, 0), 1, 255, DASH_SOLID };
+    const Style fancy = { RGB(140, 180, 255), RGB(128, 128, 128), 4, 128, DASH_DASHED };
+    const Style bare = { RGB(255, 255, 255), RGB(0, 0, 0), 0, 255, DASH_SOLID };
+
+    Scene scene;
+    const POINT rect[] = { { 10, 20 }, { 110, 70 } };
+    const POINT ellipse[] = { { 0, 0 }, { 40, 20 } };
+    const POINT holed[] = { { 0, 0 }, { 200, 0 }, { 200, 150 }, kRingBreak, { 50, 50 }, { 60, 50 }, { 60, 60 } };
+    Add(&scene, SHAPE_RECTANGLE, nullptr, rect, 2, styles.Intern(plain));
+    Add(&scene, SHAPE_ELLIPSE, nullptr, ellipse, 2, styles.Intern(fancy));
+    Add(&scene, SHAPE_POLYGON, nullptr, holed, sizeof(holed) / sizeof(holed[0]), styles.Intern(bare));
+
+    std::string svg = Export<SvgWriter>(scene, styles, SerializerMap());
+    CHECK(svg.compare(0, 5, "<?xml") == 0);
+    CHECK(Contains(svg, "width=\"200\" height=\"150\" viewBox=\"0 0 200 150\""));
+    CHECK(Count(svg, "<path ") == 3);
+    CHECK(Contains(svg, "<path fill=\"#ffe678\" d=\"M10 20L110 20L110 70L10 70Z\"/>\n"));
+    CHECK(Contains(svg, "<path fill=\"#8cb4ff\" stroke=\"#808080\" stroke-width=\"4\" stroke-dasharray=\"16 8\" "
+                        "fill-opacity=\"0.502\" stroke-opacity=\"0.502\" d=\"M40 10C40 15.52 "));
+    CHECK(Count(svg, "C") == 4);
+    CHECK(Contains(svg, "<path fill=\"#ffffff\" stroke=\"none\" d=\"M0 0L200 0L200 150ZM50 50L60 50L60 60Z\"/>\n"));
+    CHECK(svg.size() >= 12 && svg.compare(svg.size() - 12, 12, "</g>\n</svg>\n") == 0);
+}
+
+// Every offset the PDF gives has to be right to the byte, or readers fall
+// back to scanning the file for objects.
+void TestPdf() {
+    StyleTable styles;
+    const Style translucent = { RGB(0, 0, 255), RGB(255, 0, 0), 2, 64, DASH_DOTTED };
+    StyleId ids[2] = { kDefaultStyle, styles.Intern(translucent) };
+
+    Scene scene;
+    for (int i = 0; i < 5000; i++) {
+        const POINT corners[] = { { i % 100 * 10, i / 100 * 10 }, { i % 100 * 10 + 8, i / 100 * 10 + 8 } };
+        Add(&scene, (ShapeKind)(SHAPE_RECTANGLE + i % 2), nullptr, corners, 2, ids[i / 7 % 2]);
+    }
+    std::string pdf = Export<PdfWriter>(scene, styles, SerializerMap());
+    CHECK(pdf.size() > 4 * 64 * 1024);
+    CHECK(pdf.compare(0, 9, "%PDF-1.4\n") == 0);
+    CHECK(pdf.size() >= 6 && pdf.compare(pdf.size() - 6, 6, "%%EOF\n") == 0);
+
+    size_t startxref = pdf.rfind("startxref\n");
+    CHECK(startxref != std::string::npos);
+    if (startxref == std::string::npos) {
+        return;
+    }
+    size_t xref = (size_t)std::atoll(pdf.c_str() + startxref + 10);
+    CHECK(pdf.compare(xref, 13, "xref\n0 7\n0000") == 0);
+
+    // The free entry, then one of exactly 20 bytes for each object.
+    size_t table = xref + 9;
+    CHECK(pdf.compare(table, 20, "0000000000 65535 f \n") == 0);
+    size_t offsets[7] = { 0 };
+    for (int id = 1; id <= 6; id++) {
+        size_t entry = table + 20 * id;
+        CHECK(pdf.compare(entry + 10, 10, " 00000 n \n") == 0);
+        offsets[id] = (size_t)std::atoll(pdf.substr(entry, 10).c_str());
+        std::string header = std::to_string(id) + " 0 obj\n";
+        CHECK(pdf.compare(offsets[id], header.size(), header) == 0);
+    }
+    CHECK(pdf.compare(table + 140, 8, "trailer\n") == 0);
+
+    // The length of the stream is object 5, which comes after it.
+    size_t start = pdf.find("stream\n", offsets[4]) + 7;
+    size_t end = pdf.find("\nendstream\n", start);
+    CHECK(end != std::string::npos && end < offsets[5]);
+    size_t length = (size_t)std::atoll(pdf.c_str() + offsets[5] + 8);
+    CHECK(length == end - start);
+    CHECK(Contains(pdf, "<< /Length 5 0 R >>"));
+
+    // Only the opacities that are used get a graphics state.
+    CHECK(Contains(pdf, "/A64 << /ca 0.251 /CA 0.251 >>"));
+    CHECK(Contains(pdf, "/A255 << /ca 1 /CA 1 >>"));
+    CHECK(Count(pdf, " << /ca ") == 2);
+    CHECK(Count(pdf, "f*\n") + Count(pdf, "B*\n") == 5000);
+}
+
+// Built-in shapes never go through a serializer; other shapes go through
+// that of their plugin, or are taken as the polygon through their points.
+void TestSerializerFallback() {
+    StyleTable styles;
+    TestPainter withSerializer, without;
+    TestSerializer serializer;
+    SerializerMap serializers;
+    serializers[&withSerializer] = &serializer;
+
+    Scene scene;
+    const POINT points[] = { { 10, 10 }, { 30, 10 }, { 30, 40 } };
+    Add(&scene, SHAPE_CUSTOM, &withSerializer, points, 3, kDefaultStyle);
+    Add(&scene, SHAPE_CUSTOM, &without, points, 3, kDefaultStyle);
+    Add(&scene, SHAPE_RECTANGLE, &withSerializer, points, 2, kDefaultStyle);
+
+    std::string svg = Export<SvgWriter>(scene, styles, serializers);
+    CHECK(Count(svg, "<path ") == 3);
+    size_t first = svg.find("d=\"M10 10C10 40 30 10 30 40Z\"");
+    size_t second = svg.find("d=\"M10 10L30 10L30 40Z\"");
+    size_t third = svg.find("d=\"M10 10L30 10L30 10L10 10Z\"");
+    CHECK(first != std::string::npos && second != std::string::npos && third != std::string::npos);
+    CHECK(first < second && second < third);
+
+    // Shapes without points are left out.
+    Add(&scene, SHAPE_CUSTOM, &without, points, 0, kDefaultStyle);
+    CHECK(Count(Export<SvgWriter>(scene, styles, serializers), "<path ") == 3);
+}
+
+void TestWriteFailure() {
+    const char *path = "vector_writer_test.svg";
+    FILE *file = std::fopen(path, "wb");
+    CHECK(file);
+    if (!file) {
+        return;
+    }
+    std::fclose(file);
+
+    // Opened for reading only, so every write fails.
+    file = std::fopen(path, "rb");
+    StyleTable styles;
+    Scene scene;
+    const POINT rect[] = { { 0, 0 }, { 10, 10 } };
+    Add(&scene, SHAPE_RECTANGLE, nullptr, rect, 2, kDefaultStyle);
+    {
+        SvgWriter writer(file);
+        CHECK(!ExportScene(scene, styles, SerializerMap(), &writer));
+    }
+    std::fclose(file);
+    std::remove(path);
+}
+
+int main() {
+    TestNumbers();
+    TestSvg();
+    TestPdf();
+    TestSerializerFallback();
+    TestWriteFailure();
+    return TestResult();
+}
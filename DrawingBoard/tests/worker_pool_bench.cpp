@@ -0,0 +1,106 @@
+//
+// Overheads of the worker pool: the round trip of a job that does nothing,
+// how many such jobs it gets through, and how a loop over 16M elements
+// scales with the grain it is split at, against the same loop on one thread.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "../worker_pool.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const int kRuns = 5;
+
+class EmptyJob : public Job {
+  public:
+    EmptyJob() : Job(1) {}
+
+  protected:
+    virtual void Run(size_t, size_t) override {}
+};
+
+class SqrtJob : public Job {
+  public:
+    SqrtJob(std::vector<float> *values) : Job(values->size()), m_values(values) {}
+
+  protected:
+    virtual void Run(size_t begin, size_t end) override {
+        for (size_t i = begin; i < end; i++) {
+            (*m_values)[i] = std::sqrt((*m_values)[i] * 1.0001f + 1.0f);
+        }
+    }
+
+  private:
+    std::vector<float> *m_values;
+};
+
+double Milliseconds(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Submits `job' and dispatches completions until it is done.
+void RunJob(WorkerPool *pool, const std::shared_ptr<Job> &job, size_t grain) {
+    bool done = false;
+    pool->Submit(job, grain, [&done]() {
+        done = true;
+    });
+    while (!done) {
+        pool->DispatchCompletions();
+    }
+}
+
+int main() {
+    WorkerPool pool(nullptr, 0);
+    std::printf("workers: %u\n", (unsigned)pool.GetThreadCount());
+
+    const int roundTrips = 20000;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < roundTrips; i++) {
+        RunJob(&pool, std::make_shared<EmptyJob>(), 1);
+    }
+    std::printf("%-28s %9.2f us\n", "empty job round trip", Milliseconds(start) * 1000.0 / roundTrips);
+
+    const int jobs = 100000;
+    int done = 0;
+    start = Clock::now();
+    for (int i = 0; i < jobs; i++) {
+        pool.Submit(std::make_shared<EmptyJob>(), 1, [&done]() {
+            done++;
+        });
+    }
+    while (done < jobs) {
+        pool.DispatchCompletions();
+    }
+    std::printf("%-28s %9.0f jobs/s\n", "empty jobs in bulk", jobs * 1000.0 / Milliseconds(start));
+
+    std::vector<float> values(1 << 24, 1.0f);
+    const size_t grains[] = { 1024, 16384, 262144 };
+    for (size_t grain : grains) {
+        double best = 1e30;
+        for (int k = 0; k < kRuns; k++) {
+            start = Clock::now();
+            RunJob(&pool, std::make_shared<SqrtJob>(&values), grain);
+            best = std::min(best, Milliseconds(start));
+        }
+        char name[64];
+        std::sprintf(name, "16M sqrt, grain %u", (unsigned)grain);
+        std::printf("%-28s %9.2f ms\n", name, best);
+    }
+
+    double best = 1e30;
+    for (int k = 0; k < kRuns; k++) {
+        start = Clock::now();
+        for (float &v : values) {
+            v = std::sqrt(v * 1.0001f + 1.0f);
+        }
+        best = std::min(best, Milliseconds(start));
+    }
+    std::printf("%-28s %9.2f ms\n", "16M sqrt, one thread", best);
+    return 0;
+}
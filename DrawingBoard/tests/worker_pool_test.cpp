@@ -0,0 +1,238 @@
+//
+// Stress test of the worker pool, meant to be run under ThreadSanitizer.
+//
+// Rounds of jobs of random sizes and grains, some of them cancelled while
+// they run, and some rounds end by destroying the pool with work in flight.
+// Every step of a job that is not cancelled has to run exactly once, and
+// what its ranges wrote has to be visible to `Finish()' and to the
+// completion. Completions are dispatched while the workers retire jobs, as
+// the window would on WM_JOBS_DONE.
+//
+// Then an export whose pool shuts down before it gets to write must not
+// leave its file behind.
+//
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "../exporter.h"
+
+class SumJob : public Job {
+  public:
+    SumJob(const std::vector<int> &data) : Job(data.size()), m_data(data), m_runs(data.size(), 0), m_sum(0), m_finished(0) {}
+
+    long long GetSum() const {
+        return m_sum;
+    }
+
+    int GetFinishCount() const {
+        return m_finished;
+    }
+
+    // Whether every step ran exactly once.
+    bool Covered() const {
+        for (int runs : m_runs) {
+            if (runs != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+  protected:
+    // Ranges are disjoint, so the steps are written without a lock.
+    virtual void Run(size_t begin, size_t end) override {
+        long long sum = 0;
+        for (size_t i = begin; i < end; i++) {
+            sum += m_data[i];
+            m_runs[i]++;
+        }
+        m_sum += sum;
+    }
+
+    virtual void Finish() override {
+        m_finished++;
+        CHECK(Covered());
+    }
+
+  private:
+    std::vector<int> m_data;
+    std::vector<int> m_runs;
+    std::atomic<long long> m_sum;
+    std::atomic<int> m_finished;
+};
+
+// Keeps its worker until it is cancelled.
+class BlockingJob : public Job {
+  public:
+    BlockingJob() : Job(1), m_started(false) {}
+
+    bool HasStarted() const {
+        return m_started;
+    }
+
+  protected:
+    virtual void Run(size_t, size_t) override {
+        m_started = true;
+        while (!IsCancelled()) {
+            std::this_thread::yield();
+        }
+    }
+
+  private:
+    std::atomic<bool> m_started;
+};
+
+void TestRounds(int rounds, size_t nThreads) {
+    std::mt19937 rng((unsigned)nThreads);
+    int completed = 0, cancelled = 0, dropped = 0;
+    for (int round = 0; round < rounds; round++) {
+        std::vector<std::shared_ptr<SumJob> > jobs;
+        std::vector<long long> expected;
+        std::vector<int> completions;
+        {
+            WorkerPool pool(nullptr, 0, nThreads);
+            for (int j = 0; j < 20; j++) {
+                std::vector<int> data(rng() % 5000);
+                long long sum = 0;
+                for (int &v : data) {
+                    v = rng() % 100;
+                    sum += v;
+                }
+                jobs.push_back(std::make_shared<SumJob>(data));
+                expected.push_back(sum);
+                completions.push_back(0);
+            }
+
+            for (size_t j = 0; j < jobs.size(); j++) {
+                std::shared_ptr<SumJob> job = jobs[j];
+                long long sum = expected[j];
+                int *count = &completions[j];
+                pool.Submit(job, 1 + rng() % 64, [job, sum, count]() {
+                    (*count)++;
+                    if (!job->IsCancelled()) {
+                        CHECK(job->GetFinishCount() == 1);
+                        CHECK(job->GetSum() == sum);
+                        CHECK(job->GetProgress() == 1.0);
+                    }
+                });
+                if (rng() % 4 == 0) {
+                    jobs[rng() % (j + 1)]->Cancel();
+                }
+            }
+
+            // Every fifth round, the pool goes away with half the jobs still to go.
+            size_t wanted = (round % 5 == 0) ? jobs.size() / 2 : jobs.size();
+            for (;;) {
+                pool.DispatchCompletions();
+                size_t done = 0;
+                for (int count : completions) {
+                    done += count;
+                }
+                if (done >= wanted) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        for (size_t j = 0; j < jobs.size(); j++) {
+            CHECK(completions[j] <= 1);
+            CHECK(jobs[j]->GetFinishCount() <= 1);
+            if (completions[j] == 0) {
+                dropped++;
+            } else if (jobs[j]->IsCancelled()) {
+                cancelled++;
+            } else {
+                completed++;
+            }
+        }
+    }
+    std::printf("%u threads: %d jobs completed, %d cancelled, %d dropped with the pool\n", (unsigned)nThreads, completed,
+                cancelled, dropped);
+}
+
+Scene MakeScene(size_t count) {
+    Scene scene;
+    for (size_t i = 0; i < count; i++) {
+        std::shared_ptr<SceneItem> item = std::make_shared<SceneItem>();
+        item->kind = SHAPE_RECTANGLE;
+        item->painter = nullptr;
+        POINT corners[2] = { { (LONG)i, (LONG)i }, { (LONG)i + 10, (LONG)i + 20 } };
+        item->points.assign(corners, corners + 2);
+        item->style = kDefaultStyle;
+        RECT bounds = { (LONG)i, (LONG)i, (LONG)i + 10, (LONG)i + 20 };
+        item->bounds = bounds;
+        scene.PushBack(item);
+    }
+    return scene;
+}
+
+bool FileExists(const char *path) {
+    FILE *file = std::fopen(path, "rb");
+    if (file) {
+        std::fclose(file);
+    }
+    return file != nullptr;
+}
+
+void TestExport() {
+    StyleTable styles;
+    Scene scene = MakeScene(10000);
+    const char *path = "worker_pool_test.svg";
+    const std::wstring wpath = L"worker_pool_test.svg";
+
+    // Written out in full.
+    {
+        FILE *file = std::fopen(path, "wb");
+        CHECK(file);
+        std::shared_ptr<ExportJob> job = std::make_shared<ExportJob>(scene, &styles, SerializerMap(), new SvgWriter(file), file, wpath);
+        bool done = false, closed = false;
+        WorkerPool pool(nullptr, 0, 4);
+        pool.Submit(job, 256, [&]() {
+            done = true;
+            closed = job->Close();
+        });
+        while (!done) {
+            pool.DispatchCompletions();
+            std::this_thread::yield();
+        }
+        CHECK(closed);
+        CHECK(FileExists(path));
+        std::remove(path);
+    }
+
+    // The only worker is kept busy, so the export has not started when the
+    // pool shuts down; the job goes away without its completion.
+    {
+        FILE *file = std::fopen(path, "wb");
+        CHECK(file);
+        std::shared_ptr<ExportJob> job = std::make_shared<ExportJob>(scene, &styles, SerializerMap(), new SvgWriter(file), file, wpath);
+        {
+            WorkerPool pool(nullptr, 0, 1);
+            std::shared_ptr<BlockingJob> blocker = std::make_shared<BlockingJob>();
+            pool.Submit(blocker, 1, WorkerPool::Completion());
+            while (!blocker->HasStarted()) {
+                std::this_thread::yield();
+            }
+            pool.Submit(job, 256, WorkerPool::Completion());
+        }
+        CHECK(job->IsCancelled());
+        CHECK(FileExists(path));
+        job.reset();
+        CHECK(!FileExists(path));
+    }
+}
+
+int main() {
+    TestRounds(200, 1);
+    TestRounds(200, 4);
+    TestRounds(200, 16);
+    TestExport();
+    return TestResult();
+}
@@ -0,0 +1,56 @@
+#ifndef _TRIPLE_BUFFER_H_
+#define _TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+//
+// Lock-free triple buffer for exactly one producer and one consumer.
+//
+// The producer fills `Back()' and calls `Publish()', which swaps the back slot
+// with the middle one. The consumer calls `Update()', which swaps the middle
+// slot with the front one if something new has been published since, and then
+// reads `Front()'. Neither side ever waits for the other; intermediate values
+// the consumer was too slow to see are simply overwritten.
+//
+template <class T>
+class TripleBuffer {
+  public:
+    TripleBuffer() : m_back(0), m_middle(1), m_front(2) {}
+    ~TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer& operator=(const TripleBuffer &) = delete;
+
+    // Producer side.
+    T &Back() {
+        return m_slots[m_back];
+    }
+
+    void Publish() {
+        m_back = m_middle.exchange(m_back | kDirty, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Consumer side. Returns false if nothing was published since the last call.
+    bool Update() {
+        if (!(m_middle.load(std::memory_order_acquire) & kDirty)) {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    const T &Front() const {
+        return m_slots[m_front];
+    }
+
+  private:
+    static const int kIndexMask = 0x3;
+    static const int kDirty = 0x4;
+
+    T m_slots[3];
+    int m_back;
+    std::atomic<int> m_middle;
+    int m_front;
+};
+
+#endif // _TRIPLE_BUFFER_H_
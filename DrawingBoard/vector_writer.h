@@ -0,0 +1,469 @@
+#ifndef _VECTOR_WRITER_H_
+#define _VECTOR_WRITER_H_
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "path_sink.h"
+#include "style.h"
+
+//
+// Streaming SVG and PDF output.
+//
+// Paths go straight from the `PathSink' calls into a fixed-size buffer, so
+// the memory used does not depend on the size of the board. Nothing in here
+// touches Win32, which keeps it usable from headless tools and tests.
+//
+
+// Buffered writes to a file, with number formatting that does not go through
+// the C runtime's locale-aware printf.
+class OutputBuffer {
+  public:
+    OutputBuffer(FILE *file) : m_file(file), m_buffer(kCapacity), m_size(0), m_flushed(0), m_failed(false) {}
+    ~OutputBuffer() = default;
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer& operator=(const OutputBuffer &) = delete;
+
+    void Write(const char *data, size_t n);
+
+    void Write(const char *s) {
+        Write(s, std::strlen(s));
+    }
+
+    void Put(char c) {
+        if (m_size == kCapacity) {
+            Flush();
+        }
+        m_buffer[m_size++] = c;
+    }
+
+    // Prints `value' with at most `decimals' digits after the point and no trailing zeros.
+    void WriteNumber(double value, int decimals = 2);
+
+    // Prints `value' padded with zeros to `width' digits.
+    void WriteInteger(unsigned long long value, int width = 0);
+
+    // Bytes written so far, flushed or not.
+    size_t Offset() const {
+        return m_flushed + m_size;
+    }
+
+    // Returns false if any write to the file failed.
+    bool Flush();
+
+  private:
+    static const size_t kCapacity = 64 * 1024;
+
+    FILE *m_file;
+    std::vector<char> m_buffer;
+    size_t m_size, m_flushed;
+    bool m_failed;
+};
+
+void OutputBuffer::Write(const char *data, size_t n) {
+    if (m_size + n > kCapacity) {
+        Flush();
+        if (n > kCapacity) {
+            m_failed |= (std::fwrite(data, 1, n, m_file) != n);
+            m_flushed += n;
+            return;
+        }
+    }
+    std::memcpy(&m_buffer[m_size], data, n);
+    m_size += n;
+}
+
+void OutputBuffer::WriteNumber(double value, int decimals) {
+    double scale = 1.0;
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10.0;
+    }
+    long long fixed = (long long)std::floor(value * scale + 0.5);
+    if (fixed < 0) {
+        Put('-');
+        fixed = -fixed;
+    }
+
+    unsigned long long unit = (unsigned long long)scale;
+    unsigned long long fraction = (unsigned long long)fixed % unit;
+    WriteInteger((unsigned long long)fixed / unit);
+    if (fraction == 0) {
+        return;
+    }
+
+    while (fraction % 10 == 0) {
+        fraction /= 10;
+        decimals--;
+    }
+    Put('.');
+    WriteInteger(fraction, decimals);
+}
+
+void OutputBuffer::WriteInteger(unsigned long long value, int width) {
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0 || n < width);
+
+    while (n > 0) {
+        Put(digits[--n]);
+    }
+}
+
+bool OutputBuffer::Flush() {
+    if (m_size > 0) {
+        m_failed |= (std::fwrite(m_buffer.data(), 1, m_size, m_file) != m_size);
+        m_flushed += m_size;
+        m_size = 0;
+    }
+    m_failed |= (std::fflush(m_file) != 0);
+    return !m_failed;
+}
+
+//
+// A document made of filled and outlined shapes, written front to back:
+// `Begin()', then `BeginShape()', the path and `EndShape()' for every shape,
+// then `End()'.
+//
+class VectorWriter : public PathSink {
+  public:
+    VectorWriter(FILE *file) : m_out(file) {}
+    virtual ~VectorWriter() = default;
+
+    // The page covers the board from (0, 0) to (width, height).
+    virtual void Begin(double width, double height) = 0;
+
+    // Shapes are filled with the even-odd rule and outlined as `style' says.
+    virtual void BeginShape(const Style &style) = 0;
+
+    virtual void EndShape() = 0;
+
+    // Returns false if the document could not be written out completely.
+    virtual bool End() = 0;
+
+  protected:
+    OutputBuffer m_out;
+};
+
+class SvgWriter : public VectorWriter {
+  public:
+    SvgWriter(FILE *file) : VectorWriter(file) {}
+    virtual ~SvgWriter() = default;
+
+    virtual void Begin(double width, double height) override;
+    virtual void BeginShape(const Style &style) override;
+    virtual void EndShape() override;
+    virtual bool End() override;
+
+    virtual void MoveTo(double x, double y) override;
+    virtual void LineTo(double x, double y) override;
+    virtual void CurveTo(double x1, double y1, double x2, double y2, double x, double y) override;
+    virtual void ClosePath() override;
+
+  private:
+    void WriteColor(uint32_t color);
+    void WritePoint(double x, double y);
+};
+
+void SvgWriter::Begin(double width, double height) {
+    m_out.Write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    m_out.WriteNumber(width);
+    m_out.Write("\" height=\"");
+    m_out.WriteNumber(height);
+    m_out.Write("\" viewBox=\"0 0 ");
+    m_out.WriteNumber(width);
+    m_out.Put(' ');
+    m_out.WriteNumber(height);
+    m_out.Write("\">\n<g stroke=\"#000\" stroke-width=\"1\" fill-rule=\"evenodd\">\n");
+}
+
+// Attributes that match those of the group, i.e. the default style, are left out.
+void SvgWriter::BeginShape(const Style &style) {
+    m_out.Write("<path fill=\"");
+    WriteColor(style.fill);
+    m_out.Put('"');
+
+    if (style.strokeWidth == 0) {
+        m_out.Write(" stroke=\"none\"");
+    } else {
+        if (style.stroke != 0) {
+            m_out.Write(" stroke=\"");
+            WriteColor(style.stroke);
+            m_out.Put('"');
+        }
+        if (style.strokeWidth != 1) {
+            m_out.Write(" stroke-width=\"");
+            m_out.WriteInteger(style.strokeWidth);
+            m_out.Put('"');
+        }
+        const DashLengths &dash = kDashLengths[style.dash];
+        if (dash.off != 0.0f) {
+            m_out.Write(" stroke-dasharray=\"");
+            m_out.WriteNumber(dash.on * style.strokeWidth);
+            m_out.Put(' ');
+            m_out.WriteNumber(dash.off * style.strokeWidth);
+            m_out.Put('"');
+        }
+    }
+
+    // The board blends fill and outline separately.
+    if (style.opacity != 255) {
+        m_out.Write(" fill-opacity=\"");
+        m_out.WriteNumber(style.opacity / 255.0, 3);
+        m_out.Write("\" stroke-opacity=\"");
+        m_out.WriteNumber(style.opacity / 255.0, 3);
+        m_out.Put('"');
+    }
+    m_out.Write(" d=\"");
+}
+
+void SvgWriter::EndShape() {
+    m_out.Write("\"/>\n");
+}
+
+bool SvgWriter::End() {
+    m_out.Write("</g>\n</svg>\n");
+    return m_out.Flush();
+}
+
+void SvgWriter::MoveTo(double x, double y) {
+    m_out.Put('M');
+    WritePoint(x, y);
+}
+
+void SvgWriter::LineTo(double x, double y) {
+    m_out.Put('L');
+    WritePoint(x, y);
+}
+
+void SvgWriter::CurveTo(double x1, double y1, double x2, double y2, double x, double y) {
+    m_out.Put('C');
+    WritePoint(x1, y1);
+    m_out.Put(' ');
+    WritePoint(x2, y2);
+    m_out.Put(' ');
+    WritePoint(x, y);
+}
+
+void SvgWriter::ClosePath() {
+    m_out.Put('Z');
+}
+
+void SvgWriter::WriteColor(uint32_t color) {
+    static const char kHex[] = "0123456789abcdef";
+    char hex[] = "#000000";
+    const uint8_t rgb[3] = { ColorRed(color), ColorGreen(color), ColorBlue(color) };
+    for (int i = 0; i < 3; i++) {
+        hex[1 + 2 * i] = kHex[rgb[i] >> 4];
+        hex[2 + 2 * i] = kHex[rgb[i] & 15];
+    }
+    m_out.Write(hex, sizeof(hex) - 1);
+}
+
+void SvgWriter::WritePoint(double x, double y) {
+    m_out.WriteNumber(x);
+    m_out.Put(' ');
+    m_out.WriteNumber(y);
+}
+
+//
+// A single-page PDF 1.4 file.
+//
+// The length of the content stream is only known at the end, so it is
+// written as an indirect object after the stream, and so are the resources,
+// which hold a graphics state for every opacity the shapes use. The
+// cross-reference table needs nothing but the offsets of the six objects.
+//
+class PdfWriter : public VectorWriter {
+  public:
+    PdfWriter(FILE *file) : VectorWriter(file), m_streamStart(0), m_lastFill(-1), m_lastStroke(-1),
+        m_lastWidth(-1), m_lastDash(-1), m_lastOpacity(255), m_stroked(true), m_opacities(256, false) {}
+    virtual ~PdfWriter() = default;
+
+    virtual void Begin(double width, double height) override;
+    virtual void BeginShape(const Style &style) override;
+    virtual void EndShape() override;
+    virtual bool End() override;
+
+    virtual void MoveTo(double x, double y) override;
+    virtual void LineTo(double x, double y) override;
+    virtual void CurveTo(double x1, double y1, double x2, double y2, double x, double y) override;
+    virtual void ClosePath() override;
+
+  private:
+    static const int kObjects = 6;
+
+    void BeginObject(int id);
+    void WriteColor(uint32_t color, const char *op);
+    void WritePoint(double x, double y);
+
+    size_t m_offsets[kObjects + 1];
+    size_t m_streamStart;
+
+    // The graphics state, so that runs of shapes of one style only set it once.
+    long m_lastFill, m_lastStroke;
+    int m_lastWidth, m_lastDash, m_lastOpacity;
+    bool m_stroked;
+    std::vector<bool> m_opacities;
+};
+
+void PdfWriter::BeginObject(int id) {
+    m_offsets[id] = m_out.Offset();
+    m_out.WriteInteger(id);
+    m_out.Write(" 0 obj\n");
+}
+
+void PdfWriter::Begin(double width, double height) {
+    // The binary comment marks the file as such for transfer programs.
+    m_out.Write("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+
+    BeginObject(1);
+    m_out.Write("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+    BeginObject(2);
+    m_out.Write("<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n");
+
+    BeginObject(3);
+    m_out.Write("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 ");
+    m_out.WriteNumber(width);
+    m_out.Put(' ');
+    m_out.WriteNumber(height);
+    m_out.Write("] /Resources 6 0 R /Contents 4 0 R >>\nendobj\n");
+
+    BeginObject(4);
+    m_out.Write("<< /Length 5 0 R >>\nstream\n");
+    m_streamStart = m_out.Offset();
+
+    // Flip the page so that y points down as it does on the board.
+    m_out.Write("1 0 0 -1 0 ");
+    m_out.WriteNumber(height);
+    m_out.Write(" cm\n");
+}
+
+void PdfWriter::BeginShape(const Style &style) {
+    if ((long)style.fill != m_lastFill) {
+        m_lastFill = style.fill;
+        WriteColor(style.fill, " rg\n");
+    }
+
+    m_stroked = (style.strokeWidth > 0);
+    if (m_stroked) {
+        if ((long)style.stroke != m_lastStroke) {
+            m_lastStroke = style.stroke;
+            WriteColor(style.stroke, " RG\n");
+        }
+        if (style.strokeWidth != m_lastWidth || style.dash != m_lastDash) {
+            m_lastWidth = style.strokeWidth;
+            m_lastDash = style.dash;
+            m_out.WriteInteger(style.strokeWidth);
+            m_out.Write(" w [");
+            const DashLengths &dash = kDashLengths[style.dash];
+            if (dash.off != 0.0f) {
+                m_out.WriteNumber(dash.on * style.strokeWidth);
+                m_out.Put(' ');
+                m_out.WriteNumber(dash.off * style.strokeWidth);
+            }
+            m_out.Write("] 0 d\n");
+        }
+    }
+
+    // Opacity can only be set through a named graphics state, see `End()'.
+    if (style.opacity != m_lastOpacity) {
+        m_lastOpacity = style.opacity;
+        m_opacities[style.opacity] = true;
+        m_out.Write("/A");
+        m_out.WriteInteger(style.opacity);
+        m_out.Write(" gs\n");
+    }
+}
+
+void PdfWriter::EndShape() {
+    // Fill with the even-odd rule, then stroke if there is an outline.
+    m_out.Write(m_stroked ? "B*\n" : "f*\n");
+}
+
+bool PdfWriter::End() {
+    size_t length = m_out.Offset() - m_streamStart;
+    m_out.Write("\nendstream\nendobj\n");
+
+    BeginObject(5);
+    m_out.WriteInteger(length);
+    m_out.Write("\nendobj\n");
+
+    BeginObject(6);
+    m_out.Write("<< /ExtGState <<");
+    for (int opacity = 0; opacity < 256; opacity++) {
+        if (m_opacities[opacity]) {
+            m_out.Write(" /A");
+            m_out.WriteInteger(opacity);
+            m_out.Write(" << /ca ");
+            m_out.WriteNumber(opacity / 255.0, 3);
+            m_out.Write(" /CA ");
+            m_out.WriteNumber(opacity / 255.0, 3);
+            m_out.Write(" >>");
+        }
+    }
+    m_out.Write(" >> >>\nendobj\n");
+
+    // Every entry of the table takes exactly 20 bytes.
+    size_t xref = m_out.Offset();
+    m_out.Write("xref\n0 ");
+    m_out.WriteInteger(kObjects + 1);
+    m_out.Write("\n0000000000 65535 f \n");
+    for (int id = 1; id <= kObjects; id++) {
+        m_out.WriteInteger(m_offsets[id], 10);
+        m_out.Write(" 00000 n \n");
+    }
+
+    m_out.Write("trailer\n<< /Size ");
+    m_out.WriteInteger(kObjects + 1);
+    m_out.Write(" /Root 1 0 R >>\nstartxref\n");
+    m_out.WriteInteger(xref);
+    m_out.Write("\n%%EOF\n");
+    return m_out.Flush();
+}
+
+void PdfWriter::WriteColor(uint32_t color, const char *op) {
+    m_out.WriteNumber(ColorRed(color) / 255.0, 3);
+    m_out.Put(' ');
+    m_out.WriteNumber(ColorGreen(color) / 255.0, 3);
+    m_out.Put(' ');
+    m_out.WriteNumber(ColorBlue(color) / 255.0, 3);
+    m_out.Write(op);
+}
+
+void PdfWriter::MoveTo(double x, double y) {
+    WritePoint(x, y);
+    m_out.Write(" m\n");
+}
+
+void PdfWriter::LineTo(double x, double y) {
+    WritePoint(x, y);
+    m_out.Write(" l\n");
+}
+
+void PdfWriter::CurveTo(double x1, double y1, double x2, double y2, double x, double y) {
+    WritePoint(x1, y1);
+    m_out.Put(' ');
+    WritePoint(x2, y2);
+    m_out.Put(' ');
+    WritePoint(x, y);
+    m_out.Write(" c\n");
+}
+
+void PdfWriter::ClosePath() {
+    m_out.Write("h\n");
+}
+
+void PdfWriter::WritePoint(double x, double y) {
+    m_out.WriteNumber(x);
+    m_out.Put(' ');
+    m_out.WriteNumber(y);
+}
+
+#endif // _VECTOR_WRITER_H_
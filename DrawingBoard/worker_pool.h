@@ -0,0 +1,315 @@
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#define NOMINMAX
+#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//
+// Work that runs on a `WorkerPool', split into `count' steps.
+//
+// The pool hands disjoint ranges of steps to `Run()' on any number of
+// workers at once, then calls `Finish()' on whichever worker completes the
+// last range. A job must not touch anything the UI thread may be changing
+// meanwhile; it works on copies or on immutable snapshots such as a `Scene'.
+//
+class Job {
+  public:
+    Job(size_t count) : m_count(count), m_grain(1), m_cancelled(false), m_done(0), m_pending(0) {}
+    virtual ~Job() = default;
+
+    Job(const Job &) = delete;
+    Job& operator=(const Job &) = delete;
+
+    // Ranges that have not started yet are skipped, and so is `Finish()';
+    // `Run()' may poll `IsCancelled()' to stop early as well.
+    void Cancel() {
+        m_cancelled = true;
+    }
+
+    bool IsCancelled() const {
+        return m_cancelled;
+    }
+
+    // Fraction of the steps done so far, from 0 to 1.
+    double GetProgress() const {
+        return (m_count == 0) ? 1.0 : (double)m_done / m_count;
+    }
+
+  protected:
+    virtual void Run(size_t begin, size_t end) = 0;
+
+    virtual void Finish() {}
+
+  private:
+    friend class WorkerPool;
+
+    size_t m_count, m_grain;
+    std::atomic<bool> m_cancelled;
+    std::atomic<size_t> m_done;
+    std::atomic<size_t> m_pending;  // ranges queued or running
+};
+
+//
+// Work-stealing thread pool for jobs that would otherwise stall the UI.
+//
+// Every worker has a deque of ranges. A worker splits the range it takes in
+// halves, pushing the upper ones onto the back of its deque, until it is down
+// to the grain of the job; it then runs that and goes on with the back of its
+// deque, i.e. the most recent and smallest range. Idle workers steal from the
+// front of the others' deques, which holds the largest ranges, so a job
+// spreads over all workers after a few steals and each worker mostly stays on
+// adjacent data. The deques are short and each is guarded by its own mutex.
+//
+// Finished jobs go onto a lock-free stack, and `uMsg' is posted to `hWnd'
+// when the stack was empty; the window then calls `DispatchCompletions()',
+// which runs the completion of every finished job on the UI thread.
+//
+class WorkerPool {
+  public:
+    typedef std::function<void()> Completion;
+
+    // With no thread count, one worker for every core but the UI thread's.
+    WorkerPool(HWND hWnd, UINT uMsg, size_t nThreads = 0);
+
+    // Cancels all jobs; completions that have not been dispatched are dropped.
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool& operator=(const WorkerPool &) = delete;
+
+    size_t GetThreadCount() const {
+        return m_workers.size();
+    }
+
+    // Runs `job' in ranges of at most `grain' steps, then `done' on the UI
+    // thread, also when the job has been cancelled.
+    void Submit(const std::shared_ptr<Job> &job, size_t grain, const Completion &done);
+
+    // Call from the window procedure on `uMsg'.
+    void DispatchCompletions();
+
+  private:
+    struct Range {
+        Job *job;
+        size_t begin, end;
+    };
+
+    // Keeps a job alive from `Submit()' until its completion has run.
+    struct Ticket {
+        std::shared_ptr<Job> job;
+        Completion done;
+        Ticket *next;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    void Push(size_t worker, const Range &range);
+    bool Take(size_t self, Range *range);
+    void Execute(size_t self, Range range);
+    void Retire(Job *job);
+    void Loop(size_t self);
+
+    HWND m_hWnd;
+    UINT m_uMsg;
+    std::vector<std::unique_ptr<Worker> > m_workers;
+    std::vector<std::thread> m_threads;
+    std::unordered_map<Job*, Ticket*> m_tickets;  // of unfinished jobs, guarded by m_ticketMutex
+    std::mutex m_ticketMutex;
+
+    // Sleeping workers wait for m_queued to become positive.
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued;
+    bool m_quit;
+
+    std::atomic<Ticket*> m_completed;
+    size_t m_nextWorker;
+};
+
+WorkerPool::WorkerPool(HWND hWnd, UINT uMsg, size_t nThreads) : m_hWnd(hWnd), m_uMsg(uMsg), m_queued(0),
+    m_quit(false), m_completed(nullptr), m_nextWorker(0) {
+
+    if (nThreads == 0) {
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    }
+    for (size_t i = 0; i < nThreads; i++) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+    }
+    for (size_t i = 0; i < nThreads; i++) {
+        m_threads.push_back(std::thread(&WorkerPool::Loop, this, i));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    // Whatever is still queued runs down quickly once cancelled.
+    {
+        std::lock_guard<std::mutex> lock(m_ticketMutex);
+        for (auto &it : m_tickets) {
+            it.first->Cancel();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &t : m_threads) {
+        t.join();
+    }
+
+    Ticket *ticket = m_completed.exchange(nullptr);
+    while (ticket) {
+        Ticket *next = ticket->next;
+        delete ticket;
+        ticket = next;
+    }
+    for (auto &it : m_tickets) {
+        delete it.second;
+    }
+}
+
+void WorkerPool::Submit(const std::shared_ptr<Job> &job, size_t grain, const Completion &done) {
+    Ticket *ticket = new Ticket;
+    ticket->job = job;
+    ticket->done = done;
+    ticket->next = nullptr;
+
+    job->m_grain = std::max<size_t>(1, grain);
+    job->m_pending = 1;
+    {
+        std::lock_guard<std::mutex> lock(m_ticketMutex);
+        m_tickets[job.get()] = ticket;
+    }
+
+    // Workers look at the deques in turn, so which one is fed does not matter much.
+    Range range = { job.get(), 0, job->m_count };
+    Push(m_nextWorker, range);
+    m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+}
+
+void WorkerPool::DispatchCompletions() {
+    // The stack has the last job to finish on top; run them in the order they finished.
+    Ticket *ticket = m_completed.exchange(nullptr, std::memory_order_acquire);
+    Ticket *ordered = nullptr;
+    while (ticket) {
+        Ticket *next = ticket->next;
+        ticket->next = ordered;
+        ordered = ticket;
+        ticket = next;
+    }
+
+    while (ordered) {
+        Ticket *next = ordered->next;
+        if (ordered->done) {
+            ordered->done();
+        }
+        delete ordered;
+        ordered = next;
+    }
+}
+
+void WorkerPool::Push(size_t worker, const Range &range) {
+    // Counted before it can be taken, so that m_queued never drops below zero.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_workers[worker]->mutex);
+        m_workers[worker]->ranges.push_back(range);
+    }
+    m_wake.notify_one();
+}
+
+bool WorkerPool::Take(size_t self, Range *range) {
+    size_t n = m_workers.size();
+    for (;;) {
+        for (size_t k = 0; k < n; k++) {
+            Worker &worker = *m_workers[(self + k) % n];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.ranges.empty()) {
+                if (k == 0) {
+                    *range = worker.ranges.back();
+                    worker.ranges.pop_back();
+                } else {
+                    *range = worker.ranges.front();
+                    worker.ranges.pop_front();
+                }
+                m_queued--;
+                return true;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() { return m_quit || m_queued > 0; });
+        if (m_quit) {
+            return false;
+        }
+    }
+}
+
+void WorkerPool::Execute(size_t self, Range range) {
+    Job *job = range.job;
+    while (range.end - range.begin > job->m_grain && !job->IsCancelled()) {
+        size_t mid = range.begin + (range.end - range.begin) / 2;
+        Range upper = { job, mid, range.end };
+        job->m_pending++;
+        Push(self, upper);
+        range.end = mid;
+    }
+
+    if (!job->IsCancelled()) {
+        job->Run(range.begin, range.end);
+    }
+    job->m_done += range.end - range.begin;
+
+    if (--job->m_pending == 0) {
+        if (!job->IsCancelled()) {
+            job->Finish();
+        }
+        Retire(job);
+    }
+}
+
+// Moves the ticket of a finished job onto the completion stack.
+void WorkerPool::Retire(Job *job) {
+    Ticket *ticket;
+    {
+        std::lock_guard<std::mutex> lock(m_ticketMutex);
+        auto it = m_tickets.find(job);
+        ticket = it->second;
+        m_tickets.erase(it);
+    }
+
+    Ticket *head = m_completed.load(std::memory_order_relaxed);
+    do {
+        ticket->next = head;
+    } while (!m_completed.compare_exchange_weak(head, ticket, std::memory_order_release, std::memory_order_relaxed));
+
+    // Otherwise a message is on its way already and will pick this one up too.
+    if (!head) {
+        ::PostMessage(m_hWnd, m_uMsg, 0, 0);
+    }
+}
+
+void WorkerPool::Loop(size_t self) {
+    Range range;
+    while (Take(self, &range)) {
+        Execute(self, range);
+    }
+}
+
+#endif // _WORKER_POOL_H_
@@ -1,69 +1,24 @@
-#include <algorithm>
-#include <cmath>
-
-#include "../DrawingBoard/shape.h"
+#include "../DrawingBoard/builtin_shape.h"
 #include "../DrawingBoard/painter.h"
 #include "../DrawingBoard/factory.h"
 
-class MyEllipse : public Shape {
+class MyEllipse : public BuiltinShape {
   public:
-    MyEllipse() : m_brushColor(RGB(255, 255, 255)) {}
+    MyEllipse() : BuiltinShape(SHAPE_ELLIPSE) {}
     virtual ~MyEllipse() = default;
 
     MyEllipse(const MyEllipse&) = delete;
     MyEllipse &operator=(const MyEllipse&) = delete;
 
-    virtual const std::vector<POINT>& GetPoints() const override {
-        return m_points;
-    }
-
-    virtual void AddPoint(const POINT &pt) override {
-        m_points.push_back(pt);
-    }
-
-    virtual void ClearPoints() override {
-        m_points.clear();
-    }
-
-    virtual void SetPoint(const POINT &pt, int index) override {
-        m_points[index] = pt;
-    }
-
     virtual Shape* Reset() const override {
         return reinterpret_cast<Shape*>(new MyEllipse);
     }
 
-    virtual bool Contains(const POINT &pt) const override;
-
-    virtual COLORREF GetBrushColor() const override {
-        return m_brushColor;
-    }
-
-    virtual void SetBrushColor(COLORREF color) override {
-        m_brushColor = color;
+    virtual bool Contains(const POINT &pt) const override {
+        return BuiltinGeometry<SHAPE_ELLIPSE>::Contains(m_points, m_bounds, pt);
     }
-
-  private:
-    std::vector<POINT> m_points;
-    COLORREF m_brushColor;
 };
 
-bool MyEllipse::Contains(const POINT &pt) const {
-    int left = std::min(m_points[0].x, m_points[1].x);
-    int right = std::max(m_points[0].x, m_points[1].x);
-    int top = std::min(m_points[0].y, m_points[1].y);
-    int bottom = std::max(m_points[0].y, m_points[1].y);
-
-    double x0 = (left + right) / 2;
-    double y0 = (top + bottom) / 2;
-    double a = (right - left) / 2;
-    double b = (bottom - top) / 2;
-
-    double c = std::pow(pt.x - x0, 2) / std::pow(a, 2) + std::pow(pt.y - y0, 2) / std::pow(b, 2);
-
-    return c < 1.0;
-}
-
 class EllipseFactory: public ShapeFactory {
   public:
     EllipseFactory() = default;
@@ -85,17 +40,18 @@ class EllipsePainter : public Painter {
     EllipsePainter(const EllipsePainter &) = delete;
     EllipsePainter& operator=(const EllipsePainter &) = delete;
 
-    virtual void Draw(HDC hdc, const std::vector<POINT> &points, COLORREF brushColor) const override;
+    virtual void Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const override;
 
     virtual void StartDrawing(Shape *shape, const POINT &pt) const override;
 
     virtual void Update(Shape *shape, const POINT &pt) const override;
+
+    virtual void DrawBatch(HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style) const override;
 };
 
-void EllipsePainter::Draw(HDC hdc, const std::vector<POINT> &points, COLORREF brushColor) const {
-    ::SelectObject(hdc, ::GetStockObject(DC_BRUSH));
-    ::SetDCBrushColor(hdc, brushColor);
-    ::Ellipse(hdc, points[0].x, points[0].y, points[1].x, points[1].y);
+void EllipsePainter::Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const {
+    std::vector<const std::vector<POINT>*> batch(1, &points);
+    DrawBuiltinBatch<SHAPE_ELLIPSE>(hdc, batch, style);
 }
 
 void EllipsePainter::StartDrawing(Shape *shape, const POINT &pt) const {
@@ -112,6 +68,10 @@ void EllipsePainter::Update(Shape *shape, const POINT &pt) const {
     }
 }
 
+void EllipsePainter::DrawBatch(HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style) const {
+    DrawBuiltinBatch<SHAPE_ELLIPSE>(hdc, batch, style);
+}
+
 class EllipsePainterFactory : public PainterFactory {
   public:
     EllipsePainterFactory() = default;
@@ -126,6 +86,11 @@ class EllipsePainterFactory : public PainterFactory {
 };
 
 
+extern "C" __declspec(dllexport)
+int PluginAbiVersion() {
+    return kPluginAbiVersion;
+}
+
 extern "C" __declspec(dllexport)
 const char *PluginName() {
     return "ellipse";
@@ -1,61 +1,24 @@
-#include <algorithm>
-
-#include "../DrawingBoard/shape.h"
+#include "../DrawingBoard/builtin_shape.h"
 #include "../DrawingBoard/painter.h"
 #include "../DrawingBoard/factory.h"
 
-class MyRectangle : public Shape {
+class MyRectangle : public BuiltinShape {
   public:
-    MyRectangle() : m_brushColor(RGB(255, 255, 255)) {}
+    MyRectangle() : BuiltinShape(SHAPE_RECTANGLE) {}
     virtual ~MyRectangle() = default;
 
     MyRectangle(const MyRectangle&) = delete;
     MyRectangle &operator=(const MyRectangle&) = delete;
 
-    virtual const std::vector<POINT>& GetPoints() const override {
-        return m_points;
-    }
-
-    virtual void AddPoint(const POINT &pt) override {
-        m_points.push_back(pt);
-    }
-
-    virtual void ClearPoints() override {
-        m_points.clear();
-    }
-
-    virtual void SetPoint(const POINT &pt, int index) override {
-        m_points[index] = pt;
-    }
-
     virtual Shape* Reset() const override {
         return reinterpret_cast<Shape*>(new MyRectangle);
     }
 
-    virtual bool Contains(const POINT &pt) const override;
-
-    virtual COLORREF GetBrushColor() const override {
-        return m_brushColor;
-    }
-
-    virtual void SetBrushColor(COLORREF color) override {
-        m_brushColor = color;
+    virtual bool Contains(const POINT &pt) const override {
+        return BuiltinGeometry<SHAPE_RECTANGLE>::Contains(m_points, m_bounds, pt);
     }
-
-  private:
-    std::vector<POINT> m_points;
-    COLORREF m_brushColor;
 };
 
-bool MyRectangle::Contains(const POINT &pt) const {
-    int left = std::min(m_points[0].x, m_points[1].x);
-    int right = std::max(m_points[0].x, m_points[1].x);
-    int top = std::min(m_points[0].y, m_points[1].y);
-    int bottom = std::max(m_points[0].y, m_points[1].y);
-
-    return (pt.x > left && pt.x < right && pt.y > top && pt.y < bottom);
-}
-
 class RectangleFactory: public ShapeFactory {
   public:
     RectangleFactory() = default;
@@ -77,17 +40,18 @@ class RectanglePainter: public Painter {
     RectanglePainter(const RectanglePainter &) = delete;
     RectanglePainter& operator=(const RectanglePainter &) = delete;
 
-    virtual void Draw(HDC hdc, const std::vector<POINT> &points, COLORREF brushColor) const override;
+    virtual void Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const override;
 
     virtual void StartDrawing(Shape *shape, const POINT &pt) const override;
 
     virtual void Update(Shape *shape, const POINT &pt) const override;
+
+    virtual void DrawBatch(HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style) const override;
 };
 
-void RectanglePainter::Draw(HDC hdc, const std::vector<POINT> &points, COLORREF brushColor) const {
-    ::SelectObject(hdc, ::GetStockObject(DC_BRUSH));
-    ::SetDCBrushColor(hdc, brushColor);
-    ::Rectangle(hdc, points[0].x, points[0].y, points[1].x, points[1].y);
+void RectanglePainter::Draw(HDC hdc, const std::vector<POINT> &points, const Style &style) const {
+    std::vector<const std::vector<POINT>*> batch(1, &points);
+    DrawBuiltinBatch<SHAPE_RECTANGLE>(hdc, batch, style);
 }
 
 void RectanglePainter::StartDrawing(Shape *shape, const POINT &pt) const {
@@ -104,6 +68,10 @@ void RectanglePainter::Update(Shape *shape, const POINT &pt) const {
     }
 }
 
+void RectanglePainter::DrawBatch(HDC hdc, const std::vector<const std::vector<POINT>*> &batch, const Style &style) const {
+    DrawBuiltinBatch<SHAPE_RECTANGLE>(hdc, batch, style);
+}
+
 class RectanglePainterFactory : public PainterFactory {
   public:
     RectanglePainterFactory() = default;
@@ -117,6 +85,11 @@ class RectanglePainterFactory : public PainterFactory {
     }
 };
 
+extern "C" __declspec(dllexport)
+int PluginAbiVersion() {
+    return kPluginAbiVersion;
+}
+
 extern "C" __declspec(dllexport)
 const char *PluginName() {
     return "rectangle";
@@ -0,0 +1,31 @@
+//
+// Serves a shared board to the clients on this machine; see sync_server.h.
+//
+// usage: SyncServer [port]
+//
+
+#include "sync_server.h"
+#include <cstdlib>
+
+int main(int argc, char *argv[]) {
+    unsigned short port = (argc > 1) ? (unsigned short)std::atoi(argv[1]) : kSyncPort;
+
+    if (!StartSockets()) {
+        return 1;
+    }
+
+    int status = 0;
+    {
+        SyncServer server;
+        if (server.Listen(port)) {
+            std::printf("listening on 127.0.0.1:%u\n", port);
+            server.Run();
+        } else {
+            std::fprintf(stderr, "cannot listen on port %u\n", port);
+            status = 1;
+        }
+    }
+
+    StopSockets();
+    return status;
+}
@@ -0,0 +1,295 @@
+#ifndef _SYNC_SERVER_H_
+#define _SYNC_SERVER_H_
+
+#include "../DrawingBoard/sync_socket.h"
+#include "../DrawingBoard/delta.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// The server of a shared board.
+//
+// Clients on this machine connect over TCP and send frames of deltas, see
+// DrawingBoard/delta.h. Every frame is relayed to all clients, its sender
+// included, in the order the server received them, which is the order every
+// board applies them in.
+//
+// A client that joins late is brought up to date with the board as it is, not
+// with the whole session: the server plays the deltas itself and keeps only
+// the shapes that are still there, each with its latest style and the sum of
+// its translations. What it takes to join grows with the board rather than
+// with the number of edits ever made.
+//
+class SyncServer {
+  public:
+    SyncServer() : m_listener(INVALID_SOCKET), m_nextClient(1), m_removed(0) {}
+    ~SyncServer();
+
+    SyncServer(const SyncServer &) = delete;
+    SyncServer& operator=(const SyncServer &) = delete;
+
+    bool Listen(unsigned short port);
+
+    // Serves clients until something goes wrong with the listening socket.
+    void Run();
+
+    // Serves whatever is ready, waiting up to `timeoutMs' for something to be,
+    // or for as long as it takes if that is negative. Returns false if something
+    // went wrong with the listening socket.
+    bool Serve(int timeoutMs);
+
+  private:
+    static const size_t kMaxFrame = 16 * 1024 * 1024;
+
+    struct Client {
+        SOCKET socket;
+        uint32_t id;
+        bool alive;
+        std::vector<uint8_t> inbox, outbox;
+    };
+
+    // A shape on the board, as a client that joins now has to be told about it.
+    struct SharedShape {
+        ShapeId id;
+        std::string plugin;
+        std::vector<DeltaPoint> points;  // as created
+        Style style;
+        int32_t dx, dy;                  // moved since
+        bool removed;
+    };
+
+    void Accept();
+    bool Receive(Client *client);
+    bool Send(Client *client);
+    void Relay(uint32_t sender, const uint8_t *payload, size_t size);
+    void Apply(const Delta &delta);
+    void PutBoard(std::vector<uint8_t> *out) const;
+
+    SOCKET m_listener;
+    uint32_t m_nextClient;
+    std::vector<std::unique_ptr<Client> > m_clients;
+    std::vector<SharedShape> m_shapes;                    // in the order they were created
+    std::unordered_map<uint64_t, size_t> m_shapeIndices;  // of the shapes not removed, by id
+    size_t m_removed;                                     // shapes left in m_shapes after their removal
+};
+
+SyncServer::~SyncServer() {
+    for (auto &client : m_clients) {
+        ::closesocket(client->socket);
+    }
+    if (m_listener != INVALID_SOCKET) {
+        ::closesocket(m_listener);
+    }
+}
+
+bool SyncServer::Listen(unsigned short port) {
+    m_listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_listener == INVALID_SOCKET) {
+        return false;
+    }
+
+    int one = 1;
+    ::setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+    sockaddr_in addr = LoopbackAddress(port);
+    return ::bind(m_listener, (const sockaddr*)&addr, sizeof(addr)) == 0 && ::listen(m_listener, SOMAXCONN) == 0;
+}
+
+void SyncServer::Run() {
+    while (Serve(-1)) {
+    }
+}
+
+bool SyncServer::Serve(int timeoutMs) {
+    fd_set readable, writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_SET(m_listener, &readable);
+    SOCKET last = m_listener;
+    for (auto &client : m_clients) {
+        FD_SET(client->socket, &readable);
+        if (!client->outbox.empty()) {
+            FD_SET(client->socket, &writable);
+        }
+        last = std::max(last, client->socket);
+    }
+
+    timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    int ready = ::select((int)last + 1, &readable, &writable, nullptr, (timeoutMs < 0) ? nullptr : &timeout);
+    if (ready < 0) {
+        return LastCallWouldBlock();
+    }
+    if (ready == 0) {
+        return true;
+    }
+
+    if (FD_ISSET(m_listener, &readable)) {
+        Accept();
+    }
+
+    // Clients that drop out are closed only after everyone has been served,
+    // so that the sockets in the sets stay valid.
+    for (size_t i = 0; i < m_clients.size(); i++) {
+        Client *client = m_clients[i].get();
+        if (client->alive && FD_ISSET(client->socket, &readable)) {
+            client->alive = Receive(client);
+        }
+        if (client->alive && FD_ISSET(client->socket, &writable)) {
+            client->alive = Send(client);
+        }
+    }
+
+    // Relayed frames go out right away rather than on the next round.
+    for (auto &client : m_clients) {
+        if (client->alive && !client->outbox.empty()) {
+            client->alive = Send(client.get());
+        }
+        if (!client->alive) {
+            std::printf("client %u left\n", client->id);
+            ::closesocket(client->socket);
+        }
+    }
+    m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(), [](const std::unique_ptr<Client> &client) {
+        return !client->alive;
+    }), m_clients.end());
+    return true;
+}
+
+void SyncServer::Accept() {
+    SOCKET s = ::accept(m_listener, nullptr, nullptr);
+    if (s == INVALID_SOCKET) {
+        return;
+    }
+#ifndef _WIN32
+    if (s >= FD_SETSIZE) {
+        ::closesocket(s);
+        return;
+    }
+#endif
+    SetupSocket(s, true);
+
+    std::unique_ptr<Client> client(new Client);
+    client->socket = s;
+    client->id = m_nextClient++;
+    client->alive = true;
+    PutHello(&client->outbox, client->id);
+    PutBoard(&client->outbox);
+    std::printf("client %u joined\n", client->id);
+    m_clients.push_back(std::move(client));
+}
+
+bool SyncServer::Receive(Client *client) {
+    char buffer[64 * 1024];
+    int n = ::recv(client->socket, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        return n < 0 && LastCallWouldBlock();
+    }
+    client->inbox.insert(client->inbox.end(), buffer, buffer + n);
+
+    size_t read = 0, header, size;
+    FrameStatus status;
+    while ((status = PeekFrame(client->inbox.data() + read, client->inbox.size() - read, kMaxFrame, &header, &size)) == FRAME_READY) {
+        Relay(client->id, client->inbox.data() + read + header, size);
+        read += header + size;
+    }
+    client->inbox.erase(client->inbox.begin(), client->inbox.begin() + read);
+    return status != FRAME_CORRUPT;
+}
+
+bool SyncServer::Send(Client *client) {
+    int n = ::send(client->socket, (const char*)client->outbox.data(), (int)client->outbox.size(), 0);
+    if (n < 0) {
+        return LastCallWouldBlock();
+    }
+    client->outbox.erase(client->outbox.begin(), client->outbox.begin() + n);
+    return true;
+}
+
+// Boards stop at the first delta of a frame they cannot read, and so does the
+// server's own.
+void SyncServer::Relay(uint32_t sender, const uint8_t *payload, size_t size) {
+    std::vector<uint8_t> frame;
+    PutRelayFrame(&frame, sender, payload, size);
+    for (auto &client : m_clients) {
+        client->outbox.insert(client->outbox.end(), frame.begin(), frame.end());
+    }
+
+    DeltaReader reader(payload, size);
+    Delta delta;
+    while (reader.Next(&delta)) {
+        Apply(delta);
+    }
+}
+
+// Plays a delta the way the boards do, see `MainWindow::ApplyRemoteEdit()'.
+// Removed shapes are dropped for good once they make up half of m_shapes.
+void SyncServer::Apply(const Delta &delta) {
+    if (delta.op == DELTA_HELLO) {
+        return;  // only ever sent by the server
+    }
+    if (delta.op == DELTA_CREATE) {
+        if (m_shapeIndices.count(delta.shape.Key())) {
+            return;
+        }
+        SharedShape shape = { delta.shape, delta.plugin, delta.points, delta.style, 0, 0, false };
+        m_shapeIndices[delta.shape.Key()] = m_shapes.size();
+        m_shapes.push_back(shape);
+        return;
+    }
+
+    auto it = m_shapeIndices.find(delta.shape.Key());
+    if (it == m_shapeIndices.end()) {
+        return;
+    }
+    SharedShape &shape = m_shapes[it->second];
+
+    switch (delta.op) {
+        case DELTA_TRANSLATE:
+            // Wraps around like the boards' coordinates do.
+            shape.dx = (int32_t)((uint32_t)shape.dx + (uint32_t)delta.dx);
+            shape.dy = (int32_t)((uint32_t)shape.dy + (uint32_t)delta.dy);
+            break;
+
+        case DELTA_RESTYLE:
+            shape.style = delta.style;
+            break;
+
+        case DELTA_REMOVE:
+            shape.removed = true;
+            m_shapeIndices.erase(it);
+            m_removed++;
+            break;
+
+        default:
+            break;
+    }
+
+    if (m_removed > m_shapes.size() / 2) {
+        m_shapes.erase(std::remove_if(m_shapes.begin(), m_shapes.end(), [](const SharedShape &shape) {
+            return shape.removed;
+        }), m_shapes.end());
+        for (size_t i = 0; i < m_shapes.size(); i++) {
+            m_shapeIndices[m_shapes[i].id.Key()] = i;
+        }
+        m_removed = 0;
+    }
+}
+
+// Appends the board as frames from the server, one per shape.
+void SyncServer::PutBoard(std::vector<uint8_t> *out) const {
+    DeltaBatch batch;
+    for (const SharedShape &shape : m_shapes) {
+        if (shape.removed) {
+            continue;
+        }
+        batch.Create(shape.id, shape.plugin, shape.points, shape.style);
+        batch.Translate(shape.id, shape.dx, shape.dy);
+        batch.Flush(out, 0);
+    }
+}
+
+#endif // _SYNC_SERVER_H_